@@ -356,6 +356,30 @@ struct PACKED log_Rate_Thread_Dt {
     float dtMin;
 };
 
+// rate thread gyro sample latency stats
+struct PACKED log_Rate_Thread_Latency {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint32_t samples;
+    uint32_t overruns;
+    uint16_t p50;
+    uint16_t p90;
+    uint16_t p99;
+    uint16_t max;
+};
+
+// rate thread motor output latency stats
+struct PACKED log_Rate_Thread_Output_Latency {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t stage;
+    uint32_t samples;
+    uint16_t p50;
+    uint16_t p90;
+    uint16_t p99;
+    uint16_t max;
+};
+
 // Write a Guided mode position target
 // pos_target_ned_m is lat, lon, alt OR offset from ekf origin in m
 // terrain should be 0 if pos_target_ned_m.z is alt-above-ekf-origin, 1 if alt-above-terrain
@@ -418,6 +442,45 @@ void Copter::Log_Write_Rate_Thread_Dt(float dt, float dtAvg, float dtMax, float
 #endif
 }
 
+void Copter::Log_Write_Rate_Thread_Latency()
+{
+#if AP_INERTIALSENSOR_FAST_SAMPLE_WINDOW_ENABLED
+    AP_InertialSensor::RateLoopLatency latency;
+    if (!ins.get_rate_loop_latency(latency)) {
+        return;
+    }
+    const log_Rate_Thread_Latency pkt {
+        LOG_PACKET_HEADER_INIT(LOG_RATE_THREAD_LATENCY_MSG),
+        time_us         : AP_HAL::micros64(),
+        samples         : latency.samples,
+        overruns        : latency.overruns,
+        p50             : latency.p50_us,
+        p90             : latency.p90_us,
+        p99             : latency.p99_us,
+        max             : latency.max_us
+    };
+    logger.WriteBlock(&pkt, sizeof(pkt));
+
+    // latency to the motor outputs being pushed and sent to the ESCs
+    for (const auto stage : { AP_InertialSensor::RateLoopStage::OUTPUT, AP_InertialSensor::RateLoopStage::SENT }) {
+        if (!ins.get_rate_loop_latency(latency, stage)) {
+            continue;
+        }
+        const log_Rate_Thread_Output_Latency out_pkt {
+            LOG_PACKET_HEADER_INIT(LOG_RATE_THREAD_OUTPUT_LATENCY_MSG),
+            time_us         : AP_HAL::micros64(),
+            stage           : uint8_t(stage),
+            samples         : latency.samples,
+            p50             : latency.p50_us,
+            p90             : latency.p90_us,
+            p99             : latency.p99_us,
+            max             : latency.max_us
+        };
+        logger.WriteBlock(&out_pkt, sizeof(out_pkt));
+    }
+#endif
+}
+
 // type and unit information can be found in
 // libraries/AP_Logger/Logstructure.h; search for "log_Units" for
 // units and "Format characters" for field type information
@@ -572,6 +635,33 @@ const struct LogStructure Copter::log_structure[] = {
     { LOG_RATE_THREAD_DT_MSG, sizeof(log_Rate_Thread_Dt),
       "RTDT", "Qffff", "TimeUS,dt,dtAvg,dtMax,dtMin", "sssss", "F----" , true },
 
+// @LoggerMessage: RTLT
+// @Description: Rate thread gyro sample latency, from the gyro sample being filtered to its use by the rate controller
+// @Field: TimeUS: Time since system startup
+// @Field: N: number of samples used since last log output
+// @Field: Over: number of samples dropped because the rate thread fell behind since last log output
+// @Field: P50: median latency
+// @Field: P90: 90th percentile latency
+// @Field: P99: 99th percentile latency
+// @Field: Max: maximum latency since last log output
+
+    { LOG_RATE_THREAD_LATENCY_MSG, sizeof(log_Rate_Thread_Latency),
+      "RTLT", "QIIHHHH", "TimeUS,N,Over,P50,P90,P99,Max", "s--ssss", "F--FFFF" , true },
+
+// @LoggerMessage: RTOL
+// @Description: Rate thread motor output latency, from the gyro sample being filtered to the motor outputs
+// @Field: TimeUS: Time since system startup
+// @Field: Stg: rate loop stage
+// @FieldValueEnum: Stg: AP_InertialSensor::RateLoopStage
+// @Field: N: number of outputs since last log output
+// @Field: P50: median latency
+// @Field: P90: 90th percentile latency
+// @Field: P99: 99th percentile latency
+// @Field: Max: maximum latency since last log output
+
+    { LOG_RATE_THREAD_OUTPUT_LATENCY_MSG, sizeof(log_Rate_Thread_Output_Latency),
+      "RTOL", "QBIHHHH", "TimeUS,Stg,N,P50,P90,P99,Max", "s#-ssss", "F--FFFF" , true },
+
 };
 
 uint8_t Copter::get_num_log_structures() const
@@ -67,7 +67,7 @@
 
  Design:
 
- 1. Filtered gyro samples are (sub-sampled and) pushed into an ObjectBuffer from the INS backend.
+ 1. Filtered gyro samples are (sub-sampled and) pushed into a FastRateBuffer from the INS backend.
  2. The pushed sample is published to the INS front-end so that the rest of the vehicle only
     sees published values that have been used by the rate controller. When the rate thread is not 
     in use the filtered samples are effectively sub-sampled at the main loop rate. The EKF is unaffected
@@ -83,8 +83,8 @@
  6. Periodically the rate thread:
     6a. Logs the rate outputs (1Khz)
     6b. Updates the notch filter centers (Gyro rate/2)
-    6c. Checks the ObjectBuffer length and main loop delay (10Hz)
-        If the ObjectBuffer length has been longer than 2 for the last 5 cycles or the main loop has
+    6c. Checks the FastRateBuffer length and main loop delay (10Hz)
+        If the FastRateBuffer length has been longer than 2 for the last 5 cycles or the main loop has
         been slowed down then the rate thread is slowed down by telling the INS to sub-sample. This
         mechanism is continued until the rate thread is able to keep up with the sub-sample rate.
         The inverse of this mechanism is run if the rate thread is able to keep up but is running slower
@@ -273,7 +273,9 @@ void Copter::rate_controller_thread()
         if (run_decimated_callback(rates.main_loop_rate, main_loop_count)) {
             main_loop_count = 0;
         }
+        const uint32_t output_start_us = AP_HAL::micros();
         motors_output(main_loop_count == 0);
+        ins.rate_loop_output_done(output_start_us, AP_HAL::micros(), hal.rcout->get_last_output_us());
 
         // process filter updates
         if (run_decimated_callback(rates.filter_rate, filter_loop_count)) {
@@ -288,6 +290,7 @@ void Copter::rate_controller_thread()
 #if HAL_LOGGING_ENABLED
         if (now_ms - last_rtdt_log_ms >= 100) {    // 10 Hz
             Log_Write_Rate_Thread_Dt(dt, sensor_dt, max_dt, min_dt);
+            Log_Write_Rate_Thread_Latency();
             max_dt = sensor_dt;
             min_dt = sensor_dt;
             last_rtdt_log_ms = now_ms;
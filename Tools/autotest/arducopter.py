@@ -4278,6 +4278,42 @@ class AutoTestCopter(vehicle_test_suite.TestSuite):
         tend = self.get_sim_time()
         return tstart, tend, vfr_hud.throttle
 
+    def IMUBatchStreaming(self):
+        """Test IMU batch streaming logs every sensor without drops"""
+        self.set_parameters({
+            "INS_LOG_BAT_MASK": 3,
+            "INS_LOG_BAT_OPT": 8,
+            "LOG_BITMASK": 958,
+            "LOG_DISARMED": 0,
+        })
+        self.reboot_sitl()
+
+        self.change_mode('LOITER')
+        self.wait_ready_to_arm()
+        self.arm_vehicle()
+        self.delay_sim_time(20)
+        self.disarm_vehicle()
+
+        self.assert_current_onboard_log_contains_message("ISBD")
+
+        # every stream must report samples, and none may drop any
+        dfreader = self.dfreader_for_current_onboard_log()
+        seen = {}
+        while True:
+            m = dfreader.recv_match(type="ISBS")
+            if m is None:
+                break
+            if m.Drop != 0:
+                raise NotAchievedException("Stream type=%u instance=%u dropped %u samples" %
+                                           (m.type, m.instance, m.Drop))
+            if m.Rate > 0:
+                seen[(m.type, m.instance)] = seen.get((m.type, m.instance), 0) + 1
+        for sensor_type in 0, 1:
+            for instance in 0, 1:
+                if seen.get((sensor_type, instance), 0) == 0:
+                    raise NotAchievedException("No streamed samples for type=%u instance=%u" %
+                                               (sensor_type, instance))
+
     def MotorVibration(self):
         """Test flight with motor vibration"""
         # magic tridge EKF type that dramatically speeds up the test
@@ -7281,6 +7317,61 @@ class AutoTestCopter(vehicle_test_suite.TestSuite):
         self.context_pop()
         self.reboot_sitl()
 
+    def RateThreadLatency(self):
+        """Check the rate thread latency from gyro sample to motor output."""
+        self.context_push()
+        self.set_parameters({
+            "LOG_DISARMED": 0,
+            "FSTRATE_ENABLE": 1,
+        })
+        self.reboot_sitl()
+
+        self.takeoff(10, mode="ALT_HOLD")
+        self.delay_sim_time(20)
+
+        content = self.fetch_file_via_ftp("@SYS/timing.txt")
+        self.progress("Got content (%s)" % str(content))
+        lines = content.split("\n")
+        if not lines[0].startswith("RateLoopV1"):
+            raise NotAchievedException("Expected RateLoopV1 as first line not (%s)" % lines[0])
+        stages = {}
+        for line in lines[2:]:
+            fields = line.split()
+            if len(fields) < 2 or "=" not in fields[1]:
+                continue
+            stages[fields[0]] = dict(f.split("=") for f in fields[1:])
+        for stage in "gyro", "output", "sent":
+            if stage not in stages:
+                raise NotAchievedException("No %s stage in timing.txt" % stage)
+            if int(stages[stage]["N"]) == 0:
+                raise NotAchievedException("No samples for %s stage" % stage)
+
+        self.do_RTL()
+
+        mlog = self.dfreader_for_current_onboard_log()
+        counts = {}
+        while True:
+            m = mlog.recv_match(type=["RTLT", "RTOL"])
+            if m is None:
+                break
+            if m.N == 0:
+                continue
+            name = "RTLT" if m.get_type() == "RTLT" else "RTOL[%u]" % m.Stg
+            counts[name] = counts.get(name, 0) + m.N
+            if m.P50 > m.P90 or m.P90 > m.P99:
+                raise NotAchievedException("%s percentiles out of order %s" % (name, str(m)))
+            # the last bin collects everything over 310us, SITL
+            # scheduling is too noisy to bound the tail
+            if m.P50 >= 320:
+                raise NotAchievedException("%s median latency too high %s" % (name, str(m)))
+        self.progress("Latency samples %s" % str(counts))
+        for name in "RTLT", "RTOL[1]", "RTOL[2]":
+            if counts.get(name, 0) == 0:
+                raise NotAchievedException("No %s samples logged" % name)
+
+        self.context_pop()
+        self.reboot_sitl()
+
     def hover_and_check_matched_frequency(self, dblevel=-15, minhz=200, maxhz=300, fftLength=32, peakhz=None):
         '''do a simple up-and-down test flight with current vehicle state.
         Check that the onboard filter comes up with the same peak-frequency that
@@ -12554,6 +12645,28 @@ class AutoTestCopter(vehicle_test_suite.TestSuite):
         if not lines[-2].startswith("AP_Vehicle::update_arming"):
             raise NotAchievedException("Expected EFI last not (%s)" % lines[-2])
 
+    def AHRSAttitudeCache(self):
+        '''Test the AHRS attitude cache avoids repeated conversions'''
+        self.takeoff(10, mode="GUIDED")
+        self.delay_sim_time(10)
+        content = self.fetch_file_via_ftp("@SYS/ahrs_cache.txt")
+        self.progress("Got content (%s)" % str(content))
+        self.do_RTL()
+
+        lines = content.split("\n")
+        if not lines[0].startswith("AttitudeCacheV1"):
+            raise NotAchievedException("Expected AttitudeCacheV1 as first line not (%s)" % lines[0])
+        avoided = None
+        for line in lines:
+            if line.startswith("avoided per update="):
+                avoided = float(line.split("=")[1])
+        if avoided is None:
+            raise NotAchievedException("No avoided per update line")
+        # DCM and the EKF both update the attitude each loop, so the
+        # derived values are recalculated once instead of twice
+        if avoided < 1:
+            raise NotAchievedException("Expected at least one conversion avoided per update, got %f" % avoided)
+
     def RTL_TO_RALLY(self, target_system=1, target_component=1):
         '''Check RTL to rally point'''
         self.wait_ready_to_arm()
@@ -15564,10 +15677,12 @@ return update, 1000
         '''return list of all tests'''
         ret = ([
             self.MotorVibration,
+            self.IMUBatchStreaming,
             Test(self.DynamicNotches, attempts=4),
             self.PositionWhenGPSIsZero,
             self.DynamicRpmNotches, # Do not add attempts to this - failure is sign of a bug
             self.DynamicRpmNotchesRateThread,
+            self.RateThreadLatency,
             self.PIDNotches,
             self.mission_NAV_LOITER_TURNS,
             self.mission_NAV_LOITER_TURNS_off_center,
@@ -15606,6 +15721,7 @@ return update, 1000
             Test(self.DataFlashErase, attempts=8),
             self.Callisto,
             self.PerfInfo,
+            self.AHRSAttitudeCache,
             self.ModeAllowsEntryWhenNoPilotInput,
             self.Replay,
             self.FETtecESC,
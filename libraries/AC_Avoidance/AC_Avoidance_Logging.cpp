@@ -42,6 +42,20 @@ void AP_OABendyRuler::Write_OABendyRuler(const uint8_t type, const bool active,
     };
     logger.WriteBlock(&pkt, sizeof(pkt));
 }
+
+void AP_OABendyRuler::Write_OABendyRulerTiming(const uint8_t type, const uint32_t plan_us, const uint32_t field_us, const uint16_t db_count, const bool field_used) const
+{
+    const struct log_OABendyRulerTiming pkt{
+        LOG_PACKET_HEADER_INIT(LOG_OA_BENDYRULER_TIMING_MSG),
+        time_us     : AP_HAL::micros64(),
+        type        : type,
+        plan_us     : plan_us,
+        field_us    : field_us,
+        db_count    : db_count,
+        field_used  : field_used
+    };
+    AP::logger().WriteBlock(&pkt, sizeof(pkt));
+}
 #endif  // AP_OAPATHPLANNER_BENDYRULER_ENABLED
 
 #if AP_OAPATHPLANNER_DIJKSTRA_ENABLED
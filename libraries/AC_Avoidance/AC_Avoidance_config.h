@@ -19,6 +19,10 @@
 #define AP_OAPATHPLANNER_BENDYRULER_ENABLED AP_OAPATHPLANNER_BACKEND_DEFAULT_ENABLED
 #endif
 
+#ifndef AP_OABENDYRULER_DISTANCE_FIELD_ENABLED
+#define AP_OABENDYRULER_DISTANCE_FIELD_ENABLED (AP_OAPATHPLANNER_BENDYRULER_ENABLED && HAL_MEM_CLASS >= HAL_MEM_CLASS_300)
+#endif
+
 #ifndef AP_OAPATHPLANNER_DIJKSTRA_ENABLED
 #define AP_OAPATHPLANNER_DIJKSTRA_ENABLED AP_OAPATHPLANNER_BACKEND_DEFAULT_ENABLED
 #endif
@@ -37,6 +37,12 @@ const float OA_BENDYRULER_LOOKAHEAD_STEP2_MIN = 2.0f;   // step2 checks at least
 const float OA_BENDYRULER_LOOKAHEAD_PAST_DEST = 2.0f;   // lookahead length will be at least this many meters past the destination
 const float OA_BENDYRULER_LOW_SPEED_SQUARED = (0.2f * 0.2f);    // when ground course is below this speed squared, vehicle's heading will be used
 
+#if AP_OABENDYRULER_DISTANCE_FIELD_ENABLED
+const uint16_t OA_BENDYRULER_FIELD_CELLS = 64;          // distance field is this many cells wide in each direction
+const uint16_t OA_BENDYRULER_FIELD_ITEMS_MIN = 16;      // distance field is only used when the database holds at least this many items
+const float OA_BENDYRULER_FIELD_RECENTRE_RATIO = 0.25f; // distance field is moved when the vehicle is this fraction of the field's width from its centre
+#endif
+
 #define VERTICAL_ENABLED APM_BUILD_COPTER_OR_HELI
 
 const AP_Param::GroupInfo AP_OABendyRuler::var_info[] = {
@@ -80,6 +86,9 @@ AP_OABendyRuler::AP_OABendyRuler()
 { 
     AP_Param::setup_object_defaults(this, var_info); 
     _bearing_prev = FLT_MAX;
+#if AP_OABENDYRULER_DISTANCE_FIELD_ENABLED
+    _field.db_changes = UINT32_MAX;
+#endif
 }
 
 // run background task to find best path
@@ -119,10 +128,18 @@ bool AP_OABendyRuler::update(const Location& current_loc, const Location& destin
         ground_course_deg = degrees(ground_speed_vec.angle());
     }
 
+    const uint32_t start_us = AP_HAL::micros();
+    uint32_t field_us = 0;
+    bool field_used = false;
+
     bool ret;
     switch (get_type()) {
         case OABendyType::OA_BENDY_VERTICAL:
         #if VERTICAL_ENABLED 
+        #if AP_OABENDYRULER_DISTANCE_FIELD_ENABLED
+            // distance field only holds horizontal distances
+            _field.valid = false;
+        #endif
             ret = search_vertical_path(current_loc, destination, destination_new, lookahead_step1_dist, lookahead_step2_dist, bearing_to_dest, distance_to_dest, proximity_only);
             bendy_type = OABendyType::OA_BENDY_VERTICAL;
             break;
@@ -130,10 +147,18 @@ bool AP_OABendyRuler::update(const Location& current_loc, const Location& destin
 
         case OABendyType::OA_BENDY_HORIZONTAL:
         default:
+        #if AP_OABENDYRULER_DISTANCE_FIELD_ENABLED
+            update_distance_field(current_loc);
+            field_us = AP_HAL::micros() - start_us;
+            field_used = _field.valid;
+        #endif
             ret = search_xy_path(current_loc, destination, ground_course_deg, destination_new, lookahead_step1_dist, lookahead_step2_dist, bearing_to_dest, distance_to_dest, proximity_only);
             bendy_type = OABendyType::OA_BENDY_HORIZONTAL;
     }
 
+    const AP_OADatabase *oaDb = AP::oadatabase();
+    Write_OABendyRulerTiming((uint8_t)bendy_type, AP_HAL::micros() - start_us, field_us, (oaDb != nullptr) ? oaDb->database_count() : 0, field_used);
+
     return ret;
 }
 
@@ -685,6 +710,13 @@ bool AP_OABendyRuler::calc_margin_from_object_database(const Location &start, co
         return false;
     }
 
+#if AP_OABENDYRULER_DISTANCE_FIELD_ENABLED
+    // use the distance field if it covers this path
+    if (_field.valid && calc_margin_from_distance_field(start, end, margin)) {
+        return true;
+    }
+#endif
+
     // convert start and end to offsets (in cm) from EKF origin
     Vector3f start_NEU,end_NEU;
     if (!start.get_vector_from_origin_NEU_cm(start_NEU) ||
@@ -716,4 +748,140 @@ bool AP_OABendyRuler::calc_margin_from_object_database(const Location &start, co
     return false;
 }
 
+#if AP_OABENDYRULER_DISTANCE_FIELD_ENABLED
+// update the grid of horizontal distances to object database items around the vehicle
+// items added to the end of the database are added to the existing field.  The field is
+// rebuilt if any item has been moved, resized or removed or if the vehicle has moved away from its centre
+void AP_OABendyRuler::update_distance_field(const Location &current_loc)
+{
+    _field.valid = false;
+
+    // checking each item is cheaper than building the field when there are few items
+    const AP_OADatabase *oaDb = AP::oadatabase();
+    if (oaDb == nullptr || !oaDb->healthy()) {
+        return;
+    }
+
+    // the main thread may add items while the field is updated, so the count is read
+    // once and items after it are left for the next update
+    const uint16_t db_count = oaDb->database_count();
+    if (db_count < OA_BENDYRULER_FIELD_ITEMS_MIN) {
+        return;
+    }
+
+    Vector2f current_NE;
+    if (!current_loc.get_vector_xy_from_origin_NE_m(current_NE)) {
+        return;
+    }
+
+    // allocate field on first use
+    if (_field.dist_cm == nullptr) {
+        _field.dist_cm = (int16_t*)calloc(OA_BENDYRULER_FIELD_CELLS * OA_BENDYRULER_FIELD_CELLS, sizeof(int16_t));
+        if (_field.dist_cm == nullptr) {
+            return;
+        }
+    }
+
+    // field must cover both lookahead steps in every direction
+    const float half_width = _lookahead * (1.0f + OA_BENDYRULER_LOOKAHEAD_STEP2_RATIO) + OA_BENDYRULER_LOOKAHEAD_STEP2_MIN + OA_BENDYRULER_LOOKAHEAD_PAST_DEST;
+    const float cell_size = half_width * 2.0f / OA_BENDYRULER_FIELD_CELLS;
+
+    // distances only need to be accurate up to a little more than the margin
+    const float dist_max = MIN(MAX(_margin_max * 2.0f, 1.0f) + cell_size, INT16_MAX * 0.01f);
+
+    const Vector2f centre = _field.origin + Vector2f{half_width, half_width};
+    const bool rebuild = !is_equal(cell_size, _field.cell_size) ||
+                         !is_equal(dist_max, _field.dist_max) ||
+                         (oaDb->database_changes() != _field.db_changes) ||
+                         (db_count < _field.items_count) ||
+                         ((current_NE - centre).length() > half_width * 2.0f * OA_BENDYRULER_FIELD_RECENTRE_RATIO);
+
+    if (rebuild) {
+        _field.origin = current_NE - Vector2f{half_width, half_width};
+        _field.cell_size = cell_size;
+        _field.dist_max = dist_max;
+        _field.db_changes = oaDb->database_changes();
+        _field.items_count = 0;
+        const int16_t dist_max_cm = dist_max * 100.0f;
+        for (uint16_t i = 0; i < OA_BENDYRULER_FIELD_CELLS * OA_BENDYRULER_FIELD_CELLS; i++) {
+            _field.dist_cm[i] = dist_max_cm;
+        }
+    }
+
+    // add new items
+    distance_field_add_items(_field.items_count, db_count);
+    _field.items_count = db_count;
+    _field.valid = true;
+}
+
+// add database items from start_index up to but not including end_index to the distance field
+void AP_OABendyRuler::distance_field_add_items(uint16_t start_index, uint16_t end_index)
+{
+    const AP_OADatabase *oaDb = AP::oadatabase();
+    const float cell_size_inv = 1.0f / _field.cell_size;
+    const int32_t cells_max = OA_BENDYRULER_FIELD_CELLS - 1;
+
+    for (uint16_t i = start_index; i < end_index; i++) {
+        const AP_OADatabase::OA_DbItem& item = oaDb->get_item(i);
+        const Vector2f item_pos = item.pos.xy() - _field.origin;
+
+        // only cells within dist_max of the item's edge are affected
+        const float reach = item.radius + _field.dist_max;
+        const int32_t x_min = MAX(floorf((item_pos.x - reach) * cell_size_inv), 0);
+        const int32_t x_max = MIN(floorf((item_pos.x + reach) * cell_size_inv), cells_max);
+        const int32_t y_min = MAX(floorf((item_pos.y - reach) * cell_size_inv), 0);
+        const int32_t y_max = MIN(floorf((item_pos.y + reach) * cell_size_inv), cells_max);
+
+        for (int32_t x = x_min; x <= x_max; x++) {
+            for (int32_t y = y_min; y <= y_max; y++) {
+                const Vector2f cell_centre{(x + 0.5f) * _field.cell_size, (y + 0.5f) * _field.cell_size};
+                const float dist = (cell_centre - item_pos).length() - item.radius;
+                const int16_t dist_cm = constrain_float(floorf(dist * 100.0f), -INT16_MAX, INT16_MAX);
+                int16_t &cell = _field.dist_cm[x * OA_BENDYRULER_FIELD_CELLS + y];
+                if (dist_cm < cell) {
+                    cell = dist_cm;
+                }
+            }
+        }
+    }
+}
+
+// calculate minimum distance between a path and proximity sensor obstacles using the distance field
+// the path is sampled every half cell and the result reduced by one cell width so that the margin is never over-estimated
+// returns false if the path is not within the distance field
+//
+// unlike calc_margin_from_object_database()'s per item check, which uses the 3D distance from the path
+// to each item's centre, the field holds 2D distances and is coarsened by the cell reduction.  Margins are
+// never larger than the per item check gives but may be up to a cell width plus any altitude separation
+// smaller, so the margin can drop by that much when the database grows to OA_BENDYRULER_FIELD_ITEMS_MIN items
+bool AP_OABendyRuler::calc_margin_from_distance_field(const Location &start, const Location &end, float &margin) const
+{
+    Vector2f start_NE, end_NE;
+    if (!start.get_vector_xy_from_origin_NE_m(start_NE) ||
+        !end.get_vector_xy_from_origin_NE_m(end_NE)) {
+        return false;
+    }
+    start_NE -= _field.origin;
+    end_NE -= _field.origin;
+
+    const float cell_size_inv = 1.0f / _field.cell_size;
+    const uint16_t num_steps = MAX(ceilf((end_NE - start_NE).length() * 2.0f * cell_size_inv), 1);
+    const Vector2f step = (end_NE - start_NE) / num_steps;
+
+    int16_t dist_min_cm = INT16_MAX;
+    for (uint16_t i = 0; i <= num_steps; i++) {
+        const Vector2f pos = start_NE + step * i;
+        const int32_t x = floorf(pos.x * cell_size_inv);
+        const int32_t y = floorf(pos.y * cell_size_inv);
+        if (x < 0 || y < 0 || x >= OA_BENDYRULER_FIELD_CELLS || y >= OA_BENDYRULER_FIELD_CELLS) {
+            return false;
+        }
+        dist_min_cm = MIN(dist_min_cm, _field.dist_cm[x * OA_BENDYRULER_FIELD_CELLS + y]);
+    }
+
+    margin = dist_min_cm * 0.01f - _field.cell_size;
+    return true;
+}
+#endif  // AP_OABENDYRULER_DISTANCE_FIELD_ENABLED
+
 #endif  // AP_OAPATHPLANNER_BENDYRULER_ENABLED
@@ -71,11 +71,25 @@ private:
     // on success returns true and updates margin
     bool calc_margin_from_object_database(const Location &start, const Location &end, float &margin) const;
 
+#if AP_OABENDYRULER_DISTANCE_FIELD_ENABLED
+    // update the grid of horizontal distances to object database items around the vehicle
+    void update_distance_field(const Location &current_loc);
+
+    // add database items from start_index up to but not including end_index to the distance field
+    void distance_field_add_items(uint16_t start_index, uint16_t end_index);
+
+    // calculate minimum distance between a path and proximity sensor obstacles using the distance field
+    // returns false if the path is not within the distance field
+    bool calc_margin_from_distance_field(const Location &start, const Location &end, float &margin) const;
+#endif
+
     // Logging function
 #if HAL_LOGGING_ENABLED
     void Write_OABendyRuler(const uint8_t type, const bool active, const float target_yaw, const float target_pitch, const bool resist_chg, const float margin, const Location &final_dest, const Location &oa_dest) const;
+    void Write_OABendyRulerTiming(const uint8_t type, const uint32_t plan_us, const uint32_t field_us, const uint16_t db_count, const bool field_used) const;
 #else
     void Write_OABendyRuler(const uint8_t type, const bool active, const float target_yaw, const float target_pitch, const bool resist_chg, const float margin, const Location &final_dest, const Location &oa_dest) const {}
+    void Write_OABendyRulerTiming(const uint8_t type, const uint32_t plan_us, const uint32_t field_us, const uint16_t db_count, const bool field_used) const {}
 #endif
 
     // OA common parameters
@@ -91,6 +105,19 @@ private:
     float _current_lookahead;       // distance (in meters) ahead of the vehicle we are looking for obstacles
     float _bearing_prev;            // stored bearing in degrees 
     Location _destination_prev;     // previous destination, to check if there has been a change in destination
+
+#if AP_OABENDYRULER_DISTANCE_FIELD_ENABLED
+    // grid of horizontal distances from cell centres to the edge of the nearest object database item
+    struct {
+        int16_t *dist_cm;           // distance in cm for each cell, north index major.  nullptr until first needed
+        Vector2f origin;            // corner of cell 0,0 as an offset in meters from the EKF origin (NE)
+        float cell_size;            // width of each cell in meters
+        float dist_max;             // distances are limited to this many meters
+        uint16_t items_count;       // number of database items added to the field
+        uint32_t db_changes;        // database change count when the field was last rebuilt
+        bool valid;                 // true if the field is up to date and may be used for margin calculations
+    } _field;
+#endif
 };
 
 #endif  // AP_OAPATHPLANNER_BENDYRULER_ENABLED
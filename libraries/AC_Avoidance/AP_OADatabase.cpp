@@ -341,6 +341,7 @@ void AP_OADatabase::database_item_remove(const uint16_t index)
     _database.items[index].radius = 0;
     _database.items[index].send_to_gcs = get_send_to_gcs_flags(_database.items[index].importance);
 
+    _database.changes++;
     _database.count--;
     if (_database.count == 0) {
         return;
@@ -353,7 +354,7 @@ void AP_OADatabase::database_item_remove(const uint16_t index)
     }
 }
 
-void AP_OADatabase::database_item_refresh(OA_DbItem &current_item, const OA_DbItem &new_item) const
+void AP_OADatabase::database_item_refresh(OA_DbItem &current_item, const OA_DbItem &new_item)
 {
     const bool is_different =
             (!is_equal(current_item.radius, new_item.radius)) ||
@@ -363,12 +364,16 @@ void AP_OADatabase::database_item_refresh(OA_DbItem &current_item, const OA_DbIt
         // update timestamp and radius on close object so it stays around longer
         // and trigger resending to GCS
         current_item.timestamp_ms = new_item.timestamp_ms;
+        if (!is_equal(current_item.radius, new_item.radius)) {
+            _database.changes++;
+        }
         current_item.radius = new_item.radius;
         current_item.send_to_gcs = get_send_to_gcs_flags(current_item.importance);
 
         if (current_item.source == OA_DbItem::Source::AIS) {
             // Update position for AIS items, these tend to be large and update slowly
             current_item.pos = new_item.pos;
+            _database.changes++;
         }
     }
 }
@@ -61,6 +61,10 @@ public:
     // get number of items in the database
     uint16_t database_count() const { return _database.count; }
 
+    // get number of times an existing item has been moved, resized or removed.
+    // items added to the end of the database do not change this count
+    uint32_t database_changes() const { return _database.changes; }
+
     // empty queue and try and put into database. Return true if there's more work to do
     bool process_queue();
 
@@ -77,7 +81,7 @@ private:
 
     // database item management
     void database_item_add(const OA_DbItem &item);
-    void database_item_refresh(OA_DbItem &current_item, const OA_DbItem &new_item) const;
+    void database_item_refresh(OA_DbItem &current_item, const OA_DbItem &new_item);
     void database_item_remove(const uint16_t index);
     void database_items_remove_all_expired();
 
@@ -117,6 +121,7 @@ private:
         OA_DbItem       *items;                             // array of objects in the database
         uint16_t        count;                              // number of objects in the items array
         uint16_t        size;                               // cached value of _database_size_param that sticks after initialized
+        uint32_t        changes;                            // number of times an existing item has been moved, resized or removed
     } _database;
 
     uint16_t _next_index_to_send[MAVLINK_COMM_NUM_BUFFERS]; // index of next object in _database to send to GCS
@@ -7,7 +7,8 @@
     LOG_OA_BENDYRULER_MSG, \
     LOG_OA_DIJKSTRA_MSG, \
     LOG_SIMPLE_AVOID_MSG, \
-    LOG_OD_VISGRAPH_MSG
+    LOG_OD_VISGRAPH_MSG, \
+    LOG_OA_BENDYRULER_TIMING_MSG
 
 // @LoggerMessage: OABR
 // @Description: Object avoidance (Bendy Ruler) diagnostics
@@ -43,6 +44,24 @@ struct PACKED log_OABendyRuler {
     float oa_alt;
 };
 
+// @LoggerMessage: OABT
+// @Description: Object avoidance (Bendy Ruler) planning time
+// @Field: TimeUS: Time since system startup
+// @Field: Type: Type of BendyRuler currently active
+// @Field: PUs: Time taken to plan the path, including updating the distance field
+// @Field: FUs: Time taken to update the distance field
+// @Field: DbCnt: Number of items in the object database
+// @Field: Fld: True if the distance field was used for object database margins
+struct PACKED log_OABendyRulerTiming {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t type;
+    uint32_t plan_us;
+    uint32_t field_us;
+    uint16_t db_count;
+    uint8_t field_used;
+};
+
 // @LoggerMessage: OADJ
 // @Description: Object avoidance (Dijkstra) diagnostics
 // @Field: TimeUS: Time since system startup
@@ -116,7 +135,9 @@ struct PACKED log_OD_Visgraph {
     { LOG_SIMPLE_AVOID_MSG, sizeof(log_SimpleAvoid), \
       "SA",  "QBffffffB","TimeUS,State,DVelX,DVelY,DVelZ,MVelX,MVelY,MVelZ,Back", "s-nnnnnn-", "F--------", true }, \
      { LOG_OD_VISGRAPH_MSG, sizeof(log_OD_Visgraph), \
-      "OAVG", "QBBLL", "TimeUS,version,point_num,Lat,Lon", "s--DU", "F--GG", true},
+      "OAVG", "QBBLL", "TimeUS,version,point_num,Lat,Lon", "s--DU", "F--GG", true}, \
+    { LOG_OA_BENDYRULER_TIMING_MSG, sizeof(log_OABendyRulerTiming), \
+      "OABT", "QBIIHB", "TimeUS,Type,PUs,FUs,DbCnt,Fld", "s-ss--", "F-FF--", true},
 #else
 #define LOG_STRUCTURE_FROM_AVOIDANCE
 #endif // AP_AVOIDANCE_ENABLED
@@ -262,6 +262,102 @@ float AC_PID::update_all(float target, float measurement, float dt, bool limit,
         }
     }
 
+    return update_output(measurement, dt, limit, pd_scale, i_scale);
+}
+
+/*
+  Updates three controllers, normally the roll, pitch and yaw rate
+  controllers, in one pass giving the same results as calling
+  update_all() on each. The target and error filters and derivatives
+  for all axes are run together on local arrays, then each controller
+  finishes with its own integrator, slew limiter and output
+  limits. Filter resets and invalid inputs are rare and use
+  update_all()
+ */
+Vector3f AC_PID::update_all_xyz(AC_PID &pid_x, AC_PID &pid_y, AC_PID &pid_z,
+                                const Vector3f &target, const Vector3f &measurement, float dt,
+                                const bool limit[3], const Vector3f &pd_scale, const Vector3f &i_scale)
+{
+    AC_PID *const pids[3] { &pid_x, &pid_y, &pid_z };
+
+    bool fused = true;
+    for (uint8_t i = 0; i < 3; i++) {
+        fused &= isfinite(target[i]) && isfinite(measurement[i]) && !pids[i]->_flags._reset_filter;
+    }
+    if (!fused) {
+        return Vector3f(pid_x.update_all(target.x, measurement.x, dt, limit[0], pd_scale.x, i_scale.x),
+                        pid_y.update_all(target.y, measurement.y, dt, limit[1], pd_scale.y, i_scale.y),
+                        pid_z.update_all(target.z, measurement.z, dt, limit[2], pd_scale.z, i_scale.z));
+    }
+
+    // gather the filter state and alphas of each axis
+    float target_in[3], target_filt[3], target_last[3];
+    float error_in[3], error_filt[3], error_last[3];
+    float derivative[3], target_derivative[3];
+    float alpha_T[3], alpha_E[3], alpha_D[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        const AC_PID &pid = *pids[i];
+        target_in[i] = target[i];
+#if AP_FILTER_ENABLED
+        if (pid._target_notch != nullptr) {
+            target_in[i] = pid._target_notch->apply(target_in[i]);
+        }
+#endif
+        target_filt[i] = pid._target;
+        error_filt[i] = pid._error;
+        derivative[i] = pid._derivative;
+        target_derivative[i] = pid._target_derivative;
+        alpha_T[i] = pid.get_filt_T_alpha(dt);
+        alpha_E[i] = pid.get_filt_E_alpha(dt);
+        alpha_D[i] = pid.get_filt_D_alpha(dt);
+    }
+
+    // target low-pass filter and error
+    for (uint8_t i = 0; i < 3; i++) {
+        target_last[i] = target_filt[i];
+        target_filt[i] += alpha_T[i] * (target_in[i] - target_filt[i]);
+        error_in[i] = target_filt[i] - measurement[i];
+    }
+
+#if AP_FILTER_ENABLED
+    for (uint8_t i = 0; i < 3; i++) {
+        if (pids[i]->_error_notch != nullptr) {
+            error_in[i] = pids[i]->_error_notch->apply(error_in[i]);
+        }
+    }
+#endif
+
+    // error low-pass filter
+    for (uint8_t i = 0; i < 3; i++) {
+        error_last[i] = error_filt[i];
+        error_filt[i] += alpha_E[i] * (error_in[i] - error_filt[i]);
+    }
+
+    // error derivative and target derivative
+    if (is_positive(dt)) {
+        for (uint8_t i = 0; i < 3; i++) {
+            derivative[i] += alpha_D[i] * ((error_filt[i] - error_last[i]) / dt - derivative[i]);
+            target_derivative[i] = (target_filt[i] - target_last[i]) / dt;
+        }
+    }
+
+    // store the filter state and finish each axis
+    Vector3f output;
+    for (uint8_t i = 0; i < 3; i++) {
+        AC_PID &pid = *pids[i];
+        pid._pid_info.reset = false;
+        pid._target = target_filt[i];
+        pid._error = error_filt[i];
+        pid._derivative = derivative[i];
+        pid._target_derivative = target_derivative[i];
+        output[i] = pid.update_output(measurement[i], dt, limit[i], pd_scale[i], i_scale[i]);
+    }
+    return output;
+}
+
+// Updates the integrator and calculates the P, I and D outputs from the filtered error and derivative.
+float AC_PID::update_output(float measurement, float dt, bool limit, float pd_scale, float i_scale)
+{
     // Integrate error (with wind-up protection if limit is active)
     // If limit is active, allow I-term to shrink but not grow
     update_i(dt, limit, i_scale);
@@ -4,6 +4,7 @@
 /// @brief	General-purpose PID controller with input, error, and derivative filtering, plus slew rate limiting and EEPROM gain storage.
 
 #include <AP_Common/AP_Common.h>
+#include <AP_Math/AP_Math.h>
 #include <AP_Param/AP_Param.h>
 #include <stdlib.h>
 #include <cmath>
@@ -64,6 +65,12 @@ public:
     // If `limit` is true, the integrator is allowed to shrink but not grow.
     float update_all(float target, float measurement, float dt, bool limit = false, float pd_scale = 1.0f, float i_scale = 1.0f);
 
+    // Updates three controllers, normally the roll, pitch and yaw rate controllers, in one pass.
+    // Gives the same outputs and state as calling update_all() on each controller.
+    static Vector3f update_all_xyz(AC_PID &pid_x, AC_PID &pid_y, AC_PID &pid_z,
+                                   const Vector3f &target, const Vector3f &measurement, float dt,
+                                   const bool limit[3], const Vector3f &pd_scale, const Vector3f &i_scale);
+
     // Computes the PID output from an error input only (target assumed to be zero).
     // Applies error filtering and updates the derivative and integrator.
     // Target and measurement must be set separately for logging.
@@ -161,6 +168,9 @@ protected:
     // If `limit` is true, the integrator is only allowed to shrink to avoid wind-up.
     void update_i(float dt, bool limit, float i_scale = 1.0f);
 
+    // Updates the integrator and calculates the output from the filtered error and derivative.
+    float update_output(float measurement, float dt, bool limit, float pd_scale, float i_scale);
+
     // parameters
     AP_Float _kp;
     AP_Float _ki;
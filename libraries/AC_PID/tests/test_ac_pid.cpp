@@ -0,0 +1,76 @@
+#include <AP_gtest.h>
+
+#include <AC_PID/AC_PID.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+// rate controller defaults, one set of three updated by axis and one set updated together
+static const AC_PID::Defaults defaults {
+    0.135, 0.135, 0.0036, 0.0, 0.5,     // p, i, d, ff, imax
+    20, 0, 20,                          // filt_T_hz, filt_E_hz, filt_D_hz
+    20, 1.0, 0.0001                     // srmax, srtau, dff
+};
+static AC_PID axis_pids[3] { {defaults}, {defaults}, {defaults} };
+static AC_PID xyz_pids[3] { {defaults}, {defaults}, {defaults} };
+
+static void expect_same(const AC_PID &a, const AC_PID &b)
+{
+    const AP_PIDInfo &ia = a.get_pid_info();
+    const AP_PIDInfo &ib = b.get_pid_info();
+    EXPECT_EQ(ia.target, ib.target);
+    EXPECT_EQ(ia.actual, ib.actual);
+    EXPECT_EQ(ia.error, ib.error);
+    EXPECT_EQ(ia.P, ib.P);
+    EXPECT_EQ(ia.I, ib.I);
+    EXPECT_EQ(ia.D, ib.D);
+    EXPECT_EQ(ia.FF, ib.FF);
+    EXPECT_EQ(ia.DFF, ib.DFF);
+    EXPECT_EQ(ia.Dmod, ib.Dmod);
+    EXPECT_EQ(ia.slew_rate, ib.slew_rate);
+    EXPECT_EQ(ia.limit, ib.limit);
+    EXPECT_EQ(ia.PD_limit, ib.PD_limit);
+    EXPECT_EQ(ia.reset, ib.reset);
+    EXPECT_EQ(ia.I_term_set, ib.I_term_set);
+}
+
+/*
+  update_all_xyz() must match update_all() on each axis, including
+  filter resets, invalid inputs and integrator limits
+ */
+TEST(AC_PID, UpdateAllXYZ)
+{
+    const float dt = 1.0 / 2000;
+    xyz_pids[2].set_pdmax(0.05);
+    axis_pids[2].set_pdmax(0.05);
+
+    for (uint32_t n = 0; n < 4000; n++) {
+        const float t = n * dt;
+        Vector3f target(sinf(t * 7), cosf(t * 11), 0.3 * sinf(t * 3));
+        const Vector3f measurement(sinf(t * 7 - 0.2), cosf(t * 11 - 0.1) + 0.01 * sinf(t * 400), 0.25 * sinf(t * 3));
+        const bool limit[3] { (n / 300) % 2 == 0, (n / 500) % 3 == 0, false };
+        const Vector3f pd_scale(1, 1 - 0.5 * ((n / 700) % 2), 1);
+        const Vector3f i_scale(1, 1, 0.5);
+
+        if (n == 1000) {
+            xyz_pids[1].reset_filter();
+            axis_pids[1].reset_filter();
+        }
+        if (n == 2000) {
+            xyz_pids[0].reset_I();
+            axis_pids[0].reset_I();
+        }
+        if (n == 3000) {
+            target.z = NAN;
+        }
+
+        const Vector3f out_xyz = AC_PID::update_all_xyz(xyz_pids[0], xyz_pids[1], xyz_pids[2],
+                                                        target, measurement, dt, limit, pd_scale, i_scale);
+        for (uint8_t i = 0; i < 3; i++) {
+            const float out = axis_pids[i].update_all(target[i], measurement[i], dt, limit[i], pd_scale[i], i_scale[i]);
+            EXPECT_EQ(out, out_xyz[i]);
+            expect_same(axis_pids[i], xyz_pids[i]);
+        }
+    }
+}
+
+AP_GTEST_MAIN()
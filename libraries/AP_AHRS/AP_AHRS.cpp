@@ -324,7 +324,27 @@ void AP_AHRS::update_trim_rotation_matrices()
 // return a Quaternion representing our current attitude in NED frame
 void AP_AHRS::get_quat_body_to_ned(Quaternion &quat) const
 {
-    quat.from_rotation_matrix(get_rotation_body_to_ned());
+#if AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+    _attitude_cache_stats.quat_requests++;
+#endif
+    if (!hal.scheduler->in_main_thread()) {
+        // the cache is only updated from the main thread, which
+        // also updates the attitude
+        quat.from_rotation_matrix(get_rotation_body_to_ned());
+#if AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+        _attitude_cache_stats.quat_conversions++;
+#endif
+        return;
+    }
+    if (!_attitude_cache.valid || _attitude_cache.version != _attitude_version) {
+        _attitude_cache.quat_body_to_ned.from_rotation_matrix(get_rotation_body_to_ned());
+        _attitude_cache.version = _attitude_version;
+        _attitude_cache.valid = true;
+#if AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+        _attitude_cache_stats.quat_conversions++;
+#endif
+    }
+    quat = _attitude_cache.quat_body_to_ned;
 }
 
 // convert a vector from body to earth frame
@@ -466,6 +486,10 @@ void AP_AHRS::update(bool skip_ins_update)
 #endif
     }
 
+    // update the sin/cos and centi-degree values once for all the
+    // backends that updated the attitude
+    update_attitude_derived();
+
 #if AP_MODULE_SUPPORTED
     // call AHRS_update hook if any
     AP_Module::call_hook_AHRS_update(*this);
@@ -537,8 +561,8 @@ void AP_AHRS::update(bool skip_ins_update)
 
 /*
  * copy results from a backend over AP_AHRS canonical results.
- * This updates member variables like roll and pitch, as well as
- * updating derived values like sin_roll and sin_pitch.
+ * This updates member variables like roll and pitch, derived values
+ * like sin_roll and sin_pitch are updated at the end of update().
  */
 void AP_AHRS::copy_estimates_from_backend_estimates(const AP_AHRS_Backend::Estimates &results)
 {
@@ -554,8 +578,7 @@ void AP_AHRS::copy_estimates_from_backend_estimates(const AP_AHRS_Backend::Estim
     state.accel_ef = results.accel_ef;
     state.accel_bias = results.accel_bias;
 
-    update_cd_values();
-    update_trig();
+    attitude_changed();
 }
 
 #if AP_AHRS_DCM_ENABLED
@@ -628,8 +651,7 @@ void AP_AHRS::update_EKF2(void)
             pitch = eulers.y;
             yaw   = eulers.z;
 
-            update_cd_values();
-            update_trig();
+            attitude_changed();
 
             // Use the primary EKF to select the primary gyro
             const AP_InertialSensor &_ins = AP::ins();
@@ -712,8 +734,7 @@ void AP_AHRS::update_EKF3(void)
             pitch = eulers.y;
             yaw   = eulers.z;
 
-            update_cd_values();
-            update_trig();
+            attitude_changed();
 
             const AP_InertialSensor &_ins = AP::ins();
 
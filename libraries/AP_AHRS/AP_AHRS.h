@@ -43,6 +43,8 @@ class AP_AHRS_View;
 // fwd declare GSF estimator
 class EKFGSF_yaw;
 
+class ExpandingString;
+
 class AP_AHRS {
     friend class AP_AHRS_View;
 public:
@@ -623,6 +625,11 @@ public:
     // return a Quaternion representing our current attitude in NED frame
     void get_quat_body_to_ned(Quaternion &quat) const;
 
+#if AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+    // attitude conversions done and avoided, for @SYS/ahrs_cache.txt
+    void attitude_cache_info(ExpandingString &str) const;
+#endif
+
 #if AP_AHRS_DCM_ENABLED
     // get rotation matrix specifically from DCM backend (used for
     // compass calibrator)
@@ -784,6 +791,36 @@ private:
     // update roll_sensor, pitch_sensor and yaw_sensor
     void update_cd_values(void);
 
+    // called when state.dcm_matrix and roll, pitch and yaw are
+    // updated. The backends can each update the attitude in one
+    // update() call, so the derived values are only recalculated by
+    // update_attitude_derived() once they have all run
+    void attitude_changed(void) { _attitude_version++; }
+    void update_attitude_derived(void);
+
+    // incremented on each attitude update, the derived values and
+    // cached conversions are valid for the version they were made at
+    uint32_t _attitude_version;
+    uint32_t _attitude_derived_version;
+
+    // quaternion of the attitude, converted on first use from the main
+    // thread after each update
+    mutable struct {
+        Quaternion quat_body_to_ned;
+        uint32_t version;
+        bool valid;
+    } _attitude_cache;
+
+#if AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+    mutable struct {
+        uint32_t updates;               // calls to update()
+        uint32_t derived_updates;       // derived value recalculations
+        uint32_t quat_requests;         // get_quat_body_to_ned() calls
+        uint32_t quat_conversions;      // matrix to quaternion conversions
+        uint32_t view_trig_reused;      // view updates sharing our trig values
+    } _attitude_cache_stats;
+#endif
+
     // helper trig variables
     float _cos_roll{1.0f};
     float _cos_pitch{1.0f};
@@ -24,6 +24,7 @@
 #include <AP_Baro/AP_Baro.h>
 #include <AP_Compass/AP_Compass.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
+#include <AP_Common/ExpandingString.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -163,6 +164,45 @@ void AP_AHRS::update_cd_values(void)
     rpy_deg[2] = wrap_360(degrees(yaw));  // we are probably already in trouble if this is required
 }
 
+/*
+  update the derived values if the attitude has changed since they
+  were last calculated
+ */
+void AP_AHRS::update_attitude_derived(void)
+{
+#if AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+    _attitude_cache_stats.updates++;
+#endif
+    if (_attitude_derived_version == _attitude_version) {
+        return;
+    }
+    update_cd_values();
+    update_trig();
+    _attitude_derived_version = _attitude_version;
+#if AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+    _attitude_cache_stats.derived_updates++;
+#endif
+}
+
+#if AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+void AP_AHRS::attitude_cache_info(ExpandingString &str) const
+{
+    const auto &s = _attitude_cache_stats;
+    // each attitude change used to recalculate the derived values and
+    // each request used to convert the matrix to a quaternion
+    const uint32_t derived_avoided = _attitude_version - s.derived_updates;
+    const uint32_t quat_avoided = s.quat_requests - s.quat_conversions;
+    const uint32_t avoided = derived_avoided + quat_avoided + s.view_trig_reused;
+
+    str.printf("AttitudeCacheV1\n");
+    str.printf("updates=%u\n", unsigned(s.updates));
+    str.printf("derived updates=%u avoided=%u\n", unsigned(s.derived_updates), unsigned(derived_avoided));
+    str.printf("quat conversions=%u avoided=%u\n", unsigned(s.quat_conversions), unsigned(quat_avoided));
+    str.printf("view trig avoided=%u\n", unsigned(s.view_trig_reused));
+    str.printf("avoided per update=%.2f\n", s.updates > 0 ? double(avoided) / s.updates : 0.0);
+}
+#endif  // AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+
 /*
   create a rotated view of AP_AHRS with optional pitch trim
  */
@@ -21,6 +21,8 @@
 #include "AP_AHRS_View.h"
 #include <stdio.h>
 
+extern const AP_HAL::HAL& hal;
+
 AP_AHRS_View::AP_AHRS_View(AP_AHRS &_ahrs, enum Rotation _rotation, float pitch_trim_deg) :
     rotation(_rotation),
     ahrs(_ahrs)
@@ -62,8 +64,9 @@ void AP_AHRS_View::update()
 {
     rot_body_to_ned = ahrs.get_rotation_body_to_ned();
     gyro = ahrs.get_gyro();
+    quat_valid = false;
 
-    if (!is_zero(y_angle + _pitch_trim_deg)) {
+    if (!same_as_ahrs()) {
         rot_body_to_ned = rot_body_to_ned * rot_view_T;
         gyro = rot_view * gyro;
     }
@@ -77,11 +80,43 @@ void AP_AHRS_View::update()
         yaw_sensor += 36000;
     }
 
+    if (same_as_ahrs()) {
+        // the AHRS has already calculated these from the same matrix
+        trig.cos_roll = ahrs._cos_roll;
+        trig.cos_pitch = ahrs._cos_pitch;
+        trig.cos_yaw = ahrs._cos_yaw;
+        trig.sin_roll = ahrs._sin_roll;
+        trig.sin_pitch = ahrs._sin_pitch;
+        trig.sin_yaw = ahrs._sin_yaw;
+#if AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+        ahrs._attitude_cache_stats.view_trig_reused++;
+#endif
+        return;
+    }
+
     ahrs.calc_trig(rot_body_to_ned,
                    trig.cos_roll, trig.cos_pitch, trig.cos_yaw,
                    trig.sin_roll, trig.sin_pitch, trig.sin_yaw);
 }
 
+// return a Quaternion representing our current attitude in this view
+void AP_AHRS_View::get_quat_body_to_ned(Quaternion &quat) const
+{
+    if (same_as_ahrs()) {
+        ahrs.get_quat_body_to_ned(quat);
+        return;
+    }
+    if (!hal.scheduler->in_main_thread()) {
+        quat.from_rotation_matrix(rot_body_to_ned);
+        return;
+    }
+    if (!quat_valid) {
+        quat_body_to_ned.from_rotation_matrix(rot_body_to_ned);
+        quat_valid = true;
+    }
+    quat = quat_body_to_ned;
+}
+
 // return a smoothed and corrected gyro vector using the latest ins data (which may not have been consumed by the EKF yet)
 Vector3f AP_AHRS_View::get_gyro_latest(void) const {
     return rot_view * ahrs.get_gyro_latest();
@@ -52,9 +52,7 @@ public:
     }
 
     // return a Quaternion representing our current attitude in this view
-    void get_quat_body_to_ned(Quaternion &quat) const {
-        quat.from_rotation_matrix(rot_body_to_ned);
-    }
+    void get_quat_body_to_ned(Quaternion &quat) const;
 
     // apply pitch trim
     void set_pitch_trim(float trim_deg);
@@ -222,4 +220,15 @@ private:
 
     float y_angle;
     float _pitch_trim_deg;
+
+    // true if the view has the same attitude as the AHRS, so the
+    // attitude conversions can be shared with it
+    bool same_as_ahrs(void) const {
+        return is_zero(y_angle + _pitch_trim_deg);
+    }
+
+    // quaternion of the attitude, converted on first use from the main
+    // thread after each update
+    mutable Quaternion quat_body_to_ned;
+    mutable bool quat_valid;
 };
@@ -44,3 +44,8 @@
 #ifndef AP_AHRS_EXTERNAL_WIND_ESTIMATE_ENABLED
 #define AP_AHRS_EXTERNAL_WIND_ESTIMATE_ENABLED (HAL_PROGRAM_SIZE_LIMIT_KB>1024 && AP_AHRS_DCM_ENABLED)
 #endif
+
+// count the attitude conversions avoided by the attitude cache
+#ifndef AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+#define AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_SITL)
+#endif
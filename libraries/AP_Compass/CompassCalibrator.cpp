@@ -208,11 +208,7 @@ void CompassCalibrator::update()
                 set_status(Status::RUNNING_STEP_TWO);
             }
         } else {
-            if (_fit_step == 0) {
-                calc_initial_offset();
-            }
-            run_sphere_fit();
-            _fit_step++;
+            run_step_one_fit();
         }
     } else if (_status == Status::RUNNING_STEP_TWO) {
         if (_fit_step >= 35) {
@@ -221,14 +217,38 @@ void CompassCalibrator::update()
             } else {
                 set_status(Status::FAILED);
             }
-        } else if (_fit_step < 15) {
-            run_sphere_fit();
-            _fit_step++;
         } else {
-            run_ellipsoid_fit();
-            _fit_step++;
+            run_step_two_fit();
+        }
+    }
+}
+
+// step one fits a sphere from each of the starting points, keeping the best
+void CompassCalibrator::run_step_one_fit()
+{
+    if (_fit_step == 0) {
+        init_fit_starts();
+    }
+    for (auto &start : _fit_starts) {
+        if (run_sphere_fit(start.params, start.fitness, start.lambda)) {
+            start.improved = true;
+        }
+    }
+    use_best_fit_start();
+    _fit_step++;
+}
+
+// step two refines the sphere fit and then fits an ellipsoid
+void CompassCalibrator::run_step_two_fit()
+{
+    if (_fit_step < 15) {
+        if (run_sphere_fit(_params, _fitness, _sphere_lambda)) {
+            update_completion_mask();
         }
+    } else {
+        run_ellipsoid_fit();
     }
+    _fit_step++;
 }
 
 void CompassCalibrator::pull_sample()
@@ -567,58 +587,105 @@ bool CompassCalibrator::accept_sample(const CompassSample& sample, uint16_t skip
     return accept_sample(sample.get(), skip_index);
 }
 
-float CompassCalibrator::calc_residual(const Vector3f& sample, const param_t& params) const
-{
-    Matrix3f softiron(
-        params.diag.x    , params.offdiag.x , params.offdiag.y,
-        params.offdiag.x , params.diag.y    , params.offdiag.z,
-        params.offdiag.y , params.offdiag.z , params.diag.z
-    );
-    return params.radius - (softiron*(sample+params.offset)).length();
-}
-
 // calc the fitness given a set of parameters (offsets, diagonals, off diagonals)
 float CompassCalibrator::calc_mean_squared_residuals(const param_t& params) const
 {
     if (_sample_buffer == nullptr || _samples_collected == 0) {
         return 1.0e30f;
     }
+    const Matrix3f softiron = params.get_softiron();
     float sum = 0.0f;
     for (uint16_t i=0; i < _samples_collected; i++) {
         Vector3f sample = _sample_buffer[i].get();
-        float resid = calc_residual(sample, params);
+        float resid = params.radius - (softiron*(sample+params.offset)).length();
         sum += sq(resid);
     }
     sum /= _samples_collected;
     return sum;
 }
 
-// calculate initial offsets by simply taking the average values of the samples
-void CompassCalibrator::calc_initial_offset()
+/*
+  set up the starting points for the step one sphere fit. The first is
+  the mean of the samples with the default radius, which unlike the
+  zero offset used before doesn't get stuck when the samples only cover
+  part of the sphere. When COMPASS_CAL_NUM_FIT_STARTS is raised the
+  others start from the centre of the samples' bounding box and from
+  the mean, both with the mean distance of the samples as the radius
+ */
+void CompassCalibrator::init_fit_starts()
 {
-    // Set initial offset to the average value of the samples
-    _params.offset.zero();
+    Vector3f mean;
+    Vector3f min_sample = _sample_buffer[0].get();
+    Vector3f max_sample = min_sample;
     for (uint16_t k = 0; k < _samples_collected; k++) {
-        _params.offset -= _sample_buffer[k].get();
+        const Vector3f sample = _sample_buffer[k].get();
+        mean += sample;
+        min_sample.x = MIN(min_sample.x, sample.x);
+        min_sample.y = MIN(min_sample.y, sample.y);
+        min_sample.z = MIN(min_sample.z, sample.z);
+        max_sample.x = MAX(max_sample.x, sample.x);
+        max_sample.y = MAX(max_sample.y, sample.y);
+        max_sample.z = MAX(max_sample.z, sample.z);
+    }
+    mean /= _samples_collected;
+
+    const Vector3f centres[] { mean, (min_sample + max_sample) * 0.5f, mean };
+    static_assert(ARRAY_SIZE(centres) >= COMPASS_CAL_NUM_FIT_STARTS, "not enough fit starting points");
+
+    for (uint8_t n = 0; n < ARRAY_SIZE(_fit_starts); n++) {
+        fit_start_t &start = _fit_starts[n];
+        start.params = _params;
+        start.params.offset = -centres[n];
+        if (n > 0) {
+            float radius = 0;
+            for (uint16_t k = 0; k < _samples_collected; k++) {
+                radius += (_sample_buffer[k].get() - centres[n]).length();
+            }
+            start.params.radius = radius / _samples_collected;
+        }
+        start.fitness = calc_mean_squared_residuals(start.params);
+        start.lambda = 1.0f;
+        start.improved = false;
+    }
+}
+
+/*
+  make the best of the step one starting points the current fit. A
+  start is only used once a sphere fit step has improved on it, so
+  _fitness only changes when a fit step succeeded and the step one
+  divergence check against _initial_fitness still works
+ */
+void CompassCalibrator::use_best_fit_start()
+{
+    const fit_start_t *best = nullptr;
+    for (const auto &start : _fit_starts) {
+        if (start.improved && (best == nullptr || start.fitness < best->fitness)) {
+            best = &start;
+        }
+    }
+    if (best != nullptr && best->fitness < _fitness) {
+        _params = best->params;
+        _fitness = best->fitness;
+        _sphere_lambda = best->lambda;
+        update_completion_mask();
     }
-    _params.offset /= _samples_collected;
 }
 
-void CompassCalibrator::calc_sphere_jacob(const Vector3f& sample, const param_t& params, float* ret) const
+/*
+  calculate the sphere fit jacobian for a sample, returning the
+  residual. The residual and jacobian share the soft iron corrected
+  sample
+ */
+float CompassCalibrator::calc_sphere_jacob(const Vector3f& sample, const param_t& params, float* ret) const
 {
     const Vector3f &offset = params.offset;
     const Vector3f &diag = params.diag;
     const Vector3f &offdiag = params.offdiag;
-    Matrix3f softiron(
-        diag.x    , offdiag.x , offdiag.y,
-        offdiag.x , diag.y    , offdiag.z,
-        offdiag.y , offdiag.z , diag.z
-    );
 
     float A =  (diag.x    * (sample.x + offset.x)) + (offdiag.x * (sample.y + offset.y)) + (offdiag.y * (sample.z + offset.z));
     float B =  (offdiag.x * (sample.x + offset.x)) + (diag.y    * (sample.y + offset.y)) + (offdiag.z * (sample.z + offset.z));
     float C =  (offdiag.y * (sample.x + offset.x)) + (offdiag.z * (sample.y + offset.y)) + (diag.z    * (sample.z + offset.z));
-    float length = (softiron*(sample+offset)).length();
+    float length = norm(A, B, C);
 
     // 0: partial derivative (radius wrt fitness fn) fn operated on sample
     ret[0] = 1.0f;
@@ -626,59 +693,78 @@ void CompassCalibrator::calc_sphere_jacob(const Vector3f& sample, const param_t&
     ret[1] = -1.0f * (((diag.x    * A) + (offdiag.x * B) + (offdiag.y * C))/length);
     ret[2] = -1.0f * (((offdiag.x * A) + (diag.y    * B) + (offdiag.z * C))/length);
     ret[3] = -1.0f * (((offdiag.y * A) + (offdiag.z * B) + (diag.z    * C))/length);
+
+    return params.radius - length;
+}
+
+/*
+  accumulate the normal equations J^T.J and J^T.r over all samples for
+  a jacobian with N parameters. Only the upper triangle of the
+  symmetric J^T.J is accumulated, then it is mirrored
+ */
+template <uint8_t N>
+void CompassCalibrator::calc_normal_equations(float (CompassCalibrator::*jacob_fn)(const Vector3f&, const param_t&, float*) const,
+                                              const param_t& params, float *JTJ, float *JTFI) const
+{
+    for (uint16_t k = 0; k<_samples_collected; k++) {
+        const Vector3f sample = _sample_buffer[k].get();
+
+        float jacob[N];
+        const float resid = (this->*jacob_fn)(sample, params, jacob);
+
+        for (uint8_t i = 0; i < N; i++) {
+            const float ji = jacob[i];
+            float *row = &JTJ[i*N];
+            for (uint8_t j = i; j < N; j++) {
+                row[j] += ji * jacob[j];
+            }
+            JTFI[i] += ji * resid;
+        }
+    }
+    for (uint8_t i = 1; i < N; i++) {
+        for (uint8_t j = 0; j < i; j++) {
+            JTJ[i*N+j] = JTJ[j*N+i];
+        }
+    }
 }
 
-// run sphere fit to calculate diagonals and offdiagonals
-void CompassCalibrator::run_sphere_fit()
+// run sphere fit to calculate radius and offsets, returns true if the fitness improved
+bool CompassCalibrator::run_sphere_fit(param_t &params, float &current_fitness, float &lambda) const
 {
     if (_sample_buffer == nullptr) {
-        return;
+        return false;
     }
 
     const float lma_damping = 10.0f;
 
     // take backup of fitness and parameters so we can determine later if this fit has improved the calibration
-    float fitness = _fitness;
+    float fitness = current_fitness;
     float fit1, fit2;
     param_t fit1_params, fit2_params;
-    fit1_params = fit2_params = _params;
+    fit1_params = fit2_params = params;
 
     float JTJ[COMPASS_CAL_NUM_SPHERE_PARAMS*COMPASS_CAL_NUM_SPHERE_PARAMS] = { };
-    float JTJ2[COMPASS_CAL_NUM_SPHERE_PARAMS*COMPASS_CAL_NUM_SPHERE_PARAMS] = { };
+    float JTJ2[COMPASS_CAL_NUM_SPHERE_PARAMS*COMPASS_CAL_NUM_SPHERE_PARAMS];
     float JTFI[COMPASS_CAL_NUM_SPHERE_PARAMS] = { };
 
     // Gauss Newton Part common for all kind of extensions including LM
-    for (uint16_t k = 0; k<_samples_collected; k++) {
-        Vector3f sample = _sample_buffer[k].get();
-
-        float sphere_jacob[COMPASS_CAL_NUM_SPHERE_PARAMS];
-
-        calc_sphere_jacob(sample, fit1_params, sphere_jacob);
-
-        for (uint8_t i = 0;i < COMPASS_CAL_NUM_SPHERE_PARAMS; i++) {
-            // compute JTJ
-            for (uint8_t j = 0; j < COMPASS_CAL_NUM_SPHERE_PARAMS; j++) {
-                JTJ[i*COMPASS_CAL_NUM_SPHERE_PARAMS+j] += sphere_jacob[i] * sphere_jacob[j];
-                JTJ2[i*COMPASS_CAL_NUM_SPHERE_PARAMS+j] += sphere_jacob[i] * sphere_jacob[j];   //a backup JTJ for LM
-            }
-            // compute JTFI
-            JTFI[i] += sphere_jacob[i] * calc_residual(sample, fit1_params);
-        }
-    }
+    calc_normal_equations<COMPASS_CAL_NUM_SPHERE_PARAMS>(&CompassCalibrator::calc_sphere_jacob, fit1_params, JTJ, JTFI);
+    // a backup JTJ for LM
+    memcpy(JTJ2, JTJ, sizeof(JTJ2));
 
     //------------------------Levenberg-Marquardt-part-starts-here---------------------------------//
     // refer: http://en.wikipedia.org/wiki/Levenberg%E2%80%93Marquardt_algorithm#Choice_of_damping_parameter
     for (uint8_t i = 0; i < COMPASS_CAL_NUM_SPHERE_PARAMS; i++) {
-        JTJ[i*COMPASS_CAL_NUM_SPHERE_PARAMS+i] += _sphere_lambda;
-        JTJ2[i*COMPASS_CAL_NUM_SPHERE_PARAMS+i] += _sphere_lambda/lma_damping;
+        JTJ[i*COMPASS_CAL_NUM_SPHERE_PARAMS+i] += lambda;
+        JTJ2[i*COMPASS_CAL_NUM_SPHERE_PARAMS+i] += lambda/lma_damping;
     }
 
     if (!mat_inverse(JTJ, JTJ, 4)) {
-        return;
+        return false;
     }
 
     if (!mat_inverse(JTJ2, JTJ2, 4)) {
-        return;
+        return false;
     }
 
     // extract radius, offset, diagonals and offdiagonal parameters
@@ -694,42 +780,39 @@ void CompassCalibrator::run_sphere_fit()
     fit2 = calc_mean_squared_residuals(fit2_params);
 
     // decide which of the two sets of parameters is best and store in fit1_params
-    if (fit1 > _fitness && fit2 > _fitness) {
+    if (fit1 > current_fitness && fit2 > current_fitness) {
         // if neither set of parameters provided better results, increase lambda
-        _sphere_lambda *= lma_damping;
-    } else if (fit2 < _fitness && fit2 < fit1) {
+        lambda *= lma_damping;
+    } else if (fit2 < current_fitness && fit2 < fit1) {
         // if fit2 was better we will use it. decrease lambda
-        _sphere_lambda /= lma_damping;
+        lambda /= lma_damping;
         fit1_params = fit2_params;
         fitness = fit2;
-    } else if (fit1 < _fitness) {
+    } else if (fit1 < current_fitness) {
         fitness = fit1;
     }
     //--------------------Levenberg-Marquardt-part-ends-here--------------------------------//
 
     // store new parameters and update fitness
-    if (!isnan(fitness) && fitness < _fitness) {
-        _fitness = fitness;
-        _params = fit1_params;
-        update_completion_mask();
+    if (!isnan(fitness) && fitness < current_fitness) {
+        current_fitness = fitness;
+        params = fit1_params;
+        return true;
     }
+    return false;
 }
 
-void CompassCalibrator::calc_ellipsoid_jacob(const Vector3f& sample, const param_t& params, float* ret) const
+// calculate the ellipsoid fit jacobian for a sample, returning the residual
+float CompassCalibrator::calc_ellipsoid_jacob(const Vector3f& sample, const param_t& params, float* ret) const
 {
     const Vector3f &offset = params.offset;
     const Vector3f &diag = params.diag;
     const Vector3f &offdiag = params.offdiag;
-    Matrix3f softiron(
-        diag.x    , offdiag.x , offdiag.y,
-        offdiag.x , diag.y    , offdiag.z,
-        offdiag.y , offdiag.z , diag.z
-    );
 
     float A =  (diag.x    * (sample.x + offset.x)) + (offdiag.x * (sample.y + offset.y)) + (offdiag.y * (sample.z + offset.z));
     float B =  (offdiag.x * (sample.x + offset.x)) + (diag.y    * (sample.y + offset.y)) + (offdiag.z * (sample.z + offset.z));
     float C =  (offdiag.y * (sample.x + offset.x)) + (offdiag.z * (sample.y + offset.y)) + (diag.z    * (sample.z + offset.z));
-    float length = (softiron*(sample+offset)).length();
+    float length = norm(A, B, C);
 
     // 0-2: partial derivative (offset wrt fitness fn) fn operated on sample
     ret[0] = -1.0f * (((diag.x    * A) + (offdiag.x * B) + (offdiag.y * C))/length);
@@ -743,6 +826,8 @@ void CompassCalibrator::calc_ellipsoid_jacob(const Vector3f& sample, const param
     ret[6] = -1.0f * (((sample.y + offset.y) * A) + ((sample.x + offset.x) * B))/length;
     ret[7] = -1.0f * (((sample.z + offset.z) * A) + ((sample.x + offset.x) * C))/length;
     ret[8] = -1.0f * (((sample.z + offset.z) * B) + ((sample.y + offset.y) * C))/length;
+
+    return params.radius - length;
 }
 
 void CompassCalibrator::run_ellipsoid_fit()
@@ -760,27 +845,12 @@ void CompassCalibrator::run_ellipsoid_fit()
     fit1_params = fit2_params = _params;
 
     float JTJ[COMPASS_CAL_NUM_ELLIPSOID_PARAMS*COMPASS_CAL_NUM_ELLIPSOID_PARAMS] = { };
-    float JTJ2[COMPASS_CAL_NUM_ELLIPSOID_PARAMS*COMPASS_CAL_NUM_ELLIPSOID_PARAMS] = { };
+    float JTJ2[COMPASS_CAL_NUM_ELLIPSOID_PARAMS*COMPASS_CAL_NUM_ELLIPSOID_PARAMS];
     float JTFI[COMPASS_CAL_NUM_ELLIPSOID_PARAMS] = { };
 
     // Gauss Newton Part common for all kind of extensions including LM
-    for (uint16_t k = 0; k<_samples_collected; k++) {
-        Vector3f sample = _sample_buffer[k].get();
-
-        float ellipsoid_jacob[COMPASS_CAL_NUM_ELLIPSOID_PARAMS];
-
-        calc_ellipsoid_jacob(sample, fit1_params, ellipsoid_jacob);
-
-        for (uint8_t i = 0;i < COMPASS_CAL_NUM_ELLIPSOID_PARAMS; i++) {
-            // compute JTJ
-            for (uint8_t j = 0; j < COMPASS_CAL_NUM_ELLIPSOID_PARAMS; j++) {
-                JTJ [i*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+j] += ellipsoid_jacob[i] * ellipsoid_jacob[j];
-                JTJ2[i*COMPASS_CAL_NUM_ELLIPSOID_PARAMS+j] += ellipsoid_jacob[i] * ellipsoid_jacob[j];
-            }
-            // compute JTFI
-            JTFI[i] += ellipsoid_jacob[i] * calc_residual(sample, fit1_params);
-        }
-    }
+    calc_normal_equations<COMPASS_CAL_NUM_ELLIPSOID_PARAMS>(&CompassCalibrator::calc_ellipsoid_jacob, fit1_params, JTJ, JTFI);
+    memcpy(JTJ2, JTJ, sizeof(JTJ2));
 
     //------------------------Levenberg-Marquardt-part-starts-here---------------------------------//
     //refer: http://en.wikipedia.org/wiki/Levenberg%E2%80%93Marquardt_algorithm#Choice_of_damping_parameter
@@ -1063,7 +1133,9 @@ bool CompassCalibrator::calculate_orientation(void)
     // re-run the fit to get the diagonals and off-diagonals for the
     // new orientation
     initialize_fit();
-    run_sphere_fit();
+    if (run_sphere_fit(_params, _fitness, _sphere_lambda)) {
+        update_completion_mask();
+    }
     run_ellipsoid_fit();
 
     return fit_acceptable();
@@ -9,8 +9,13 @@
 #define COMPASS_CAL_NUM_SPHERE_PARAMS       4
 #define COMPASS_CAL_NUM_ELLIPSOID_PARAMS    9
 #define COMPASS_CAL_NUM_SAMPLES             300     // number of samples required before fitting begins
+#ifndef COMPASS_CAL_NUM_FIT_STARTS
+#define COMPASS_CAL_NUM_FIT_STARTS          1       // number of starting points tried by the step one sphere fit, up to 3
+#endif
 
 class CompassCalibrator {
+    friend class CompassCalibrator_fit_test;
+
 public:
     CompassCalibrator();
 
@@ -116,6 +121,14 @@ private:
             return &offset.x;
         }
 
+        Matrix3f get_softiron() const {
+            return Matrix3f(
+                diag.x    , offdiag.x , offdiag.y,
+                offdiag.x , diag.y    , offdiag.z,
+                offdiag.y , offdiag.z , diag.z
+            );
+        }
+
         float radius;       // magnetic field strength calculated from samples
         Vector3f offset;    // offsets
         Vector3f diag;      // diagonal scaling
@@ -171,22 +184,29 @@ private:
     // thins out samples between step one and step two
     void thin_samples();
 
-    // calc the fitness of a single sample vs a set of parameters (offsets, diagonals, off diagonals)
-    float calc_residual(const Vector3f& sample, const param_t& params) const;
-
     // calc the fitness of the parameters (offsets, diagonals, off diagonals) vs all the samples collected
     // returns 1.0e30f if the sample buffer is empty
     float calc_mean_squared_residuals(const param_t& params) const;
 
-    // calculate initial offsets by simply taking the average values of the samples
-    void calc_initial_offset();
+    // run one iteration of the step one and step two fits
+    void run_step_one_fit();
+    void run_step_two_fit();
 
-    // run sphere fit to calculate diagonals and offdiagonals
-    void calc_sphere_jacob(const Vector3f& sample, const param_t& params, float* ret) const;
-    void run_sphere_fit();
+    // set up the step one starting points and pick the best of them
+    void init_fit_starts();
+    void use_best_fit_start();
 
-    // run ellipsoid fit to calculate diagonals and offdiagonals
-    void calc_ellipsoid_jacob(const Vector3f& sample, const param_t& params, float* ret) const;
+    // accumulate the normal equations of a fit over all the samples
+    template <uint8_t N>
+    void calc_normal_equations(float (CompassCalibrator::*jacob_fn)(const Vector3f&, const param_t&, float*) const,
+                               const param_t& params, float *JTJ, float *JTFI) const;
+
+    // run sphere fit to calculate radius and offsets, jacobian returns the residual
+    float calc_sphere_jacob(const Vector3f& sample, const param_t& params, float* ret) const;
+    bool run_sphere_fit(param_t &params, float &current_fitness, float &lambda) const;
+
+    // run ellipsoid fit to calculate diagonals and offdiagonals, jacobian returns the residual
+    float calc_ellipsoid_jacob(const Vector3f& sample, const param_t& params, float* ret) const;
     void run_ellipsoid_fit();
 
     // update the completion mask based on a single sample
@@ -235,6 +255,14 @@ private:
     float _sphere_lambda;                   // sphere fit's lambda
     float _ellipsoid_lambda;                // ellipsoid fit's lambda
 
+    // step one sphere fit starting points, the best is copied to _params after each step
+    struct fit_start_t {
+        param_t params;
+        float fitness;
+        float lambda;
+        bool improved;                      // true once a sphere fit step has improved on the starting point
+    } _fit_starts[COMPASS_CAL_NUM_FIT_STARTS];
+
     // variables for orientation checking
     enum Rotation _orientation;             // latest detected orientation
     enum Rotation _orig_orientation;        // original orientation provided by caller
@@ -0,0 +1,193 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  run the compass calibration fit over recorded sample sets, reporting
+  the time taken and the resulting fitness against the known
+  calibration used to generate the samples, and the cost and fitness
+  of step one from the step one starting points against step one from
+  the default parameters, as it ran before the starting points
+ */
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Compass/CompassCalibrator.h>
+
+void setup();
+void loop();
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#define STEP_ONE_STEPS 10
+
+/*
+  drive the calibrator's fits directly over a recorded set of samples,
+  skipping the sample acceptance, orientation and radius checks
+ */
+class CompassCalibrator_fit_test {
+public:
+    static bool load(CompassCalibrator &cal, const Vector3f *samples, uint16_t count);
+    static bool fit(CompassCalibrator &cal, float &fitness, Vector3f &ofs, Vector3f &diag, Vector3f &offdiag);
+    static uint32_t step_one_us(CompassCalibrator &cal, bool old_start, float &fitness);
+};
+
+bool CompassCalibrator_fit_test::load(CompassCalibrator &cal, const Vector3f *samples, uint16_t count)
+{
+    if (cal._sample_buffer == nullptr) {
+        cal._sample_buffer = (CompassCalibrator::CompassSample*)calloc(COMPASS_CAL_NUM_SAMPLES, sizeof(CompassCalibrator::CompassSample));
+        if (cal._sample_buffer == nullptr) {
+            return false;
+        }
+    }
+    cal.reset_state();
+    for (uint16_t i = 0; i < MIN(count, COMPASS_CAL_NUM_SAMPLES); i++) {
+        cal._sample_buffer[cal._samples_collected++].set(samples[i]);
+    }
+    cal.initialize_fit();
+    return cal._samples_collected != 0;
+}
+
+// run step one and step two to completion, returns false if the fit diverged
+bool CompassCalibrator_fit_test::fit(CompassCalibrator &cal, float &fitness, Vector3f &ofs, Vector3f &diag, Vector3f &offdiag)
+{
+    while (cal._fit_step < 10) {
+        cal.run_step_one_fit();
+    }
+    if (is_equal(cal._fitness, cal._initial_fitness) || isnan(cal._fitness)) {
+        return false;
+    }
+
+    cal.thin_samples();
+    cal.initialize_fit();
+    while (cal._fit_step < 35) {
+        cal.run_step_two_fit();
+    }
+
+    fitness = cal._fitness;
+    ofs = cal._params.offset;
+    diag = cal._params.diag;
+    offdiag = cal._params.offdiag;
+    return !isnan(cal._fitness);
+}
+
+/*
+  average time of a step one fit step, either from the starting points
+  or as a single sphere fit from the default parameters as before they
+  were added
+ */
+uint32_t CompassCalibrator_fit_test::step_one_us(CompassCalibrator &cal, bool old_start, float &fitness)
+{
+    const uint32_t start_us = AP_HAL::micros();
+    for (uint8_t i = 0; i < STEP_ONE_STEPS; i++) {
+        if (!old_start) {
+            cal.run_step_one_fit();
+        } else if (cal.run_sphere_fit(cal._params, cal._fitness, cal._sphere_lambda)) {
+            cal.update_completion_mask();
+        }
+    }
+    const uint32_t dt_us = AP_HAL::micros() - start_us;
+    fitness = cal._fitness;
+    return dt_us / STEP_ONE_STEPS;
+}
+
+static CompassCalibrator cal;
+
+static const struct {
+    const char *name;
+    float radius;
+    Vector3f offset;
+    Vector3f diag;
+    Vector3f offdiag;
+    float max_pitch_deg;    // limits the coverage of the sphere
+    float max_yaw_deg;
+    float noise;
+} sample_sets[] = {
+    { "small offsets",   450, Vector3f(30, -20, 15),    Vector3f(1, 1, 1),          Vector3f(0, 0, 0),           90, 180, 2 },
+    { "large offsets",   300, Vector3f(-400, 250, 600), Vector3f(1.05, 0.95, 1.1),  Vector3f(0.02, -0.03, 0.01), 90, 180, 5 },
+    { "partial sphere",  500, Vector3f(150, 90, -220),  Vector3f(0.9, 1.1, 1.0),    Vector3f(-0.05, 0.02, 0.04), 35, 180, 5 },
+    // a large offset with only one side of the sphere covered, step one from a zero offset stalls far from the fit
+    { "one side",        480, Vector3f(560, 550, -580), Vector3f(1, 1, 1),          Vector3f(0, 0, 0),           60,  70, 5 },
+};
+
+static Vector3f samples[COMPASS_CAL_NUM_SAMPLES];
+
+// repeatable noise so runs can be compared
+static float noise(uint32_t &seed)
+{
+    seed = seed * 1103515245U + 12345U;
+    return ((seed >> 8) & 0xFFFF) / 32768.0f - 1.0f;
+}
+
+// generate samples the calibration should map back onto a sphere
+static void make_samples(const Vector3f &offset, const Vector3f &diag, const Vector3f &offdiag,
+                         float radius, float max_pitch_deg, float max_yaw_deg, float amplitude)
+{
+    Matrix3f softiron(
+        diag.x    , offdiag.x , offdiag.y,
+        offdiag.x , diag.y    , offdiag.z,
+        offdiag.y , offdiag.z , diag.z
+    );
+    Matrix3f inv;
+    if (!softiron.inverse(inv)) {
+        return;
+    }
+    uint32_t seed = 1;
+    for (uint16_t i = 0; i < COMPASS_CAL_NUM_SAMPLES; i++) {
+        const float yaw = radians(noise(seed) * max_yaw_deg);
+        const float pitch = radians(noise(seed) * max_pitch_deg);
+        const Vector3f field(cosf(pitch) * cosf(yaw), cosf(pitch) * sinf(yaw), sinf(pitch));
+        const Vector3f n(noise(seed), noise(seed), noise(seed));
+        samples[i] = inv * (field * radius) - offset + n * amplitude;
+    }
+}
+
+void setup(void)
+{
+    hal.console->begin(115200);
+    hal.console->printf("\n\ncompass calibration fit test\n\n");
+
+    for (const auto &set : sample_sets) {
+        make_samples(set.offset, set.diag, set.offdiag, set.radius, set.max_pitch_deg, set.max_yaw_deg, set.noise);
+
+        float fitness = 0;
+        Vector3f ofs, diag, offdiag;
+        bool ok = CompassCalibrator_fit_test::load(cal, samples, ARRAY_SIZE(samples));
+        const uint32_t start_us = AP_HAL::micros();
+        ok = ok && CompassCalibrator_fit_test::fit(cal, fitness, ofs, diag, offdiag);
+        const uint32_t dt_us = AP_HAL::micros() - start_us;
+
+        hal.console->printf("%s: %s in %u us fitness %.3f\n",
+                            set.name, ok ? "fitted" : "FAILED", (unsigned)dt_us, fitness);
+        hal.console->printf("  ofs %.1f %.1f %.1f (err %.1f)\n",
+                            ofs.x, ofs.y, ofs.z, (ofs - set.offset).length());
+        hal.console->printf("  diag %.3f %.3f %.3f offdiag %.3f %.3f %.3f\n",
+                            diag.x, diag.y, diag.z, offdiag.x, offdiag.y, offdiag.z);
+
+        float multi_fitness = 0;
+        float old_fitness = 0;
+        CompassCalibrator_fit_test::load(cal, samples, ARRAY_SIZE(samples));
+        const uint32_t multi_us = CompassCalibrator_fit_test::step_one_us(cal, false, multi_fitness);
+        CompassCalibrator_fit_test::load(cal, samples, ARRAY_SIZE(samples));
+        const uint32_t old_us = CompassCalibrator_fit_test::step_one_us(cal, true, old_fitness);
+
+        hal.console->printf("  step one: %u starts %u us/step fitness %.3f, old start %u us/step fitness %.3f\n",
+                            COMPASS_CAL_NUM_FIT_STARTS, (unsigned)multi_us, multi_fitness,
+                            (unsigned)old_us, old_fitness);
+    }
+
+    hal.console->printf("fit tests done\n\n");
+}
+
+void loop(void) {}
+
+AP_HAL_MAIN();
@@ -26,6 +26,10 @@
 #include <AP_CANManager/AP_CANManager.h>
 #include <AP_Scheduler/AP_Scheduler.h>
 #include <AP_Common/ExpandingString.h>
+#include <AP_Scripting/AP_Scripting.h>
+#include <AP_InertialSensor/AP_InertialSensor.h>
+#include <AP_InertialSensor/AP_InertialSensor_rate_config.h>
+#include <AP_AHRS/AP_AHRS.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -52,9 +56,21 @@ static const SysFileList sysfs_file_list[] = {
 #endif
     {"crash_dump.bin"},
     {"storage.bin"},
+#if AP_SCRIPTING_PROFILER_ENABLED
+    {"scripts_profile.txt"},
+#endif
+#if AP_SCRIPTING_RUN_STATS_ENABLED
+    {"scripts.txt"},
+#endif
 #if AP_FILESYSTEM_SYS_FLASH_ENABLED
     {"flash.bin"},
 #endif
+#if AP_INERTIALSENSOR_FAST_SAMPLE_WINDOW_ENABLED
+    {"timing.txt"},
+#endif
+#if AP_AHRS_ENABLED && AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+    {"ahrs_cache.txt"},
+#endif
 };
 
 int8_t AP_Filesystem_Sys::file_in_sysfs(const char *fname) {
@@ -155,6 +171,26 @@ int AP_Filesystem_Sys::open(const char *fname, int flags, bool allow_absolute_pa
             r.str->set_buffer((char*)ptr, size, size);
         }
     }
+#if AP_SCRIPTING_PROFILER_ENABLED
+    if (strcmp(fname, "scripts_profile.txt") == 0) {
+        AP::scripting()->profile_info(*r.str);
+    }
+#endif
+#if AP_SCRIPTING_RUN_STATS_ENABLED
+    if (strcmp(fname, "scripts.txt") == 0) {
+        AP::scripting()->run_stats_info(*r.str);
+    }
+#endif
+#if AP_INERTIALSENSOR_FAST_SAMPLE_WINDOW_ENABLED
+    if (strcmp(fname, "timing.txt") == 0) {
+        AP::ins().rate_loop_timing_info(*r.str);
+    }
+#endif
+#if AP_AHRS_ENABLED && AP_AHRS_ATTITUDE_CACHE_STATS_ENABLED
+    if (strcmp(fname, "ahrs_cache.txt") == 0) {
+        AP::ahrs().attitude_cache_info(*r.str);
+    }
+#endif
 #if AP_FILESYSTEM_SYS_FLASH_ENABLED
     if (strcmp(fname, "flash.bin") == 0) {
         void *ptr = (void*)0x08000000;
@@ -768,7 +768,7 @@ uint32_t AP_Frsky_SPort_Passthrough::calc_wind(void)
         v = ahrs.wind_estimate();
     }
     // wind angle in 3 degree increments 0,360 (unsigned)
-    uint32_t value = prep_number(roundf(wrap_360(degrees(atan2f(-v.y, -v.x))) * (1.0f/3.0f)), 2, 0);
+    uint32_t value = prep_number(roundf(wrap_360(degrees(fast_atan2f(-v.y, -v.x))) * (1.0f/3.0f)), 2, 0);
     // wind speed in dm/s
     value |= prep_number(roundf(v.length() * 10), 2, 1) << WIND_SPEED_OFFSET;
 #else
@@ -372,6 +372,13 @@ public:
 
     virtual void timer_info(ExpandingString &str) {}
 
+    /*
+      time in microseconds that outputs were last sent to the ESCs, or
+      zero if not known. Outputs pushed from the main or rate thread
+      may be sent later from an output thread
+    */
+    virtual uint32_t get_last_output_us() const { return 0; }
+
     /*
       Can this driver handle gpio as well as RC
     */
@@ -768,6 +768,7 @@ void RCOutput::push_local(void)
 
     uint16_t widest_pulse = 0;
     uint8_t need_trigger = 0;
+    bool pwm_written = false;
 
     bool safety_on = hal.util->safety_switch_state() == AP_HAL::Util::SAFETY_DISARMED;
     for (auto &group : pwm_group_list) {
@@ -800,16 +801,19 @@ void RCOutput::push_local(void)
                                (_esc_pwm_max - _esc_pwm_min), (period_us - _esc_pwm_min));
                     }
                     pwmEnableChannel(group.pwm_drv, j, period_us);
+                    pwm_written = true;
                 } else if (group.current_mode == MODE_PWM_ONESHOT125) {
                     // this gives us a width in 125 ns increments, giving 1000 steps over the 125 to 250 range
                     uint32_t width = ((group.pwm_cfg.frequency/1000000U) * period_us) / 8U;
                     pwmEnableChannel(group.pwm_drv, j, width);
                     // scale the period down so we don't delay for longer than we need to
                     period_us /= 8;
+                    pwm_written = true;
                 }
                 else if (group.current_mode < MODE_PWM_DSHOT150) {
                     uint32_t width = (group.pwm_cfg.frequency/1000000U) * period_us;
                     pwmEnableChannel(group.pwm_drv, j, width);
+                    pwm_written = true;
                 }
 #if HAL_DSHOT_ENABLED
                 else if (is_dshot_protocol(group.current_mode) || is_led_protocol(group.current_mode)) {
@@ -842,6 +846,11 @@ void RCOutput::push_local(void)
     if (trigger_groupmask) {
         trigger_groups();
     }
+
+    if (pwm_written) {
+        // DShot frames are timestamped when they are sent
+        _last_output_us = AP_HAL::micros();
+    }
 }
 
 uint16_t RCOutput::read(uint8_t chan)
@@ -1489,6 +1498,7 @@ void RCOutput::dshot_send_groups(rcout_timer_t cycle_start_us, rcout_timer_t tim
     }
 
     bool command_sent = false;
+    bool any_pulse_sent = false;
     // queue up a command if there is one
     if (_dshot_current_command.cycle == 0
         && _dshot_command_queue.pop(_dshot_current_command)) {
@@ -1507,6 +1517,7 @@ void RCOutput::dshot_send_groups(rcout_timer_t cycle_start_us, rcout_timer_t tim
             dshot_send(group, cycle_start_us, timeout_period_us);
             pulse_sent = true;
         }
+        any_pulse_sent |= pulse_sent;
 #if defined(HAL_WITH_BIDIR_DSHOT) && defined(HAL_TIM_UP_SHARED)
         // prevent the next send going out until the previous send has released its DMA channel
         if (pulse_sent && group.shared_up_dma && group.bdshot.enabled) {
@@ -1520,6 +1531,10 @@ void RCOutput::dshot_send_groups(rcout_timer_t cycle_start_us, rcout_timer_t tim
     if (command_sent) {
         _dshot_current_command.cycle--;
     }
+
+    if (any_pulse_sent) {
+        _last_output_us = AP_HAL::micros();
+    }
 #endif // HAL_DSHOT_ENABLED
 }
 
@@ -302,6 +302,8 @@ public:
      */
     void timer_info(ExpandingString &str) override;
 
+    uint32_t get_last_output_us() const override { return _last_output_us; }
+
 private:
     enum class DshotState {
       IDLE = 0,
@@ -648,6 +650,9 @@ private:
 
     volatile bool _initialised;
 
+    // time PWM outputs were last written or DShot frames last sent
+    volatile uint32_t _last_output_us;
+
     bool is_bidir_dshot_enabled(const pwm_group& group) const { return (_bdshot.mask & group.ch_mask) != 0; }
 
     static bool is_dshot_send_allowed(DshotState state) {
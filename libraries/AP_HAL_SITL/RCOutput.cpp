@@ -96,6 +96,7 @@ void RCOutput::push(void)
     if (_corked) {
         memcpy(_sitlState->pwm_output, _pending, SITL_NUM_CHANNELS * sizeof(uint16_t));
         _corked = false;
+        _last_output_us = AP_HAL::micros();
     }
 
     SITL::SIM *sitl = AP::sitl();
@@ -19,6 +19,8 @@ public:
     void cork(void) override;
     void push(void) override;
 
+    uint32_t get_last_output_us() const override { return _last_output_us; }
+
     /*
       force the safety switch on, disabling PWM output from the IO board
      */
@@ -52,6 +54,7 @@ private:
     uint16_t _freq_hz;
     uint32_t _enable_mask;
     bool _corked;
+    uint32_t _last_output_us;
     uint16_t _pending[SITL_NUM_CHANNELS];
 
     AP_HAL::Util::safety_state safety_state = AP_HAL::Util::safety_state::SAFETY_DISARMED;
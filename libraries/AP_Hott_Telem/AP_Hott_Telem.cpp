@@ -289,7 +289,7 @@ void AP_Hott_Telem::send_GPS(void)
     msg.gps_fix_char = gps.status_onechar();
     msg.free_char3 = msg.gps_fix_char;
 
-    msg.home_direction = degrees(atan2f(home_vec.y, home_vec.x)) * 0.5 + 0.5;
+    msg.home_direction = degrees(fast_atan2f(home_vec.y, home_vec.x)) * 0.5 + 0.5;
 
 #if AP_RTC_ENABLED
     AP_RTC &rtc = AP::rtc();
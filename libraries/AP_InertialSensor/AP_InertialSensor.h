@@ -10,6 +10,7 @@
 #include <AP_HAL/AP_HAL_Boards.h>
 
 #include <stdint.h>
+#include <atomic>
 
 #include <AP_AccelCal/AP_AccelCal.h>
 #include <AP_HAL/utility/RingBuffer.h>
@@ -51,6 +52,8 @@ class AP_InertialSensor : AP_AccelCal_Client
 {
     friend class AP_InertialSensor_Backend;
     friend class FastRateBuffer;
+    friend class AP_InertialSensor_Test;
+    friend class AP_InertialSensor_Benchmark;
 
 public:
     AP_InertialSensor();
@@ -386,6 +389,7 @@ public:
             BATCH_OPT_SENSOR_RATE = (1<<0),
             BATCH_OPT_POST_FILTER = (1<<1),
             BATCH_OPT_PRE_POST_FILTER = (1<<2),
+            BATCH_OPT_STREAM = (1<<3),
         };
 
         void rotate_to_next_sensor();
@@ -397,6 +401,46 @@ public:
         // Logging functions
         bool Write_ISBH(const float sample_rate_hz) const;
         bool Write_ISBD() const;
+        bool Write_ISBH(uint16_t seqno, IMU_SENSOR_TYPE sensor_type, uint8_t sensor_instance, uint16_t mul,
+                        uint16_t sample_count, uint64_t sample_us, float sample_rate_hz) const;
+        bool Write_ISBD(uint16_t isb_seqno, uint16_t seqno, const int16_t *x, const int16_t *y, const int16_t *z) const;
+
+        /*
+          streaming capture of every sensor in the mask. Each sensor
+          has two blocks of samples, the backend fills one while the
+          main thread writes the other to the log as a complete batch
+         */
+        class Stream {
+        public:
+            int16_t x[2][INS_BATCH_STREAM_BLOCK_SAMPLES];
+            int16_t y[2][INS_BATCH_STREAM_BLOCK_SAMPLES];
+            int16_t z[2][INS_BATCH_STREAM_BLOCK_SAMPLES];
+            uint64_t start_us[2];
+            // set by the backend when a block is complete, cleared by the main thread once it is logged
+            std::atomic<bool> full[2];
+            uint16_t fill_count;
+            uint8_t fill_block;
+            uint8_t read_block;
+            // next ISBD of read_block to write, the ISBH is sent before the first one
+            uint8_t read_msg;
+            uint16_t seqno;
+            uint16_t multiplier;
+            // free running counts updated by the backend
+            uint32_t samples;
+            uint32_t drops;
+            // counts at the last ISBS message
+            uint32_t last_samples;
+            uint32_t last_drops;
+        };
+        Stream *streams[INS_MAX_INSTANCES][2];
+        bool streaming;
+        uint32_t last_stream_stats_ms;
+
+        bool init_streaming();
+        void stream_sample(uint8_t instance, IMU_SENSOR_TYPE type, uint64_t sample_us, const Vector3f &sample) __RAMFUNC__;
+        void push_stream_data_to_log();
+        bool push_stream_block(Stream &stream, uint8_t sensor_instance, IMU_SENSOR_TYPE sensor_type);
+        void write_stream_stats();
 
         bool has_option(batch_opt_t option) const { return _batch_options_mask & uint16_t(option); }
 
@@ -817,12 +861,39 @@ public:
     void disable_fast_rate_buffer();
     // get the next available gyro sample from the fast rate buffer
     bool get_next_gyro_sample(Vector3f& gyro);
+    // get the next available gyro sample and the time it was sampled
+    bool get_next_gyro_sample(Vector3f& gyro, uint32_t &sample_us);
     // get the number of available gyro samples in the fast rate buffer
     uint32_t get_num_gyro_samples();
     // set the rate at which samples are collected, unused samples are dropped
     void set_rate_decimation(uint8_t rdec);
     // push a new gyro sample into the fast rate buffer
-    bool push_next_gyro_sample(const Vector3f& gyro);
+    bool push_next_gyro_sample(const Vector3f& gyro, uint32_t sample_us);
+    // time from gyro sample to use by the rate thread, the percentiles
+    // have the resolution of the fast rate buffer latency histogram
+    struct RateLoopLatency {
+        uint32_t samples;
+        uint32_t overruns;
+        uint16_t p50_us;
+        uint16_t p90_us;
+        uint16_t p99_us;
+        uint16_t max_us;
+    };
+    // stages of the rate loop, latencies are measured from the gyro sample
+    enum class RateLoopStage : uint8_t {
+        GYRO,       // sample taken by the rate thread
+        OUTPUT,     // motor outputs pushed to the HAL
+        SENT,       // motor outputs sent to the ESCs
+        NUM_STAGES
+    };
+    // get the latency of a stage since the last call for that stage, only call from the rate thread
+    bool get_rate_loop_latency(RateLoopLatency &latency, RateLoopStage stage = RateLoopStage::GYRO);
+    // record the motor outputs for the last gyro sample, start_us is
+    // when the outputs started, pushed_us when the HAL push returned
+    // and sent_us the HAL's last ESC send time, only call from the rate thread
+    void rate_loop_output_done(uint32_t start_us, uint32_t pushed_us, uint32_t sent_us);
+    // latency of each rate loop stage since the rate loop started
+    void rate_loop_timing_info(ExpandingString &str);
     // run the filter parmeter update code.
     void update_backend_filters();
     // are rate loop samples enabled for this instance?
@@ -216,7 +216,7 @@ void AP_InertialSensor_Backend::save_gyro_window(const uint8_t instance, const V
 /*
   apply harmonic notch and low pass gyro filters
  */
-void AP_InertialSensor_Backend::apply_gyro_filters(const uint8_t instance, const Vector3f &gyro)
+void AP_InertialSensor_Backend::apply_gyro_filters(const uint8_t instance, const Vector3f &gyro, const uint64_t sample_us)
 {
     uint8_t filter_phase = 0;
     save_gyro_window(instance, gyro, filter_phase++);
@@ -252,21 +252,37 @@ void AP_InertialSensor_Backend::apply_gyro_filters(const uint8_t instance, const
 
     // if the filtering failed in any way then reset the filters and keep the old value
     if (gyro_filtered.is_nan() || gyro_filtered.is_inf()) {
-        _imu._gyro_filter[instance].reset();
+        reset_gyro_filters(instance);
+        gyro_filtered = _imu._gyro_filtered[instance];
+    }
+
+    publish_filtered_gyro(instance, gyro_filtered, sample_us);
+}
+
+/*
+  reset all the gyro filters for an instance
+ */
+void AP_InertialSensor_Backend::reset_gyro_filters(const uint8_t instance)
+{
+    _imu._gyro_filter[instance].reset();
 #if HAL_GYROFFT_ENABLED
-        _imu._post_filter_gyro_filter[instance].reset();
+    _imu._post_filter_gyro_filter[instance].reset();
 #endif
 #if AP_INERTIALSENSOR_HARMONICNOTCH_ENABLED
-        for (auto &notch : _imu.harmonic_notches) {
-            notch.filter[instance].reset();
-        }
-#endif
-        gyro_filtered = _imu._gyro_filtered[instance];
+    for (auto &notch : _imu.harmonic_notches) {
+        notch.filter[instance].reset();
     }
+#endif
+}
 
+/*
+  record a filtered gyro sample for publication to the front-end
+ */
+void AP_InertialSensor_Backend::publish_filtered_gyro(const uint8_t instance, const Vector3f &gyro_filtered, const uint64_t sample_us)
+{
 #if AP_INERTIALSENSOR_FAST_SAMPLE_WINDOW_ENABLED
     if (_imu.is_rate_loop_gyro_enabled(instance)) {
-        if (_imu.push_next_gyro_sample(gyro_filtered)) {
+        if (_imu.push_next_gyro_sample(gyro_filtered, sample_us)) {
             // if we used the value, record it for publication to the front-end
             _imu._gyro_filtered[instance] = gyro_filtered;
         }
@@ -278,6 +294,89 @@ void AP_InertialSensor_Backend::apply_gyro_filters(const uint8_t instance, const
 #endif
 }
 
+/*
+  apply harmonic notch and low pass gyro filters to a burst of samples
+  one filter stage at a time. The output is the same as calling
+  apply_gyro_filters() on each sample in turn, filtered[] receives the
+  value recorded for publication after each sample
+ */
+void AP_InertialSensor_Backend::apply_gyro_filters_block(const uint8_t instance, const Vector3f *gyro, Vector3f *filtered, const uint8_t n_samples, const uint64_t sample_us)
+{
+    Vector3f block[AP_INERTIALSENSOR_GYRO_BLOCK_SIZE];
+    const uint8_t n = MIN(n_samples, ARRAY_SIZE(block));
+    for (uint8_t i = 0; i < n; i++) {
+        block[i] = gyro[i];
+    }
+
+#if HAL_GYROFFT_ENABLED
+    // the FFT window is fed from a single filter stage, keep that stage's
+    // output so it can be pushed in sample order with the low pass below
+    Vector3f fft_tap[AP_INERTIALSENSOR_GYRO_BLOCK_SIZE];
+    bool have_fft_tap = false;
+    auto capture_fft_tap = [&](uint8_t phase) {
+        if (_imu._fft_window_phase == phase) {
+            for (uint8_t i = 0; i < n; i++) {
+                fft_tap[i] = block[i];
+            }
+            have_fft_tap = true;
+        }
+    };
+    uint8_t filter_phase = 0;
+    capture_fft_tap(filter_phase++);
+#endif
+
+#if AP_INERTIALSENSOR_HARMONICNOTCH_ENABLED
+    // apply the harmonic notch filters, see apply_gyro_filters()
+    for (auto &notch : _imu.harmonic_notches) {
+        if (!notch.params.enabled()) {
+            continue;
+        }
+        bool inactive = notch.is_inactive();
+        if (!notch.params.hasOption(HarmonicNotchFilterParams::Options::EnableOnAllIMUs) &&
+            instance != _imu._primary) {
+            inactive = true;
+        }
+        if (inactive) {
+            notch.filter[instance].reset();
+        } else {
+            for (uint8_t i = 0; i < n; i++) {
+                block[i] = notch.filter[instance].apply(block[i]);
+            }
+        }
+#if HAL_GYROFFT_ENABLED
+        capture_fft_tap(filter_phase++);
+#endif
+    }
+#endif  // AP_INERTIALSENSOR_HARMONICNOTCH_ENABLED
+
+    for (uint8_t i = 0; i < n; i++) {
+#if HAL_GYROFFT_ENABLED
+        if (have_fft_tap) {
+            save_gyro_window(instance, fft_tap[i], _imu._fft_window_phase);
+        }
+#endif
+        // apply the low pass filter last to attenuate any notch induced noise
+        const Vector3f gyro_filtered = _imu._gyro_filter[instance].apply(block[i]);
+
+        if (gyro_filtered.is_nan() || gyro_filtered.is_inf()) {
+            // reset the filters and keep the old value. The rest of the
+            // burst has been through filters that are now reset, so it
+            // is run again one sample at a time
+            reset_gyro_filters(instance);
+            publish_filtered_gyro(instance, _imu._gyro_filtered[instance], sample_us);
+            filtered[i] = _imu._gyro_filtered[instance];
+            for (uint8_t j = i + 1; j < n; j++) {
+                apply_gyro_filters(instance, gyro[j], sample_us);
+                filtered[j] = _imu._gyro_filtered[instance];
+            }
+            return;
+        }
+
+        publish_filtered_gyro(instance, gyro_filtered, sample_us);
+        filtered[i] = _imu._gyro_filtered[instance];
+    }
+}
+
 void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
                                                             const Vector3f &gyro,
                                                             uint64_t sample_us)
@@ -361,7 +460,7 @@ void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
         _imu._last_raw_gyro[instance] = gyro;
 
         // apply gyro filters and sample for FFT
-        apply_gyro_filters(instance, gyro);
+        apply_gyro_filters(instance, gyro, sample_us);
 
         _imu._new_gyro_data[instance] = true;
     }
@@ -371,6 +470,102 @@ void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
     update_primary();
 }
 
+/*
+  handle a burst of gyro samples read from a FIFO. This is equivalent
+  to calling _notify_new_gyro_raw_sample() on each sample with no
+  sample time, but the per sample bookkeeping and locking is done once
+  per block and the filters are run over the whole block
+ */
+void AP_InertialSensor_Backend::_notify_new_gyro_raw_samples(uint8_t instance, const Vector3f *gyros, uint8_t n_samples)
+{
+    while (n_samples > 0) {
+        const uint8_t n = MIN(n_samples, AP_INERTIALSENSOR_GYRO_BLOCK_SIZE);
+        notify_new_gyro_raw_block(instance, gyros, n);
+        gyros += n;
+        n_samples -= n;
+    }
+}
+
+void AP_InertialSensor_Backend::notify_new_gyro_raw_block(uint8_t instance, const Vector3f *gyros, uint8_t n_samples)
+{
+    if (has_been_killed(instance)) {
+        return;
+    }
+
+    // the sample count is used for the sensor rate, so count every sample
+    for (uint8_t i = 0; i < n_samples; i++) {
+        _update_sensor_rate(_imu._sample_gyro_count[instance], _imu._sample_gyro_start_us[instance],
+                            _imu._gyro_raw_sample_rates[instance]);
+    }
+
+    // don't accept below 40Hz
+    if (_imu._gyro_raw_sample_rates[instance] < 40) {
+        return;
+    }
+
+    const float dt = 1.0f / _imu._gyro_raw_sample_rates[instance];
+    const uint64_t last_sample_us = _imu._gyro_last_sample_us[instance];
+    const uint64_t sample_us = AP_HAL::micros64();
+    _imu._gyro_last_sample_us[instance] = sample_us;
+
+    for (uint8_t i = 0; i < n_samples; i++) {
+#if AP_MODULE_SUPPORTED
+        // call gyro_sample hook if any
+        AP_Module::call_hook_gyro_sample(instance, dt, gyros[i]);
+#endif
+
+        // push gyros if optical flow present
+        if (hal.opticalflow) {
+            hal.opticalflow->push_gyro(gyros[i].x, gyros[i].y, dt);
+        }
+    }
+
+    Vector3f filtered[AP_INERTIALSENSOR_GYRO_BLOCK_SIZE];
+
+    {
+        WITH_SEMAPHORE(_sem);
+
+        // only the first sample of a block can follow a gap
+        const bool stale = AP_HAL::micros64() - last_sample_us > 100000U;
+
+        for (uint8_t i = 0; i < n_samples; i++) {
+            const Vector3f &gyro = gyros[i];
+            float sample_dt = dt;
+
+            // compute delta angle and coning correction, see _notify_new_gyro_raw_sample()
+            Vector3f delta_angle = (gyro + _imu._last_raw_gyro[instance]) * 0.5f * dt;
+            Vector3f delta_coning = (_imu._delta_angle_acc[instance] +
+                                     _imu._last_delta_angle[instance] * (1.0f / 6.0f));
+            delta_coning = delta_coning % delta_angle;
+            delta_coning *= 0.5f;
+
+            if (i == 0 && stale) {
+                // zero accumulator if sensor was unhealthy for 0.1s
+                _imu._delta_angle_acc[instance].zero();
+                _imu._delta_angle_acc_dt[instance] = 0;
+                sample_dt = 0;
+                delta_angle.zero();
+            }
+
+            _imu._delta_angle_acc[instance] += delta_angle + delta_coning;
+            _imu._delta_angle_acc_dt[instance] += sample_dt;
+
+            _imu._last_delta_angle[instance] = delta_angle;
+            _imu._last_raw_gyro[instance] = gyro;
+        }
+
+        // apply gyro filters and sample for FFT
+        apply_gyro_filters_block(instance, gyros, filtered, n_samples, sample_us);
+
+        _imu._new_gyro_data[instance] = true;
+    }
+
+    for (uint8_t i = 0; i < n_samples; i++) {
+        log_gyro_raw(instance, sample_us, gyros[i], filtered[i]);
+    }
+    update_primary();
+}
+
 /*
   handle a delta-angle sample from the backend. This assumes FIFO
   style sampling and the sample should not be rotated or corrected for
@@ -450,7 +645,7 @@ void AP_InertialSensor_Backend::_notify_new_delta_angle(uint8_t instance, const
         _imu._last_raw_gyro[instance] = gyro;
 
         // apply gyro filters and sample for FFT
-        apply_gyro_filters(instance, gyro);
+        apply_gyro_filters(instance, gyro, sample_us);
 
         _imu._new_gyro_data[instance] = true;
     }
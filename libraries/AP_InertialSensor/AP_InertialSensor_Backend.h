@@ -177,7 +177,11 @@ protected:
     void _publish_gyro(uint8_t instance, const Vector3f &gyro) __RAMFUNC__; /* front end */
 
     // apply notch and lowpass gyro filters and sample for FFT
-    void apply_gyro_filters(const uint8_t instance, const Vector3f &gyro);
+    void apply_gyro_filters(const uint8_t instance, const Vector3f &gyro, const uint64_t sample_us);
+    void apply_gyro_filters_block(const uint8_t instance, const Vector3f *gyro, Vector3f *filtered, const uint8_t n_samples, const uint64_t sample_us);
+    void reset_gyro_filters(const uint8_t instance);
+    void notify_new_gyro_raw_block(uint8_t instance, const Vector3f *gyros, uint8_t n_samples) __RAMFUNC__;
+    void publish_filtered_gyro(const uint8_t instance, const Vector3f &gyro_filtered, const uint64_t sample_us);
     void save_gyro_window(const uint8_t instance, const Vector3f &gyro, uint8_t phase);
 
     // this should be called every time a new gyro raw sample is
@@ -188,6 +192,11 @@ protected:
     // sensors, and should be set to zero for FIFO based sensors
     void _notify_new_gyro_raw_sample(uint8_t instance, const Vector3f &accel, uint64_t sample_us=0) __RAMFUNC__;
 
+    // FIFO based sensors can instead pass a burst of rotated and
+    // corrected samples in the order they were read. This is cheaper
+    // than one call per sample and gives the same filtered output
+    void _notify_new_gyro_raw_samples(uint8_t instance, const Vector3f *gyros, uint8_t n_samples) __RAMFUNC__;
+
     // alternative interface using delta-angles. Rotation and correction is handled inside this function
     void _notify_new_delta_angle(uint8_t instance, const Vector3f &dangle);
     
@@ -448,6 +448,10 @@ bool AP_InertialSensor_Invensensev3::accumulate_samples(const FIFOData *data, ui
 #if INV3_ENABLE_FIFO_LOGGING
     const uint64_t tstart = AP_HAL::micros64();
 #endif
+    // gyro samples are filtered in blocks, accel samples one at a time
+    Vector3f gyros[AP_INERTIALSENSOR_GYRO_BLOCK_SIZE];
+    uint8_t n_gyros = 0;
+
     for (uint8_t i = 0; i < n_samples; i++) {
         const FIFOData &d = data[i];
 
@@ -457,6 +461,7 @@ bool AP_InertialSensor_Invensensev3::accumulate_samples(const FIFOData *data, ui
         // ICM42688 - HEADER_TIMESTAMP_FSYNC bit 2-3 : 10
         if ((d.header & 0xFC) != 0x68) { // ACCEL_EN | GYRO_EN | TMST_FIELD_EN
             // no or bad data
+            _notify_new_gyro_raw_samples(gyro_instance, gyros, n_gyros);
             return false;
         }
 
@@ -477,10 +482,16 @@ bool AP_InertialSensor_Invensensev3::accumulate_samples(const FIFOData *data, ui
         _rotate_and_correct_gyro(gyro_instance, gyro);
 
         _notify_new_accel_raw_sample(accel_instance, accel, 0);
-        _notify_new_gyro_raw_sample(gyro_instance, gyro);
+
+        gyros[n_gyros++] = gyro;
+        if (n_gyros == ARRAY_SIZE(gyros)) {
+            _notify_new_gyro_raw_samples(gyro_instance, gyros, n_gyros);
+            n_gyros = 0;
+        }
 
         temp_filtered = temp_filter.apply(temp);
     }
+    _notify_new_gyro_raw_samples(gyro_instance, gyros, n_gyros);
     return true;
 }
 
@@ -509,6 +520,10 @@ bool AP_InertialSensor_Invensensev3::accumulate_highres_samples(const FIFODataHi
 #if INV3_ENABLE_FIFO_LOGGING
     const uint64_t tstart = AP_HAL::micros64();
 #endif
+    // gyro samples are filtered in blocks, accel samples one at a time
+    Vector3f gyros[AP_INERTIALSENSOR_GYRO_BLOCK_SIZE];
+    uint8_t n_gyros = 0;
+
     for (uint8_t i = 0; i < n_samples; i++) {
         const FIFODataHighRes &d = data[i];
 
@@ -516,6 +531,7 @@ bool AP_InertialSensor_Invensensev3::accumulate_highres_samples(const FIFODataHi
         // about with the temperature registers
         if ((d.header & 0xFC) != 0x78) { // ACCEL_EN | GYRO_EN | HIRES_EN | TMST_FIELD_EN
             // no or bad data
+            _notify_new_gyro_raw_samples(gyro_instance, gyros, n_gyros);
             return false;
         }
 
@@ -539,10 +555,16 @@ bool AP_InertialSensor_Invensensev3::accumulate_highres_samples(const FIFODataHi
         _rotate_and_correct_gyro(gyro_instance, gyro);
 
         _notify_new_accel_raw_sample(accel_instance, accel, 0);
-        _notify_new_gyro_raw_sample(gyro_instance, gyro);
+
+        gyros[n_gyros++] = gyro;
+        if (n_gyros == ARRAY_SIZE(gyros)) {
+            _notify_new_gyro_raw_samples(gyro_instance, gyros, n_gyros);
+            n_gyros = 0;
+        }
 
         temp_filtered = temp_filter.apply(temp);
     }
+    _notify_new_gyro_raw_samples(gyro_instance, gyros, n_gyros);
     return true;
 }
 #endif
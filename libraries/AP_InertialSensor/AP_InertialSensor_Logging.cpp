@@ -109,15 +109,22 @@ bool AP_InertialSensor::BatchSampler::Write_ISBH(const float sample_rate_hz) con
             || (_doing_post_filter_logging && _doing_sensor_rate_logging))) {
         instance_to_write += (type == IMU_SENSOR_TYPE_ACCEL ? _imu._accel_count : _imu._gyro_count);
     }
+    return Write_ISBH(isb_seqnum, type, instance_to_write, multiplier,
+                      _real_required_count, measurement_started_us, sample_rate_hz);
+}
+
+bool AP_InertialSensor::BatchSampler::Write_ISBH(uint16_t seqno, IMU_SENSOR_TYPE sensor_type, uint8_t sensor_instance, uint16_t mul,
+                                                 uint16_t sample_count, uint64_t sample_us, float sample_rate_hz) const
+{
     const struct log_ISBH pkt{
         LOG_PACKET_HEADER_INIT(LOG_ISBH_MSG),
         time_us        : AP_HAL::micros64(),
-        seqno          : isb_seqnum,
-        sensor_type    : (uint8_t)type,
-        instance       : instance_to_write,
-        multiplier     : multiplier,
-        sample_count   : (uint16_t)_real_required_count,
-        sample_us      : measurement_started_us,
+        seqno          : seqno,
+        sensor_type    : (uint8_t)sensor_type,
+        instance       : sensor_instance,
+        multiplier     : mul,
+        sample_count   : sample_count,
+        sample_us      : sample_us,
         sample_rate_hz : sample_rate_hz,
     };
 
@@ -126,16 +133,22 @@ bool AP_InertialSensor::BatchSampler::Write_ISBH(const float sample_rate_hz) con
 
 // Write a series of IMU readings to log:
 bool AP_InertialSensor::BatchSampler::Write_ISBD() const
+{
+    return Write_ISBD(isb_seqnum, (uint16_t) (data_read_offset/samples_per_msg),
+                      &data_x[data_read_offset], &data_y[data_read_offset], &data_z[data_read_offset]);
+}
+
+bool AP_InertialSensor::BatchSampler::Write_ISBD(uint16_t isb_seqno, uint16_t seqno, const int16_t *x, const int16_t *y, const int16_t *z) const
 {
     struct log_ISBD pkt = {
         LOG_PACKET_HEADER_INIT(LOG_ISBD_MSG),
         time_us    : AP_HAL::micros64(),
-        isb_seqno  : isb_seqnum,
-        seqno      : (uint16_t) (data_read_offset/samples_per_msg)
+        isb_seqno  : isb_seqno,
+        seqno      : seqno
     };
-    memcpy(pkt.x, &data_x[data_read_offset], sizeof(pkt.x));
-    memcpy(pkt.y, &data_y[data_read_offset], sizeof(pkt.y));
-    memcpy(pkt.z, &data_z[data_read_offset], sizeof(pkt.z));
+    memcpy(pkt.x, x, sizeof(pkt.x));
+    memcpy(pkt.y, y, sizeof(pkt.y));
+    memcpy(pkt.z, z, sizeof(pkt.z));
 
     return AP::logger().WriteBlock_first_succeed(&pkt, sizeof(pkt));
 }
@@ -43,6 +43,11 @@
 
 #define DEFAULT_IMU_LOG_BAT_MASK 0
 
+// maximum number of gyro samples filtered together from a FIFO burst
+#ifndef AP_INERTIALSENSOR_GYRO_BLOCK_SIZE
+#define AP_INERTIALSENSOR_GYRO_BLOCK_SIZE 8
+#endif
+
 #ifndef HAL_INS_TEMPERATURE_CAL_ENABLE
 #define HAL_INS_TEMPERATURE_CAL_ENABLE HAL_PROGRAM_SIZE_LIMIT_KB > 1024
 #endif
@@ -80,6 +85,11 @@
 #define AP_INERTIALSENSOR_BATCHSAMPLER_ENABLED (AP_INERTIALSENSOR_ENABLED && HAL_LOGGING_ENABLED)
 #endif
 
+// samples per block when streaming batch samples, a multiple of the 32 samples in an ISBD message
+#ifndef INS_BATCH_STREAM_BLOCK_SAMPLES
+#define INS_BATCH_STREAM_BLOCK_SAMPLES 128
+#endif
+
 #ifndef AP_INERTIALSENSOR_KILL_IMU_ENABLED
 #define AP_INERTIALSENSOR_KILL_IMU_ENABLED 1
 #endif
@@ -24,8 +24,8 @@ const AP_Param::GroupInfo AP_InertialSensor::BatchSampler::var_info[] = {
 
     // @Param: BAT_OPT
     // @DisplayName: Batch Logging Options Mask
-    // @Description: Options for the BatchSampler.
-    // @Bitmask: 0:Sensor-Rate Logging (sample at full sensor rate seen by AP), 1: Sample post-filtering, 2: Sample pre- and post-filter
+    // @Description: Options for the BatchSampler. Streaming captures every sensor in @PREFIX@BAT_MASK continuously rather than taking batches of @PREFIX@BAT_CNT samples from one sensor at a time, it can't be combined with sensor-rate or pre- and post-filter sampling and takes effect on the next reboot. If the stream buffers can't be allocated normal batch sampling is used.
+    // @Bitmask: 0:Sensor-Rate Logging (sample at full sensor rate seen by AP), 1: Sample post-filtering, 2: Sample pre- and post-filter, 3: Streaming
     // @User: Advanced
     AP_GROUPINFO("BAT_OPT",  3, AP_InertialSensor::BatchSampler, _batch_options_mask, 0),
 
@@ -56,6 +56,10 @@ void AP_InertialSensor::BatchSampler::init()
         return;
     }
 
+    if (has_option(BATCH_OPT_STREAM) && init_streaming()) {
+        return;
+    }
+
     _required_count.set(_required_count - (_required_count % 32)); // round down to nearest multiple of 32
 
     _real_required_count = _required_count;
@@ -88,6 +92,10 @@ void AP_InertialSensor::BatchSampler::periodic()
         return;
     }
 #if HAL_LOGGING_ENABLED
+    if (streaming) {
+        push_stream_data_to_log();
+        return;
+    }
     push_data_to_log();
 #endif
 }
@@ -177,6 +185,52 @@ void AP_InertialSensor::BatchSampler::rotate_to_next_sensor()
     update_doing_sensor_rate_logging();
 }
 
+/*
+  allocate a pair of blocks for each sensor in the mask for streaming.
+  Returns false, with nothing allocated, if any allocation fails
+ */
+bool AP_InertialSensor::BatchSampler::init_streaming()
+{
+    static_assert(INS_BATCH_STREAM_BLOCK_SAMPLES % 32 == 0, "stream blocks must be whole ISBD messages");
+    static_assert(INS_BATCH_STREAM_BLOCK_SAMPLES / 32 <= UINT8_MAX, "too many ISBD messages per stream block");
+
+    const uint8_t _count = MIN(_imu._accel_count, _imu._gyro_count);
+    uint32_t total_allocation = 0;
+    for (uint8_t i=0; i<_count; i++) {
+        if ((_sensor_mask & (1U<<i)) == 0) {
+            continue;
+        }
+        for (uint8_t t=0; t<2; t++) {
+            streams[i][t] = NEW_NOTHROW Stream();
+            if (streams[i][t] == nullptr) {
+                for (auto &s : streams) {
+                    delete s[IMU_SENSOR_TYPE_ACCEL];
+                    delete s[IMU_SENSOR_TYPE_GYRO];
+                    s[IMU_SENSOR_TYPE_ACCEL] = nullptr;
+                    s[IMU_SENSOR_TYPE_GYRO] = nullptr;
+                }
+                GCS_SEND_TEXT(MAV_SEVERITY_WARNING, "Failed to allocate IMU batch streaming, using batches");
+                return false;
+            }
+            total_allocation += sizeof(Stream);
+        }
+        streams[i][IMU_SENSOR_TYPE_ACCEL]->multiplier = _imu._accel_raw_sampling_multiplier[i];
+        streams[i][IMU_SENSOR_TYPE_GYRO]->multiplier = _imu._gyro_raw_sampling_multiplier[i];
+    }
+    GCS_SEND_TEXT(MAV_SEVERITY_DEBUG, "INS: alloc %u bytes for ISB streaming (free=%u)", (unsigned int)total_allocation, (unsigned int)hal.util->available_memory());
+
+    // streaming logs the samples seen by the front end, optionally post-filter
+    _doing_sensor_rate_logging = false;
+    _doing_post_filter_logging = has_option(BATCH_OPT_POST_FILTER);
+    _doing_pre_post_filter_logging = false;
+    post_filter = _doing_post_filter_logging;
+
+    last_stream_stats_ms = AP_HAL::millis();
+    streaming = true;
+    initialised = true;
+    return true;
+}
+
 #if HAL_LOGGING_ENABLED
 void AP_InertialSensor::BatchSampler::push_data_to_log()
 {
@@ -242,6 +296,95 @@ void AP_InertialSensor::BatchSampler::push_data_to_log()
     }
 }
 
+/*
+  write any completed stream blocks to the log, called from the main
+  thread. A block goes out as an ISBH and its ISBD messages in one go
+  so the logger gets large sequential writes, and it is only handed
+  back to the backend once it has all been written
+ */
+void AP_InertialSensor::BatchSampler::push_stream_data_to_log()
+{
+    if (!initialised) {
+        return;
+    }
+    for (uint8_t i=0; i<INS_MAX_INSTANCES; i++) {
+        for (uint8_t t=0; t<2; t++) {
+            Stream *stream = streams[i][t];
+            if (stream == nullptr) {
+                continue;
+            }
+            while (stream->full[stream->read_block]) {
+                if (!push_stream_block(*stream, i, IMU_SENSOR_TYPE(t))) {
+                    // logger buffer is full, carry on from here next time
+                    break;
+                }
+            }
+        }
+    }
+
+    const uint32_t now_ms = AP_HAL::millis();
+    if (now_ms - last_stream_stats_ms >= 1000) {
+        write_stream_stats();
+        last_stream_stats_ms = now_ms;
+    }
+}
+
+bool AP_InertialSensor::BatchSampler::push_stream_block(Stream &stream, uint8_t sensor_instance, IMU_SENSOR_TYPE sensor_type)
+{
+    const uint8_t b = stream.read_block;
+    if (stream.read_msg == 0) {
+        const float sample_rate_hz = sensor_type == IMU_SENSOR_TYPE_GYRO ?
+            _imu._gyro_raw_sample_rates[sensor_instance] : _imu._accel_raw_sample_rates[sensor_instance];
+        if (!Write_ISBH(isb_seqnum, sensor_type, sensor_instance, stream.multiplier,
+                        INS_BATCH_STREAM_BLOCK_SAMPLES, stream.start_us[b], sample_rate_hz)) {
+            return false;
+        }
+        stream.seqno = isb_seqnum++;
+    }
+    while (stream.read_msg < INS_BATCH_STREAM_BLOCK_SAMPLES / 32) {
+        const uint16_t ofs = stream.read_msg * 32;
+        if (!Write_ISBD(stream.seqno, stream.read_msg, &stream.x[b][ofs], &stream.y[b][ofs], &stream.z[b][ofs])) {
+            return false;
+        }
+        stream.read_msg++;
+    }
+    stream.read_msg = 0;
+    stream.read_block ^= 1;
+    // hand the block back to the backend
+    stream.full[b] = false;
+    return true;
+}
+
+/*
+  log the achieved capture rate and drops for each stream
+ */
+void AP_InertialSensor::BatchSampler::write_stream_stats()
+{
+    const uint32_t now_ms = AP_HAL::millis();
+    const float dt = (now_ms - last_stream_stats_ms) * 0.001f;
+    for (uint8_t i=0; i<INS_MAX_INSTANCES; i++) {
+        for (uint8_t t=0; t<2; t++) {
+            Stream *stream = streams[i][t];
+            if (stream == nullptr) {
+                continue;
+            }
+            const uint32_t samples = stream->samples;
+            const uint32_t drops = stream->drops;
+            const struct log_ISBS pkt{
+                LOG_PACKET_HEADER_INIT(LOG_ISBS_MSG),
+                time_us     : AP_HAL::micros64(),
+                sensor_type : t,
+                instance    : i,
+                rate_hz     : is_positive(dt) ? (samples - stream->last_samples) / dt : 0,
+                drops       : drops - stream->last_drops,
+            };
+            AP::logger().WriteBlock(&pkt, sizeof(pkt));
+            stream->last_samples = samples;
+            stream->last_drops = drops;
+        }
+    }
+}
+
 bool AP_InertialSensor::BatchSampler::should_log(uint8_t _instance, IMU_SENSOR_TYPE _type)
 {
     if (_sensor_mask == 0) {
@@ -274,6 +417,10 @@ bool AP_InertialSensor::BatchSampler::should_log(uint8_t _instance, IMU_SENSOR_T
 void AP_InertialSensor::BatchSampler::sample(uint8_t _instance, AP_InertialSensor::IMU_SENSOR_TYPE _type, uint64_t sample_us, const Vector3f &_sample)
 {
 #if HAL_LOGGING_ENABLED
+    if (streaming) {
+        stream_sample(_instance, _type, sample_us, _sample);
+        return;
+    }
     if (!should_log(_instance, _type)) {
         return;
     }
@@ -288,4 +435,44 @@ void AP_InertialSensor::BatchSampler::sample(uint8_t _instance, AP_InertialSenso
     data_write_offset++; // may unblock the reading process
 #endif
 }
+/*
+  add a sample to a stream, called from the backend thread
+ */
+void AP_InertialSensor::BatchSampler::stream_sample(uint8_t _instance, AP_InertialSensor::IMU_SENSOR_TYPE _type, uint64_t sample_us, const Vector3f &_sample)
+{
+#if HAL_LOGGING_ENABLED
+    if (_instance >= INS_MAX_INSTANCES) {
+        return;
+    }
+    Stream *stream = streams[_instance][_type];
+    if (stream == nullptr) {
+        return;
+    }
+    AP_Logger *logger = AP_Logger::get_singleton();
+    if (logger == nullptr || !logger->should_log(MASK_LOG_ANY)) {
+        return;
+    }
+    const uint8_t b = stream->fill_block;
+    if (stream->full[b]) {
+        // the main thread hasn't finished logging this block yet
+        stream->drops++;
+        return;
+    }
+    if (stream->fill_count == 0) {
+        stream->start_us[b] = sample_us;
+    }
+    const uint16_t n = stream->fill_count;
+    stream->x[b][n] = stream->multiplier*_sample.x;
+    stream->y[b][n] = stream->multiplier*_sample.y;
+    stream->z[b][n] = stream->multiplier*_sample.z;
+    stream->samples++;
+
+    if (++stream->fill_count >= INS_BATCH_STREAM_BLOCK_SAMPLES) {
+        stream->fill_count = 0;
+        stream->fill_block ^= 1;
+        // hand the block to the main thread
+        stream->full[b] = true;
+    }
+#endif
+}
 #endif //#if AP_INERTIALSENSOR_BATCHSAMPLER_ENABLED
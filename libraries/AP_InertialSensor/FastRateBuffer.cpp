@@ -20,6 +20,7 @@
 
 #if AP_INERTIALSENSOR_FAST_SAMPLE_WINDOW_ENABLED
 #include "FastRateBuffer.h"
+#include <AP_Common/ExpandingString.h>
 #include <stdio.h>
 
 extern const AP_HAL::HAL& hal;
@@ -91,36 +92,239 @@ bool AP_InertialSensor::is_dynamic_fifo_enabled(uint8_t instance) const
 
 // get the next available gyro sample from the fast rate buffer
 bool AP_InertialSensor::get_next_gyro_sample(Vector3f& gyro)
+{
+    uint32_t sample_us;
+    return get_next_gyro_sample(gyro, sample_us);
+}
+
+// get the next available gyro sample and the time it was sampled
+bool AP_InertialSensor::get_next_gyro_sample(Vector3f& gyro, uint32_t &sample_us)
 {
     if (!fast_rate_buffer_enabled || fast_rate_buffer == nullptr) {
         return false;
     }
 
-    return fast_rate_buffer->get_next_gyro_sample(gyro);
+    return fast_rate_buffer->get_next_gyro_sample(gyro, sample_us);
+}
+
+// get the latency of a rate loop stage since the last call for that stage
+bool AP_InertialSensor::get_rate_loop_latency(RateLoopLatency &latency, RateLoopStage stage)
+{
+    if (!fast_rate_buffer_enabled || fast_rate_buffer == nullptr) {
+        return false;
+    }
+    fast_rate_buffer->get_latency(stage, latency);
+    return true;
+}
+
+// record the motor outputs for the gyro sample last returned by get_next_gyro_sample()
+void AP_InertialSensor::rate_loop_output_done(uint32_t start_us, uint32_t pushed_us, uint32_t sent_us)
+{
+    if (!fast_rate_buffer_enabled || fast_rate_buffer == nullptr) {
+        return;
+    }
+    fast_rate_buffer->output_done(start_us, pushed_us, sent_us);
+}
+
+// latency of each stage of the rate loop, for @SYS/timing.txt
+void AP_InertialSensor::rate_loop_timing_info(ExpandingString &str)
+{
+    if (fast_rate_buffer == nullptr) {
+        str.printf("Rate loop not running\n");
+        return;
+    }
+    fast_rate_buffer->timing_info(str);
 }
 
+uint8_t RateLoopLatencyHistogram::bin_index(uint32_t latency_us)
+{
+    if (latency_us < 16) {
+        return latency_us / 4;
+    }
+    // octave 0 is 16-31us
+    const uint8_t octave = 27 - __builtin_clz(latency_us);
+    const uint32_t bin = 4U + octave * 4U + ((latency_us >> (octave + 2)) & 3U);
+    return MIN(bin, uint32_t(AP_INERTIAL_SENSOR_RATE_LOOP_LATENCY_BINS - 1));
+}
+
+uint32_t RateLoopLatencyHistogram::bin_upper_us(uint8_t bin)
+{
+    if (bin < 4) {
+        return (bin + 1) * 4U;
+    }
+    const uint8_t octave = (bin - 4) / 4;
+    return (16U << octave) + ((bin - 4) % 4 + 1) * (4U << octave);
+}
+
+void RateLoopLatencyHistogram::add(uint32_t latency_us)
+{
+    _bins[bin_index(latency_us)]++;
+    _max_us = MAX(_max_us, latency_us);
+}
+
+void RateLoopLatencyHistogram::get(AP_InertialSensor::RateLoopLatency &latency) const
+{
+    uint32_t count = 0;
+    for (const uint32_t n : _bins) {
+        count += n;
+    }
+
+    // percentiles are reported as the upper edge of their bin, limited to the
+    // maximum so that the open ended last bin still gives a real latency.
+    // The targets overflow 32 bits after 43M samples, a little over 90 minutes at 8kHz
+    const uint64_t targets[] { (uint64_t(count) + 1) / 2, (uint64_t(count) * 9 + 9) / 10, (uint64_t(count) * 99 + 99) / 100 };
+    uint16_t *results[] { &latency.p50_us, &latency.p90_us, &latency.p99_us };
+    uint8_t next = 0;
+    uint64_t total = 0;
+    for (uint8_t i = 0; i < ARRAY_SIZE(_bins) && next < ARRAY_SIZE(targets); i++) {
+        total += _bins[i];
+        while (next < ARRAY_SIZE(targets) && total >= targets[next] && count > 0) {
+            *results[next++] = MIN(MIN(bin_upper_us(i), _max_us), uint32_t(UINT16_MAX));
+        }
+    }
+    while (next < ARRAY_SIZE(targets)) {
+        *results[next++] = 0;
+    }
+
+    latency.samples = count;
+    latency.max_us = MIN(_max_us, uint32_t(UINT16_MAX));
+}
+
+void RateLoopLatencyHistogram::clear()
+{
+    memset(_bins, 0, sizeof(_bins));
+    _max_us = 0;
+}
 
-bool FastRateBuffer::get_next_gyro_sample(Vector3f& gyro)
+bool FastRateBuffer::push(const Vector3f &gyro, uint32_t sample_us)
+{
+    const uint32_t tail = _tail.idx.load(std::memory_order_relaxed);
+    if (tail - _head.idx.load(std::memory_order_acquire) >= AP_INERTIAL_SENSOR_RATE_LOOP_BUFFER_SIZE) {
+        _overruns++;
+        return false;
+    }
+    RateSample &sample = _samples[tail & (AP_INERTIAL_SENSOR_RATE_LOOP_BUFFER_SIZE - 1)];
+    sample.gyro = gyro;
+    sample.sample_us = sample_us;
+    _tail.idx.store(tail + 1);
+
+    // the sequentially consistent store above and load below pair
+    // with those in get_next_gyro_sample() so a waiting rate thread
+    // is always woken
+    if (_waiting.load()) {
+        _notifier.signal();
+    }
+    return true;
+}
+
+bool FastRateBuffer::pop(Vector3f &gyro, uint32_t &sample_us)
+{
+    const uint32_t head = _head.idx.load(std::memory_order_relaxed);
+    if (head == _tail.idx.load(std::memory_order_acquire)) {
+        return false;
+    }
+    const RateSample &sample = _samples[head & (AP_INERTIAL_SENSOR_RATE_LOOP_BUFFER_SIZE - 1)];
+    gyro = sample.gyro;
+    sample_us = sample.sample_us;
+    _head.idx.store(head + 1, std::memory_order_release);
+
+    _last_sample_us = sample_us;
+    record_latency(AP_InertialSensor::RateLoopStage::GYRO, AP_HAL::micros() - sample_us);
+    return true;
+}
+
+void FastRateBuffer::record_latency(AP_InertialSensor::RateLoopStage stage, uint32_t latency_us)
+{
+    auto &latency = _latency[uint8_t(stage)];
+    latency.recent.add(latency_us);
+    latency.total.add(latency_us);
+}
+
+/*
+  record the motor outputs for the last sample returned. start_us is
+  when the outputs started, pushed_us when the HAL push returned and
+  sent_us the last time the HAL sent outputs to the ESCs. HALs that
+  send from another thread, such as DShot on ChibiOS, usually send
+  after the push returns, so the send is matched up with the previous
+  outputs on the next call
+ */
+void FastRateBuffer::output_done(uint32_t start_us, uint32_t pushed_us, uint32_t sent_us)
+{
+    if (sent_us != _last_sent_us) {
+        if (int32_t(sent_us - start_us) >= 0) {
+            // sent during this push
+            record_latency(AP_InertialSensor::RateLoopStage::SENT, sent_us - _last_sample_us);
+        } else if (_output_pending && int32_t(sent_us - _output_start_us) >= 0) {
+            // sent after the previous push returned
+            record_latency(AP_InertialSensor::RateLoopStage::SENT, sent_us - _output_sample_us);
+        }
+        _last_sent_us = sent_us;
+    }
+
+    record_latency(AP_InertialSensor::RateLoopStage::OUTPUT, pushed_us - _last_sample_us);
+
+    _output_sample_us = _last_sample_us;
+    _output_start_us = start_us;
+    _output_pending = true;
+}
+
+bool FastRateBuffer::get_next_gyro_sample(Vector3f& gyro, uint32_t &sample_us)
 {
     if (!use_rate_loop_gyro_samples()) {
         return false;
     }
 
-    if (_rate_loop_gyro_window.available() == 0) {
-        _notifier.wait_blocking();
+    if (pop(gyro, sample_us)) {
+        return true;
     }
 
-    WITH_SEMAPHORE(_mutex);
+    _waiting.store(true);
+    if (_tail.idx.load() == _head.idx.load(std::memory_order_relaxed)) {
+        _notifier.wait_blocking();
+    }
+    _waiting.store(false);
 
-    return _rate_loop_gyro_window.pop(gyro);
+    return pop(gyro, sample_us);
 }
 
 void FastRateBuffer::reset()
 {
-    _rate_loop_gyro_window.clear();
+    _head.idx.store(_tail.idx.load(std::memory_order_acquire), std::memory_order_release);
 }
 
-bool AP_InertialSensor::push_next_gyro_sample(const Vector3f& gyro)
+void FastRateBuffer::get_latency(AP_InertialSensor::RateLoopStage stage, AP_InertialSensor::RateLoopLatency &latency)
+{
+    auto &hist = _latency[uint8_t(stage)].recent;
+    hist.get(latency);
+    hist.clear();
+
+    latency.overruns = 0;
+    if (stage == AP_InertialSensor::RateLoopStage::GYRO) {
+        const uint32_t overruns = _overruns;
+        latency.overruns = overruns - _last_overruns;
+        _last_overruns = overruns;
+    }
+}
+
+void FastRateBuffer::timing_info(ExpandingString &str) const
+{
+    static const char *names[] { "gyro", "output", "sent" };
+    static_assert(ARRAY_SIZE(names) == uint8_t(AP_InertialSensor::RateLoopStage::NUM_STAGES), "stage names");
+
+    str.printf("RateLoopV1\n");
+    str.printf("latency from gyro sample in us, percentiles within 25%%\n");
+    for (uint8_t i = 0; i < ARRAY_SIZE(names); i++) {
+        AP_InertialSensor::RateLoopLatency latency;
+        _latency[i].total.get(latency);
+        str.printf("%-8s N=%u P50=%u P90=%u P99=%u MAX=%u\n",
+                   names[i], unsigned(latency.samples),
+                   unsigned(latency.p50_us), unsigned(latency.p90_us), unsigned(latency.p99_us),
+                   unsigned(latency.max_us));
+    }
+    str.printf("overruns=%u\n", unsigned(_overruns));
+}
+
+bool AP_InertialSensor::push_next_gyro_sample(const Vector3f& gyro, uint32_t sample_us)
 {
     if (!fast_rate_buffer_enabled || fast_rate_buffer == nullptr) {
         return false;
@@ -129,16 +333,14 @@ bool AP_InertialSensor::push_next_gyro_sample(const Vector3f& gyro)
     if (++fast_rate_buffer->rate_decimation_count < fast_rate_buffer->rate_decimation) {
         return false;
     }
+    fast_rate_buffer->rate_decimation_count = 0;
+
     /*
         tell the rate thread we have a new sample
     */
-    WITH_SEMAPHORE(fast_rate_buffer->_mutex);
-
-    if (!fast_rate_buffer->_rate_loop_gyro_window.push(gyro)) {
+    if (!fast_rate_buffer->push(gyro, sample_us)) {
         debug("dropped rate loop sample");
     }
-    fast_rate_buffer->rate_decimation_count = 0;
-    fast_rate_buffer->_notifier.signal();
     return true;
 }
 
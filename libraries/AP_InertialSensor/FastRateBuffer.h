@@ -18,34 +18,117 @@
 
 #if AP_INERTIALSENSOR_FAST_SAMPLE_WINDOW_ENABLED
 
-#define AP_INERTIAL_SENSOR_RATE_LOOP_BUFFER_SIZE 8     // gyro buffer size for rate loop
+#define AP_INERTIAL_SENSOR_RATE_LOOP_BUFFER_SIZE 8     // gyro buffer size for rate loop, must be a power of 2
 
+#if CONFIG_HAL_BOARD == HAL_BOARD_CHIBIOS
+#define AP_INERTIAL_SENSOR_RATE_LOOP_CACHE_LINE 32
+#else
+#define AP_INERTIAL_SENSOR_RATE_LOOP_CACHE_LINE 64
+#endif
+
+#define AP_INERTIAL_SENSOR_RATE_LOOP_LATENCY_BINS 32
+
+#include <atomic>
 #include <AP_HAL/AP_HAL_Boards.h>
-#include <AP_HAL/utility/RingBuffer.h>
 #include <AP_Math/AP_Math.h>
 #include <AP_HAL/Semaphores.h>
 
+class ExpandingString;
+
+// histogram of rate loop latencies, the bins are 4us wide up to 16us and then each
+// doubling is split into four bins, so the resolution is at worst a quarter of the
+// latency and the last bin holds everything from 1792us
+class RateLoopLatencyHistogram
+{
+public:
+    void add(uint32_t latency_us);
+    // percentiles and maximum of the latencies added since the last clear, overruns are not set
+    void get(AP_InertialSensor::RateLoopLatency &latency) const;
+    void clear();
+
+private:
+    static uint8_t bin_index(uint32_t latency_us);
+    static uint32_t bin_upper_us(uint8_t bin);
+
+    uint32_t _bins[AP_INERTIAL_SENSOR_RATE_LOOP_LATENCY_BINS];
+    uint32_t _max_us;
+};
+
+/*
+  single producer, single consumer ring of filtered gyro samples from
+  the primary IMU backend to the rate thread. Neither side takes a
+  lock, the binary semaphore is only signalled when the rate thread is
+  waiting for a sample
+ */
 class FastRateBuffer
 {
     friend class AP_InertialSensor;
 public:
-    bool get_next_gyro_sample(Vector3f& gyro);
-    uint32_t get_num_gyro_samples() { return _rate_loop_gyro_window.available(); }
+    bool get_next_gyro_sample(Vector3f& gyro, uint32_t &sample_us);
+    uint32_t get_num_gyro_samples() const { return _tail.idx.load() - _head.idx.load(); }
     void set_rate_decimation(uint8_t rdec) { rate_decimation = rdec; }
     // whether or not to push the current gyro sample
     bool use_rate_loop_gyro_samples() const { return rate_decimation > 0; }
-    bool gyro_samples_available() { return  _rate_loop_gyro_window.available() > 0; }
+    bool gyro_samples_available() const { return get_num_gyro_samples() > 0; }
+    // discard queued samples, called from the rate thread
     void reset();
+    // latency of a stage since the last call for that stage, called from the rate thread
+    void get_latency(AP_InertialSensor::RateLoopStage stage, AP_InertialSensor::RateLoopLatency &latency);
+    // record the motor outputs for the last sample, called from the rate thread
+    void output_done(uint32_t start_us, uint32_t pushed_us, uint32_t sent_us);
+    // latency of each stage since the rate loop started
+    void timing_info(ExpandingString &str) const;
 
 private:
-    /*
-      binary semaphore for rate loop to use to start a rate loop when
-      we hav finished filtering the primary IMU
-     */
-    ObjectBuffer<Vector3f> _rate_loop_gyro_window{AP_INERTIAL_SENSOR_RATE_LOOP_BUFFER_SIZE};
+    // called from the backend thread, returns false if the rate thread has fallen behind
+    bool push(const Vector3f &gyro, uint32_t sample_us);
+    // called from the rate thread
+    bool pop(Vector3f &gyro, uint32_t &sample_us);
+    void record_latency(AP_InertialSensor::RateLoopStage stage, uint32_t latency_us);
+
+    static_assert((AP_INERTIAL_SENSOR_RATE_LOOP_BUFFER_SIZE & (AP_INERTIAL_SENSOR_RATE_LOOP_BUFFER_SIZE - 1)) == 0,
+                  "rate loop buffer size must be a power of 2");
+
+    struct RateSample {
+        Vector3f gyro;
+        uint32_t sample_us;
+    };
+    RateSample _samples[AP_INERTIAL_SENSOR_RATE_LOOP_BUFFER_SIZE];
+
+    // free running indices, the head is only written by the rate
+    // thread and the tail by the backend thread. They are kept on
+    // separate cache lines so the two threads don't contend
+    struct PaddedIndex {
+        std::atomic<uint32_t> idx{0};
+        uint8_t pad[AP_INERTIAL_SENSOR_RATE_LOOP_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+    };
+    PaddedIndex _head;
+    PaddedIndex _tail;
+
+    // samples dropped because the buffer was full, written by the backend thread
+    uint32_t _overruns;
+    uint32_t _last_overruns;
+
+    // time from gyro sample to the end of each stage, since the last
+    // get_latency() call for logging and in total for timing_info(),
+    // updated by the rate thread
+    struct {
+        RateLoopLatencyHistogram recent;
+        RateLoopLatencyHistogram total;
+    } _latency[uint8_t(AP_InertialSensor::RateLoopStage::NUM_STAGES)];
+
+    // the sample last returned to the rate thread and the sample and
+    // output start time of the last motor outputs, to match up ESC
+    // sends that happen after the outputs were pushed
+    uint32_t _last_sample_us;
+    uint32_t _output_sample_us;
+    uint32_t _output_start_us;
+    uint32_t _last_sent_us;
+    bool _output_pending;
+
     uint8_t rate_decimation; // 0 means off
     uint8_t rate_decimation_count;
+    std::atomic<bool> _waiting{false};
     HAL_BinarySemaphore _notifier;
-    HAL_Semaphore _mutex;
 };
 #endif
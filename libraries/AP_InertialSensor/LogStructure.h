@@ -8,6 +8,7 @@
     LOG_IMU_MSG, \
     LOG_ISBH_MSG, \
     LOG_ISBD_MSG, \
+    LOG_ISBS_MSG, \
     LOG_VIBE_MSG
 
 // @LoggerMessage: ACC
@@ -113,6 +114,22 @@ struct PACKED log_ISBD {
 };
 static_assert(sizeof(log_ISBD) < 256, "log_ISBD is over-size");
 
+// @LoggerMessage: ISBS
+// @Description: InertialSensor Batch Logging streaming statistics
+// @Field: TimeUS: Time since system startup
+// @Field: type: indicates if this is accel or gyro data
+// @Field: instance: IMU sensor instance
+// @Field: Rate: rate at which samples were captured since the last message
+// @Field: Drop: samples dropped since the last message because the logger had not taken the previous block
+struct PACKED log_ISBS {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t sensor_type;
+    uint8_t instance;
+    float rate_hz;
+    uint32_t drops;
+};
+
 // @LoggerMessage: VIBE
 // @Description: Processed (acceleration) vibration information
 // @Field: TimeUS: Time since system startup
@@ -141,4 +158,6 @@ struct PACKED log_Vibe {
     { LOG_ISBH_MSG, sizeof(log_ISBH), \
       "ISBH", "QHBBHHQf", "TimeUS,N,type,instance,mul,smp_cnt,SampleUS,smp_rate", "s-----sz", "F-----F-" },  \
     { LOG_ISBD_MSG, sizeof(log_ISBD), \
-      "ISBD", "QHHaaa", "TimeUS,N,seqno,x,y,z", "s--ooo", "F--???" },
+      "ISBD", "QHHaaa", "TimeUS,N,seqno,x,y,z", "s--ooo", "F--???" }, \
+    { LOG_ISBS_MSG, sizeof(log_ISBS), \
+      "ISBS", "QBBfI", "TimeUS,type,instance,Rate,Drop", "s--z-", "F----" },
@@ -0,0 +1,127 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_InertialSensor/AP_InertialSensor.h>
+#include <AP_InertialSensor/AP_InertialSensor_Backend.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#if AP_INERTIALSENSOR_ENABLED
+
+/*
+  cost of handing gyro samples to the frontend for three IMUs sampling
+  at 8kHz and read in FIFO bursts of 8, comparing
+  _notify_new_gyro_raw_sample() on each sample of the burst with a
+  single _notify_new_gyro_raw_samples() call for the whole burst. Both
+  run the full filter chain, with two harmonic notches and the low pass.
+  Items are gyro samples, so both report samples per second
+ */
+static constexpr float RATE_HZ = 8000;
+static constexpr uint8_t NUM_IMUS = 3;
+static constexpr uint8_t BURST = AP_INERTIALSENSOR_GYRO_BLOCK_SIZE;
+
+class AP_InertialSensor_BenchBackend : public AP_InertialSensor_Backend
+{
+public:
+    using AP_InertialSensor_Backend::AP_InertialSensor_Backend;
+
+    bool update() override { return true; }
+
+    void notify_sample(uint8_t instance, const Vector3f &gyro) {
+        _notify_new_gyro_raw_sample(instance, gyro);
+    }
+    void notify_samples(uint8_t instance, const Vector3f *gyros, uint8_t n_samples) {
+        _notify_new_gyro_raw_samples(instance, gyros, n_samples);
+    }
+};
+
+static AP_InertialSensor ins;
+static AP_InertialSensor_BenchBackend backend{ins};
+
+class AP_InertialSensor_Benchmark
+{
+public:
+    static void setup()
+    {
+#if AP_INERTIALSENSOR_HARMONICNOTCH_ENABLED
+        for (auto &notch : ins.harmonic_notches) {
+            notch.params.enable();
+            notch.params.set_options(uint16_t(HarmonicNotchFilterParams::Options::EnableOnAllIMUs) |
+                                     uint16_t(HarmonicNotchFilterParams::Options::DoubleNotch));
+            notch.params.set_attenuation(40);
+            notch.params.set_bandwidth_hz(40);
+            notch.params.set_center_freq_hz(80);
+            notch.params.set_freq_min_ratio(1.0);
+            notch.set_inactive(false);
+        }
+#endif
+        for (uint8_t i = 0; i < NUM_IMUS; i++) {
+#if AP_INERTIALSENSOR_HARMONICNOTCH_ENABLED
+            for (auto &notch : ins.harmonic_notches) {
+                notch.filter[i].allocate_filters(1, 0x3, notch.params.num_composite_notches());
+                notch.filter[i].init(RATE_HZ, notch.params);
+                notch.filter[i].update(80);
+            }
+#endif
+            ins._gyro_filter[i].set_cutoff_frequency(RATE_HZ, 80);
+            ins._gyro_raw_sample_rates[i] = RATE_HZ;
+        }
+    }
+};
+
+static void fill_burst(Vector3f burst[BURST], uint32_t n)
+{
+    for (uint8_t i = 0; i < BURST; i++) {
+        const float t = (n * BURST + i) / RATE_HZ;
+        burst[i] = Vector3f(sinf(t * 500), cosf(t * 700), sinf(t * 1100));
+    }
+}
+
+static void BM_GyroNotifyPerSample(benchmark::State& state)
+{
+    Vector3f burst[BURST];
+    uint32_t n = 0;
+    while (state.KeepRunning()) {
+        fill_burst(burst, n++);
+        for (uint8_t imu = 0; imu < NUM_IMUS; imu++) {
+            for (uint8_t i = 0; i < BURST; i++) {
+                backend.notify_sample(imu, burst[i]);
+            }
+        }
+        gbenchmark_escape(&ins);
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_IMUS * BURST);
+}
+
+static void BM_GyroNotifyBlock(benchmark::State& state)
+{
+    Vector3f burst[BURST];
+    uint32_t n = 0;
+    while (state.KeepRunning()) {
+        fill_burst(burst, n++);
+        for (uint8_t imu = 0; imu < NUM_IMUS; imu++) {
+            backend.notify_samples(imu, burst, BURST);
+        }
+        gbenchmark_escape(&ins);
+    }
+    state.SetItemsProcessed(state.iterations() * NUM_IMUS * BURST);
+}
+
+BENCHMARK(BM_GyroNotifyPerSample);
+BENCHMARK(BM_GyroNotifyBlock);
+
+int main(int argc, char **argv)
+{
+    benchmark::Initialize(&argc, argv);
+    AP_InertialSensor_Benchmark::setup();
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    return 0;
+}
+
+#endif // AP_INERTIALSENSOR_ENABLED
@@ -0,0 +1,144 @@
+#include <AP_gtest.h>
+
+#include <AP_InertialSensor/AP_InertialSensor.h>
+#include <AP_InertialSensor/AP_InertialSensor_Backend.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#if AP_INERTIALSENSOR_ENABLED
+
+/*
+  check that gyro samples handed over in blocks with
+  _notify_new_gyro_raw_samples() are filtered and integrated the same
+  as when handed over one at a time with _notify_new_gyro_raw_sample()
+ */
+
+static constexpr float RATE_HZ = 8000;
+static constexpr uint8_t SINGLE = 0;    // instance fed one sample at a time
+static constexpr uint8_t BLOCK = 1;     // instance fed in blocks
+
+class AP_InertialSensor_TestBackend : public AP_InertialSensor_Backend
+{
+public:
+    using AP_InertialSensor_Backend::AP_InertialSensor_Backend;
+
+    bool update() override { return true; }
+
+    void notify_sample(uint8_t instance, const Vector3f &gyro) {
+        _notify_new_gyro_raw_sample(instance, gyro);
+    }
+    void notify_samples(uint8_t instance, const Vector3f *gyros, uint8_t n_samples) {
+        _notify_new_gyro_raw_samples(instance, gyros, n_samples);
+    }
+};
+
+static AP_InertialSensor ins;
+static AP_InertialSensor_TestBackend backend{ins};
+
+class AP_InertialSensor_Test
+{
+public:
+    // the same filter chain, with two notches, on both instances
+    static void setup()
+    {
+        static bool allocated;
+#if AP_INERTIALSENSOR_HARMONICNOTCH_ENABLED
+        for (auto &notch : ins.harmonic_notches) {
+            notch.params.enable();
+            notch.params.set_options(uint16_t(HarmonicNotchFilterParams::Options::EnableOnAllIMUs) |
+                                     uint16_t(HarmonicNotchFilterParams::Options::DoubleNotch));
+            notch.params.set_attenuation(40);
+            notch.params.set_bandwidth_hz(40);
+            notch.params.set_center_freq_hz(80);
+            notch.params.set_freq_min_ratio(1.0);
+            notch.set_inactive(false);
+        }
+#endif
+        for (uint8_t i : { SINGLE, BLOCK }) {
+#if AP_INERTIALSENSOR_HARMONICNOTCH_ENABLED
+            for (auto &notch : ins.harmonic_notches) {
+                if (!allocated) {
+                    notch.filter[i].allocate_filters(1, 0x3, notch.params.num_composite_notches());
+                }
+                notch.filter[i].init(RATE_HZ, notch.params);
+                notch.filter[i].update(80);
+                notch.filter[i].reset();
+            }
+#endif
+            ins._gyro_filter[i].set_cutoff_frequency(RATE_HZ, 80);
+            ins._gyro_filter[i].reset();
+            ins._gyro_raw_sample_rates[i] = RATE_HZ;
+            ins._gyro_filtered[i].zero();
+            ins._delta_angle_acc[i].zero();
+            ins._delta_angle_acc_dt[i] = 0;
+            ins._last_delta_angle[i].zero();
+            ins._last_raw_gyro[i].zero();
+        }
+        allocated = true;
+    }
+
+    static const Vector3f &filtered(uint8_t i) { return ins._gyro_filtered[i]; }
+    static const Vector3f &delta_angle(uint8_t i) { return ins._delta_angle_acc[i]; }
+};
+
+static Vector3f test_sample(uint32_t n)
+{
+    // well inside and outside the notch and low pass
+    const float t = n / RATE_HZ;
+    return Vector3f(sinf(t * 500) + 0.3f * sinf(t * 6000),
+                    cosf(t * 700) - 0.2f * sinf(t * 9000),
+                    sinf(t * 1100) + 0.1f * cosf(t * 15000));
+}
+
+static void expect_vector_eq(const Vector3f &a, const Vector3f &b)
+{
+    EXPECT_FLOAT_EQ(a.x, b.x);
+    EXPECT_FLOAT_EQ(a.y, b.y);
+    EXPECT_FLOAT_EQ(a.z, b.z);
+}
+
+// feed blocks of the given sizes to both instances, optionally with a NaN
+// at sample nan_at, checking the outputs match after each block
+static void feed_blocks(const uint8_t *sizes, uint8_t num_sizes, uint32_t num_samples, uint32_t nan_at, bool check_delta_angle)
+{
+    uint32_t n = 0;
+    for (uint8_t b = 0; n < num_samples; b = (b + 1) % num_sizes) {
+        Vector3f block[2 * AP_INERTIALSENSOR_GYRO_BLOCK_SIZE];
+        const uint8_t len = MIN(sizes[b], ARRAY_SIZE(block));
+        for (uint8_t i = 0; i < len; i++, n++) {
+            block[i] = (n == nan_at) ? Vector3f(NaNf, 0, 0) : test_sample(n);
+            backend.notify_sample(SINGLE, block[i]);
+        }
+        backend.notify_samples(BLOCK, block, len);
+
+        expect_vector_eq(AP_InertialSensor_Test::filtered(SINGLE), AP_InertialSensor_Test::filtered(BLOCK));
+        if (check_delta_angle) {
+            expect_vector_eq(AP_InertialSensor_Test::delta_angle(SINGLE), AP_InertialSensor_Test::delta_angle(BLOCK));
+        }
+    }
+}
+
+TEST(GyroBlockTest, MatchesPerSample)
+{
+    AP_InertialSensor_Test::setup();
+
+    // full blocks, partial blocks and bursts longer than a block
+    const uint8_t sizes[] { AP_INERTIALSENSOR_GYRO_BLOCK_SIZE, 1, 3, AP_INERTIALSENSOR_GYRO_BLOCK_SIZE + 5, 7 };
+    feed_blocks(sizes, ARRAY_SIZE(sizes), 4000, UINT32_MAX, true);
+}
+
+TEST(GyroBlockTest, NaNResetMatchesPerSample)
+{
+    AP_InertialSensor_Test::setup();
+
+    // a NaN in the middle of a block resets the filters, the rest of the
+    // block must then be filtered as it would be sample by sample. The
+    // delta angles are NaN from there on so only the filter output is checked
+    const uint8_t sizes[] { AP_INERTIALSENSOR_GYRO_BLOCK_SIZE };
+    feed_blocks(sizes, ARRAY_SIZE(sizes), 2000, 1000 + AP_INERTIALSENSOR_GYRO_BLOCK_SIZE / 2, false);
+    EXPECT_FALSE(AP_InertialSensor_Test::filtered(BLOCK).is_nan());
+}
+
+#endif // AP_INERTIALSENSOR_ENABLED
+
+AP_GTEST_MAIN()
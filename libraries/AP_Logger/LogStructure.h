@@ -484,6 +484,18 @@ struct PACKED log_TERRAIN {
     float reference_offset;
 };
 
+/*
+  terrain cache statistics log structure
+ */
+struct PACKED log_TERRAIN_CACHE {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint16_t cache_hits;
+    uint16_t cache_misses;
+    uint8_t io_queued;
+    uint32_t io_latency_us;
+};
+
 struct PACKED log_ARSP {
     LOG_PACKET_HEADER;
     uint64_t time_us;
@@ -614,6 +626,20 @@ struct PACKED log_Scripting {
     uint32_t run_time;
     int32_t total_mem;
     int32_t run_mem;
+    uint32_t gc_time;
+    int32_t gc_mem;
+    uint32_t wake_time;
+};
+
+struct PACKED log_ScriptingRun {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    char name[16];
+    uint32_t vm_steps;
+    uint32_t run_time;
+    uint32_t gc_time;
+    uint32_t allocs;
+    uint32_t heap_peak;
 };
 
 struct PACKED log_MotBatt {
@@ -1056,6 +1082,14 @@ struct PACKED log_VER {
 // @Field: Loaded: Number of tiles in memory
 // @Field: ROfs: terrain reference offset for arming altitude
 
+// @LoggerMessage: TERC
+// @Description: Terrain cache statistics, accumulated since the previous message
+// @Field: TimeUS: Time since system startup
+// @Field: Hit: Number of lookups served from a loaded cache block
+// @Field: Miss: Number of lookups that needed a new cache block
+// @Field: IOQ: Number of blocks queued for disk IO
+// @Field: IOLat: Maximum latency of a disk read
+
 // @LoggerMessage: TSYN
 // @Description: Time synchronisation response information
 // @Field: TimeUS: Time since system startup
@@ -1114,6 +1148,19 @@ struct PACKED log_VER {
 // @Field: Runtime: run time
 // @Field: Total_mem: total memory usage of all scripts
 // @Field: Run_mem: run memory usage
+// @Field: GC_time: time spent collecting garbage after the script ran
+// @Field: GC_mem: memory freed by garbage collection after the script ran
+// @Field: Wake: time from when the script was due to run until it started
+
+// @LoggerMessage: LUAS
+// @Description: Scripting per run resource usage
+// @Field: TimeUS: Time since system startup
+// @Field: Name: script name
+// @Field: Steps: Lua VM instructions executed
+// @Field: Run: run time
+// @Field: GC: time spent collecting garbage after the script ran
+// @Field: Alloc: number of allocations made by the script
+// @Field: Peak: highest heap usage of the scripting state during the run
 
 // @LoggerMessage: VER
 // @Description: Ardupilot version
@@ -1207,6 +1254,8 @@ LOG_STRUCTURE_FROM_AVOIDANCE \
       "SIM","QccCfLLffff","TimeUS,Roll,Pitch,Yaw,Alt,Lat,Lng,Q1,Q2,Q3,Q4", "sddhmDU----", "FBBB0GG0000", true }, \
     { LOG_TERRAIN_MSG, sizeof(log_TERRAIN), \
       "TERR","QBLLHffHHf","TimeUS,Status,Lat,Lng,Spacing,TerrH,CHeight,Pending,Loaded,ROfs", "s-DU-mm--m", "F-GG-00--0", true }, \
+    { LOG_TERRAIN_CACHE_MSG, sizeof(log_TERRAIN_CACHE), \
+      "TERC","QHHBI","TimeUS,Hit,Miss,IOQ,IOLat", "s---s", "F---F", true }, \
 LOG_STRUCTURE_FROM_ESC_TELEM \
 LOG_STRUCTURE_FROM_SERVO_TELEM \
     { LOG_PIDR_MSG, sizeof(log_PID), \
@@ -1262,7 +1311,9 @@ LOG_STRUCTURE_FROM_VISUALODOM \
       "FILE",   "NIBZ",       "FileName,Offset,Length,Data", "----", "----" }, \
 LOG_STRUCTURE_FROM_AIS \
     { LOG_SCRIPTING_MSG, sizeof(log_Scripting), \
-      "SCR",   "QNIii", "TimeUS,Name,Runtime,Total_mem,Run_mem", "s#sbb", "F-F--", true }, \
+      "SCR",   "QNIiiIiI", "TimeUS,Name,Runtime,Total_mem,Run_mem,GC_time,GC_mem,Wake", "s#sbbsbs", "F-F--F-F", true }, \
+    { LOG_SCRIPTING_RUN_MSG, sizeof(log_ScriptingRun), \
+      "LUAS",  "QNIIIII", "TimeUS,Name,Steps,Run,GC,Alloc,Peak", "s#-ss-b", "F--FF--", true }, \
     { LOG_VER_MSG, sizeof(log_VER), \
       "VER",   "QBHBBBBIZHBBII", "TimeUS,BT,BST,Maj,Min,Pat,FWT,GH,FWS,APJ,BU,FV,IMI,ICI", "s-------------", "F-------------", false }, \
     { LOG_MOTBATT_MSG, sizeof(log_MotBatt), \
@@ -1292,6 +1343,7 @@ enum LogMessages : uint8_t {
     LOG_IDS_FROM_CAMERA,
     LOG_IDS_FROM_MOUNT,
     LOG_TERRAIN_MSG,
+    LOG_TERRAIN_CACHE_MSG,
     LOG_IDS_FROM_SERVO_TELEM,
     LOG_IDS_FROM_ESC_TELEM,
     LOG_IDS_FROM_BATTMONITOR,
@@ -1347,6 +1399,7 @@ enum LogMessages : uint8_t {
     LOG_STAK_MSG,
     LOG_FILE_MSG,
     LOG_SCRIPTING_MSG,
+    LOG_SCRIPTING_RUN_MSG,
     LOG_VIDEO_STABILISATION_MSG,
     LOG_MOTBATT_MSG,
     LOG_VER_MSG,
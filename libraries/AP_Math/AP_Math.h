@@ -19,6 +19,7 @@
 #include "spline5.h"
 #include "location.h"
 #include "control.h"
+#include "fast_math.h"
 
 static const float NaNf = nanf("0x4152");
 
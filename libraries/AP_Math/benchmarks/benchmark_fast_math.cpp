@@ -0,0 +1,133 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  compare the fast_math.h functions with the libm functions they
+  replace. The input changes each iteration so the calls can't be
+  hoisted out of the loop
+ */
+
+static void BM_Sinf(benchmark::State& state)
+{
+    float x = 0.1f;
+    while (state.KeepRunning()) {
+        float r = sinf(x);
+        gbenchmark_escape(&r);
+        x += 0.01f;
+    }
+}
+
+BENCHMARK(BM_Sinf);
+
+static void BM_FastSinf(benchmark::State& state)
+{
+    float x = 0.1f;
+    while (state.KeepRunning()) {
+        float r = fast_sinf(x);
+        gbenchmark_escape(&r);
+        x += 0.01f;
+    }
+}
+
+BENCHMARK(BM_FastSinf);
+
+static void BM_Cosf(benchmark::State& state)
+{
+    float x = 0.1f;
+    while (state.KeepRunning()) {
+        float r = cosf(x);
+        gbenchmark_escape(&r);
+        x += 0.01f;
+    }
+}
+
+BENCHMARK(BM_Cosf);
+
+static void BM_FastCosf(benchmark::State& state)
+{
+    float x = 0.1f;
+    while (state.KeepRunning()) {
+        float r = fast_cosf(x);
+        gbenchmark_escape(&r);
+        x += 0.01f;
+    }
+}
+
+BENCHMARK(BM_FastCosf);
+
+static void BM_Atan2f(benchmark::State& state)
+{
+    float y = 0.1f;
+    while (state.KeepRunning()) {
+        float r = atan2f(y, 0.7f);
+        gbenchmark_escape(&r);
+        y += 0.01f;
+    }
+}
+
+BENCHMARK(BM_Atan2f);
+
+static void BM_FastAtan2f(benchmark::State& state)
+{
+    float y = 0.1f;
+    while (state.KeepRunning()) {
+        float r = fast_atan2f(y, 0.7f);
+        gbenchmark_escape(&r);
+        y += 0.01f;
+    }
+}
+
+BENCHMARK(BM_FastAtan2f);
+
+static void BM_SafeAsin(benchmark::State& state)
+{
+    float x = -1.0f;
+    while (state.KeepRunning()) {
+        float r = safe_asin(x);
+        gbenchmark_escape(&r);
+        x = x < 1.0f ? x + 1e-4f : -1.0f;
+    }
+}
+
+BENCHMARK(BM_SafeAsin);
+
+static void BM_FastAsinf(benchmark::State& state)
+{
+    float x = -1.0f;
+    while (state.KeepRunning()) {
+        float r = fast_asinf(x);
+        gbenchmark_escape(&r);
+        x = x < 1.0f ? x + 1e-4f : -1.0f;
+    }
+}
+
+BENCHMARK(BM_FastAsinf);
+
+static void BM_InvSqrtf(benchmark::State& state)
+{
+    float x = 0.1f;
+    while (state.KeepRunning()) {
+        float r = 1.0f / sqrtf(x);
+        gbenchmark_escape(&r);
+        x += 0.01f;
+    }
+}
+
+BENCHMARK(BM_InvSqrtf);
+
+static void BM_FastInvSqrtf(benchmark::State& state)
+{
+    float x = 0.1f;
+    while (state.KeepRunning()) {
+        float r = fast_inv_sqrtf(x);
+        gbenchmark_escape(&r);
+        x += 0.01f;
+    }
+}
+
+BENCHMARK(BM_FastInvSqrtf);
+
+BENCHMARK_MAIN();
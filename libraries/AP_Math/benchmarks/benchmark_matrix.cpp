@@ -21,4 +21,53 @@ static void BM_MatrixMultiplication(benchmark::State& state)
 
 BENCHMARK(BM_MatrixMultiplication);
 
+static void BM_MatrixVectorMultiplication(benchmark::State& state)
+{
+    Matrix3f m(Vector3f(1.0f, 2.0f, 3.0f),
+               Vector3f(4.0f, 5.0f, 6.0f),
+               Vector3f(7.0f, 8.0f, 9.0f));
+    Vector3f v(0.1f, -0.2f, 0.3f);
+
+    while (state.KeepRunning()) {
+        gbenchmark_escape(&m);
+        gbenchmark_escape(&v);
+        Vector3f r = m * v;
+        gbenchmark_escape(&r);
+    }
+}
+
+BENCHMARK(BM_MatrixVectorMultiplication);
+
+static void BM_MatrixMulTranspose(benchmark::State& state)
+{
+    Matrix3f m(Vector3f(1.0f, 2.0f, 3.0f),
+               Vector3f(4.0f, 5.0f, 6.0f),
+               Vector3f(7.0f, 8.0f, 9.0f));
+    Vector3f v(0.1f, -0.2f, 0.3f);
+
+    while (state.KeepRunning()) {
+        gbenchmark_escape(&m);
+        gbenchmark_escape(&v);
+        Vector3f r = m.mul_transpose(v);
+        gbenchmark_escape(&r);
+    }
+}
+
+BENCHMARK(BM_MatrixMulTranspose);
+
+static void BM_QuaternionRotation(benchmark::State& state)
+{
+    Quaternion q(0.8365163f, 0.48296291f, 0.22414387f, -0.12940952f);
+    Vector3f v(0.1f, -0.2f, 0.3f);
+
+    while (state.KeepRunning()) {
+        gbenchmark_escape(&q);
+        gbenchmark_escape(&v);
+        Vector3f r = q * v;
+        gbenchmark_escape(&r);
+    }
+}
+
+BENCHMARK(BM_QuaternionRotation);
+
 BENCHMARK_MAIN();
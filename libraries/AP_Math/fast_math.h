@@ -0,0 +1,164 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  reduced precision trig and square root functions for callers that
+  only display or report a value, such as the OSD and telemetry. They
+  are minimax polynomials rather than tables, so they cost no flash for
+  tables and no cache misses on boards with slow flash.
+
+  The maximum errors given below are checked over the whole domain of
+  each function by tests/test_fast_math.cpp. Attitude control, the EKF
+  and navigation should keep using the full precision functions.
+
+  Set AP_MATH_FAST_MATH_ENABLED to 0 to make all of these call the
+  libm functions instead.
+ */
+#pragma once
+
+#include <cmath>
+#include <stdint.h>
+#include <string.h>
+
+#include "definitions.h"
+
+#ifndef AP_MATH_FAST_MATH_ENABLED
+#define AP_MATH_FAST_MATH_ENABLED 1
+#endif
+
+#if AP_MATH_FAST_MATH_ENABLED
+
+// reduce an angle to [-PI, PI]. 2*PI is split in two so that k*2*PI is
+// exact for the first part and the reduction is accurate for large angles
+static inline float fast_math_reduce_PI(float x)
+{
+    const float k = roundf(x * float(0.5 / M_PI));
+    return (x - k * 6.28125f) - k * 1.9353071795864769e-3f;
+}
+
+// sin(x) for x in [-PI/2, PI/2]
+static inline float fast_math_sin_poly(float x)
+{
+    const float x2 = x * x;
+    return x * (0.9999966159080028f +
+                x2 * (-0.16664828381895092f +
+                      x2 * (0.008306325227160051f +
+                            x2 * -0.00018363653976947425f)));
+}
+
+/*
+  sin(x), maximum error 1e-6 for |x| <= 1e4 radians
+ */
+static inline float fast_sinf(float x)
+{
+    float r = fast_math_reduce_PI(x);
+    if (r > float(M_PI_2)) {
+        r = float(M_PI) - r;
+    } else if (r < -float(M_PI_2)) {
+        r = -float(M_PI) - r;
+    }
+    return fast_math_sin_poly(r);
+}
+
+/*
+  cos(x), maximum error 1e-6 for |x| <= 1e4 radians
+ */
+static inline float fast_cosf(float x)
+{
+    return fast_math_sin_poly(float(M_PI_2) - fabsf(fast_math_reduce_PI(x)));
+}
+
+/*
+  atan2(y, x), maximum error 3e-6 radians for finite y and x.
+  Returns 0 when both are zero
+ */
+static inline float fast_atan2f(float y, float x)
+{
+    const float ax = fabsf(x);
+    const float ay = fabsf(y);
+    const float mx = ax > ay ? ax : ay;
+    if (mx <= 0) {
+        return 0;
+    }
+    // atan(z) for z in [0, 1]
+    const float z = (ax > ay ? ay : ax) / mx;
+    const float z2 = z * z;
+    float r = z * (0.999977219079924f +
+                   z2 * (-0.3326228278409359f +
+                         z2 * (0.1935403757741249f +
+                               z2 * (-0.11642648118756138f +
+                                     z2 * (0.052647350618991916f +
+                                           z2 * -0.011719135407157114f)))));
+    if (ay > ax) {
+        r = float(M_PI_2) - r;
+    }
+    if (x < 0) {
+        r = float(M_PI) - r;
+    }
+    return y < 0 ? -r : r;
+}
+
+/*
+  asin(x), maximum error 2e-6 radians. Like safe_asin() the input is
+  constrained to [-1, 1] and NaN gives 0
+ */
+static inline float fast_asinf(float x)
+{
+    if (std::isnan(x)) {
+        return 0;
+    }
+    const float ax = fabsf(x) < 1 ? fabsf(x) : 1;
+    const float p = 1.5707956895148625f +
+                    ax * (-0.21454281677939072f +
+                          ax * (0.088171053574602f +
+                                ax * (-0.045927228766241064f +
+                                      ax * (0.02062006170712543f +
+                                            ax * -0.004911174469660961f))));
+    const float r = float(M_PI_2) - sqrtf(1 - ax) * p;
+    return x < 0 ? -r : r;
+}
+
+/*
+  1/sqrt(x) for x > 0, maximum relative error 5e-6. The initial guess
+  comes from the float exponent and two Newton steps refine it
+ */
+static inline float fast_inv_sqrtf(float x)
+{
+    uint32_t i;
+    memcpy(&i, &x, sizeof(i));
+    i = 0x5f375a86U - (i >> 1);
+    float y;
+    memcpy(&y, &i, sizeof(y));
+    const float hx = 0.5f * x;
+    y = y * (1.5f - hx * y * y);
+    y = y * (1.5f - hx * y * y);
+    return y;
+}
+
+#else
+
+static inline float fast_sinf(float x) { return sinf(x); }
+static inline float fast_cosf(float x) { return cosf(x); }
+static inline float fast_atan2f(float y, float x) { return atan2f(y, x); }
+static inline float fast_asinf(float x)
+{
+    if (std::isnan(x)) {
+        return 0;
+    }
+    return asinf(x < -1 ? -1 : (x > 1 ? 1 : x));
+}
+static inline float fast_inv_sqrtf(float x) { return 1.0f / sqrtf(x); }
+
+#endif  // AP_MATH_FAST_MATH_ENABLED
@@ -51,6 +51,20 @@ typedef float ftype;
 #define toftype tofloat
 #endif
 
+/*
+  use SSE for the hottest float Matrix3 and Quaternion operations. The
+  NEON version for 64 bit ARM is off by default until it has been
+  tested on hardware, define AP_MATH_SIMD_ENABLED to 1 to use it. 32
+  bit NEON is not supported as it flushes denormals
+ */
+#ifndef AP_MATH_SIMD_ENABLED
+#if defined(__SSE2__)
+#define AP_MATH_SIMD_ENABLED 1
+#else
+#define AP_MATH_SIMD_ENABLED 0
+#endif
+#endif
+
 #if MATH_CHECK_INDEXES
 #define ZERO_FARRAY(a) a.zero()
 #else
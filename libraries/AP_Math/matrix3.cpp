@@ -19,6 +19,7 @@
 #pragma GCC optimize("O2")
 
 #include "AP_Math.h"
+#include "simd.h"
 
 // create a rotation matrix given some euler angles
 // this is based on https://github.com/ArduPilot/Datasheets/blob/main/References/EulerAngles.pdf
@@ -251,6 +252,50 @@ void Matrix3<T>::from_axis_angle(const Vector3<T> &v, T theta)
     c.z = t*z*z + C;
 }
 
+#if AP_MATH_SIMD_ENABLED
+// multiplication by a vector, the rows are multiplied by the vector and
+// transposed so the three sums can be done at once
+template <>
+Vector3<float> Matrix3<float>::operator *(const Vector3<float> &v) const
+{
+    simd_f4 ra, rb, rc;
+    simd_load_rows(*this, ra, rb, rc);
+    const simd_f4 sv = simd_set(v);
+    ra = simd_mul(ra, sv);
+    rb = simd_mul(rb, sv);
+    rc = simd_mul(rc, sv);
+    simd_transpose3(ra, rb, rc);
+    return simd_to_vector3f(simd_add(simd_add(ra, rb), rc));
+}
+
+// multiplication of transpose by a vector, a sum of the rows
+template <>
+Vector3<float> Matrix3<float>::mul_transpose(const Vector3<float> &v) const
+{
+    simd_f4 ra, rb, rc;
+    simd_load_rows(*this, ra, rb, rc);
+    return simd_to_vector3f(simd_add(simd_add(simd_mul(ra, simd_splat(v.x)),
+                                              simd_mul(rb, simd_splat(v.y))),
+                                     simd_mul(rc, simd_splat(v.z))));
+}
+
+// multiplication by another Matrix3<float>, each row of the result is a
+// sum of the rows of m
+template <>
+Matrix3<float> Matrix3<float>::operator *(const Matrix3<float> &m) const
+{
+    simd_f4 ma, mb, mc;
+    simd_load_rows(m, ma, mb, mc);
+    Matrix3<float> temp;
+    for (uint8_t i = 0; i < 3; i++) {
+        const Vector3<float> &r = (*this)[i];
+        temp[i] = simd_to_vector3f(simd_add(simd_add(simd_mul(simd_splat(r.x), ma),
+                                                     simd_mul(simd_splat(r.y), mb)),
+                                            simd_mul(simd_splat(r.z), mc)));
+    }
+    return temp;
+}
+#endif  // AP_MATH_SIMD_ENABLED
 
 // define for float and double
 template class Matrix3<float>;
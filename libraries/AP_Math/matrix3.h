@@ -290,3 +290,10 @@ typedef Matrix3<int32_t>                Matrix3l;
 typedef Matrix3<uint32_t>               Matrix3ul;
 typedef Matrix3<float>                  Matrix3f;
 typedef Matrix3<double>                 Matrix3d;
+
+#if AP_MATH_SIMD_ENABLED
+// SSE or NEON versions for float, see matrix3.cpp
+template <> Vector3<float> Matrix3<float>::operator *(const Vector3<float> &v) const;
+template <> Vector3<float> Matrix3<float>::mul_transpose(const Vector3<float> &v) const;
+template <> Matrix3<float> Matrix3<float>::operator *(const Matrix3<float> &m) const;
+#endif
@@ -20,6 +20,7 @@
 
 #include "quaternion.h"
 #include "AP_Math.h"
+#include "simd.h"
 #include <AP_InternalError/AP_InternalError.h>
 #include <AP_CustomRotations/AP_CustomRotations.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
@@ -835,6 +836,26 @@ T QuaternionT<T>::roll_pitch_difference(const QuaternionT<T> &v) const
     return (2.0 * asinF(vec_len_div2));
 }
 
+#if AP_MATH_SIMD_ENABLED
+// as the generic version, with the cross products done as lane rotations
+template <>
+Vector3<float> QuaternionT<float>::operator*(const Vector3<float> &v) const
+{
+    const simd_f4 qv = simd_set(q2, q3, q4);
+    const simd_f4 qv_yzx = simd_yzx(qv);
+    const simd_f4 qv_zxy = simd_zxy(qv);
+    const simd_f4 sv = simd_set(v);
+
+    // "qv x v1"
+    simd_f4 uv = simd_sub(simd_mul(qv_yzx, simd_zxy(sv)), simd_mul(qv_zxy, simd_yzx(sv)));
+    uv = simd_add(uv, uv);
+
+    const simd_f4 t = simd_sub(simd_add(simd_mul(simd_splat(q1), uv), simd_mul(qv_yzx, simd_zxy(uv))),
+                               simd_mul(qv_zxy, simd_yzx(uv)));
+    return simd_to_vector3f(simd_add(sv, t));
+}
+#endif  // AP_MATH_SIMD_ENABLED
+
 // define for float and double
 template class QuaternionT<float>;
 template class QuaternionT<double>;
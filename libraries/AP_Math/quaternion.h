@@ -203,5 +203,10 @@ public:
 typedef QuaternionT<float> Quaternion;
 typedef QuaternionT<double> QuaternionD;
 
+#if AP_MATH_SIMD_ENABLED
+// SSE or NEON version for float, see quaternion.cpp
+template <> Vector3<float> QuaternionT<float>::operator*(const Vector3<float> &v) const;
+#endif
+
 
 
@@ -0,0 +1,185 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  four lane float helpers for the SSE and NEON versions of the Vector3,
+  Matrix3 and Quaternion operations. Only the first three lanes are
+  used, the loads zero the fourth so it never holds a NaN or denormal
+  picked up from the next member in memory.
+
+  The kernels do the same multiplies and adds in the same order as the
+  scalar code so they give the same results, apart from any fused
+  multiply-adds the compiler chooses for one version and not the other
+ */
+#pragma once
+
+#include "AP_Math.h"
+
+#if AP_MATH_SIMD_ENABLED
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+typedef __m128 simd_f4;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+typedef float32x4_t simd_f4;
+#else
+#error "AP_MATH_SIMD_ENABLED needs SSE2 or 64 bit NEON"
+#endif
+
+static inline simd_f4 simd_set(float x, float y, float z)
+{
+#if defined(__SSE2__)
+    return _mm_setr_ps(x, y, z, 0);
+#else
+    const float v[4] { x, y, z, 0 };
+    return vld1q_f32(v);
+#endif
+}
+
+static inline simd_f4 simd_set(const Vector3f &v)
+{
+    return simd_set(v.x, v.y, v.z);
+}
+
+static inline simd_f4 simd_splat(float v)
+{
+#if defined(__SSE2__)
+    return _mm_set1_ps(v);
+#else
+    return vdupq_n_f32(v);
+#endif
+}
+
+static inline simd_f4 simd_add(simd_f4 a, simd_f4 b)
+{
+#if defined(__SSE2__)
+    return _mm_add_ps(a, b);
+#else
+    return vaddq_f32(a, b);
+#endif
+}
+
+static inline simd_f4 simd_sub(simd_f4 a, simd_f4 b)
+{
+#if defined(__SSE2__)
+    return _mm_sub_ps(a, b);
+#else
+    return vsubq_f32(a, b);
+#endif
+}
+
+static inline simd_f4 simd_mul(simd_f4 a, simd_f4 b)
+{
+#if defined(__SSE2__)
+    return _mm_mul_ps(a, b);
+#else
+    return vmulq_f32(a, b);
+#endif
+}
+
+// rotate the first three lanes, x,y,z becomes y,z,x
+static inline simd_f4 simd_yzx(simd_f4 v)
+{
+#if defined(__SSE2__)
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1));
+#else
+    const float32x4_t r = vextq_f32(v, v, 1);        // y,z,w,x
+    return vcopyq_laneq_f32(r, 2, v, 0);
+#endif
+}
+
+// rotate the first three lanes, x,y,z becomes z,x,y
+static inline simd_f4 simd_zxy(simd_f4 v)
+{
+#if defined(__SSE2__)
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 0, 2));
+#else
+    const float32x4_t r = vextq_f32(v, v, 3);        // w,x,y,z
+    return vcopyq_laneq_f32(r, 0, v, 2);
+#endif
+}
+
+// zero the fourth lane
+static inline simd_f4 simd_clear_w(simd_f4 v)
+{
+#if defined(__SSE2__)
+    return _mm_and_ps(v, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)));
+#else
+    return vsetq_lane_f32(0, v, 3);
+#endif
+}
+
+/*
+  load the rows of a matrix. The rows are contiguous so the first two
+  can be loaded four floats at a time, the last is loaded one float
+  early so the load doesn't go past the end of the matrix. The fourth
+  lane of each row would hold an element of another row, so it is
+  zeroed
+ */
+static inline void simd_load_rows(const Matrix3f &m, simd_f4 &a, simd_f4 &b, simd_f4 &c)
+{
+#if defined(__SSE2__)
+    a = _mm_loadu_ps(&m.a.x);
+    b = _mm_loadu_ps(&m.b.x);
+    const simd_f4 t = _mm_loadu_ps(&m.b.z);
+    c = _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 3, 2, 1));
+#else
+    a = vld1q_f32(&m.a.x);
+    b = vld1q_f32(&m.b.x);
+    const float32x4_t t = vld1q_f32(&m.b.z);
+    c = vextq_f32(t, t, 1);
+#endif
+    a = simd_clear_w(a);
+    b = simd_clear_w(b);
+    c = simd_clear_w(c);
+}
+
+// transpose the first three lanes of three vectors
+static inline void simd_transpose3(simd_f4 &a, simd_f4 &b, simd_f4 &c)
+{
+#if defined(__SSE2__)
+    const simd_f4 t0 = _mm_unpacklo_ps(a, b);   // a.x,b.x,a.y,b.y
+    const simd_f4 t1 = _mm_unpackhi_ps(a, b);   // a.z,b.z,a.w,b.w
+    a = _mm_shuffle_ps(t0, c, _MM_SHUFFLE(3, 0, 1, 0));
+    b = _mm_shuffle_ps(t0, c, _MM_SHUFFLE(3, 1, 3, 2));
+    c = _mm_shuffle_ps(t1, c, _MM_SHUFFLE(3, 2, 1, 0));
+#else
+    const float32x4_t t0 = vzip1q_f32(a, b);    // a.x,b.x,a.y,b.y
+    const float32x4_t t1 = vzip2q_f32(a, b);    // a.z,b.z,a.w,b.w
+    const float32x4_t c0 = c;
+    a = vcombine_f32(vget_low_f32(t0), vget_low_f32(c0));
+    b = vcombine_f32(vget_high_f32(t0), vdup_lane_f32(vget_low_f32(c0), 1));
+    c = vcombine_f32(vget_low_f32(t1), vget_high_f32(c0));
+#endif
+}
+
+static inline void simd_store(simd_f4 v, float out[4])
+{
+#if defined(__SSE2__)
+    _mm_storeu_ps(out, v);
+#else
+    vst1q_f32(out, v);
+#endif
+}
+
+static inline Vector3f simd_to_vector3f(simd_f4 v)
+{
+    float out[4];
+    simd_store(v, out);
+    return Vector3f(out[0], out[1], out[2]);
+}
+
+#endif  // AP_MATH_SIMD_ENABLED
@@ -0,0 +1,94 @@
+// given we are in the Math library, you're epected to know what
+// you're doing when directly comparing floats:
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+
+#include <AP_gtest.h>
+
+#include <AP_Math/AP_Math.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  sweep each function over its domain and check the error against the
+  bound given in fast_math.h
+ */
+
+TEST(FastMathTest, Sin)
+{
+    float max_err = 0;
+    for (float x = -10000; x <= 10000; x += 0.0137f) {
+        max_err = MAX(max_err, fabsf(fast_sinf(x) - sinf(x)));
+    }
+    for (float x = -2 * M_PI; x <= 2 * M_PI; x += 1e-5f) {
+        max_err = MAX(max_err, fabsf(fast_sinf(x) - sinf(x)));
+    }
+    EXPECT_LT(max_err, 1e-6f);
+    EXPECT_EQ(fast_sinf(0), 0);
+}
+
+TEST(FastMathTest, Cos)
+{
+    float max_err = 0;
+    for (float x = -10000; x <= 10000; x += 0.0137f) {
+        max_err = MAX(max_err, fabsf(fast_cosf(x) - cosf(x)));
+    }
+    for (float x = -2 * M_PI; x <= 2 * M_PI; x += 1e-5f) {
+        max_err = MAX(max_err, fabsf(fast_cosf(x) - cosf(x)));
+    }
+    EXPECT_LT(max_err, 1e-6f);
+}
+
+TEST(FastMathTest, Atan2)
+{
+    // every direction, at radii from very small to very large
+    float max_err = 0;
+    for (float r = 1e-30f; r < 1e30f; r *= 1000) {
+        for (float a = -M_PI; a <= M_PI; a += 1e-5f) {
+            const float y = r * sinf(a);
+            const float x = r * cosf(a);
+            max_err = MAX(max_err, fabsf(fast_atan2f(y, x) - atan2f(y, x)));
+        }
+    }
+    EXPECT_LT(max_err, 3e-6f);
+
+    // the axes, where the quadrant fix-ups meet
+    EXPECT_EQ(fast_atan2f(0, 1), 0);
+    EXPECT_FLOAT_EQ(fast_atan2f(1, 0), M_PI_2);
+    EXPECT_FLOAT_EQ(fast_atan2f(-1, 0), -M_PI_2);
+    EXPECT_FLOAT_EQ(fast_atan2f(0, -1), M_PI);
+    EXPECT_EQ(fast_atan2f(0, 0), 0);
+}
+
+TEST(FastMathTest, Asin)
+{
+    float max_err = 0;
+    for (float x = -1; x <= 1; x += 1e-6f) {
+        max_err = MAX(max_err, fabsf(fast_asinf(x) - asinf(x)));
+    }
+    EXPECT_LT(max_err, 2e-6f);
+    EXPECT_FLOAT_EQ(fast_asinf(1), M_PI_2);
+    EXPECT_FLOAT_EQ(fast_asinf(-1), -M_PI_2);
+
+    // out of range inputs behave like safe_asin()
+    EXPECT_FLOAT_EQ(fast_asinf(1.5f), M_PI_2);
+    EXPECT_FLOAT_EQ(fast_asinf(-1.5f), -M_PI_2);
+    EXPECT_EQ(fast_asinf(NaNf), 0);
+}
+
+TEST(FastMathTest, InvSqrt)
+{
+    // all normal floats, stepping through the mantissa bits
+    float max_err = 0;
+    for (uint32_t i = 0x00800000U; i < 0x7f800000U; i += 0x1001U) {
+        float x;
+        memcpy(&x, &i, sizeof(x));
+        const float ref = 1 / sqrtf(x);
+        max_err = MAX(max_err, fabsf(fast_inv_sqrtf(x) - ref) / ref);
+    }
+    EXPECT_LT(max_err, 5e-6f);
+}
+
+AP_GTEST_MAIN()
+
+#pragma GCC diagnostic pop
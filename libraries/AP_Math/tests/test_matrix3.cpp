@@ -103,6 +103,60 @@ TEST_P(Matrix3fTest, Inverses)
     }
 }
 
+// the SSE and NEON versions must match the scalar formulas
+TEST_P(Matrix3fTest, Multiplication)
+{
+    auto param = GetParam();
+    const Matrix3f &m = param.m;
+    const Vector3f v(0.3f, -1.7f, 2.9f);
+
+    const Vector3f mv = m * v;
+    const Vector3f mtv = m.mul_transpose(v);
+    for (uint8_t i = 0; i < 3; i++) {
+        EXPECT_FLOAT_EQ(m[i].x * v.x + m[i].y * v.y + m[i].z * v.z, mv[i]);
+        EXPECT_FLOAT_EQ(m.a[i] * v.x + m.b[i] * v.y + m.c[i] * v.z, mtv[i]);
+    }
+
+    const Matrix3f m2(Vector3f(0.5f, -2.0f, 1.25f),
+                      Vector3f(3.0f, 0.75f, -1.5f),
+                      Vector3f(-0.25f, 4.0f, 2.0f));
+    const Matrix3f mm = m * m2;
+    for (uint8_t i = 0; i < 3; i++) {
+        for (uint8_t j = 0; j < 3; j++) {
+            EXPECT_FLOAT_EQ(m[i].x * m2.a[j] + m[i].y * m2.b[j] + m[i].z * m2.c[j], mm[i][j]);
+        }
+    }
+}
+
+// as for Matrix3, the SSE and NEON Quaternion rotation must match the scalar formula
+TEST(QuaternionRotateTest, MatchesScalar)
+{
+    const Vector3f v(0.3f, -1.7f, 2.9f);
+    for (float roll = -3; roll <= 3; roll += 0.7f) {
+        for (float pitch = -1.5f; pitch <= 1.5f; pitch += 0.5f) {
+            for (float yaw = -3; yaw <= 3; yaw += 0.9f) {
+                Quaternion q;
+                q.from_euler(roll, pitch, yaw);
+
+                const float uv[] { 2 * (q.q3 * v.z - q.q4 * v.y),
+                                   2 * (q.q4 * v.x - q.q2 * v.z),
+                                   2 * (q.q2 * v.y - q.q3 * v.x) };
+                const Vector3f rv = q * v;
+                EXPECT_FLOAT_EQ(v.x + (q.q1 * uv[0] + q.q3 * uv[2] - q.q4 * uv[1]), rv.x);
+                EXPECT_FLOAT_EQ(v.y + (q.q1 * uv[1] + q.q4 * uv[0] - q.q2 * uv[2]), rv.y);
+                EXPECT_FLOAT_EQ(v.z + (q.q1 * uv[2] + q.q2 * uv[1] - q.q3 * uv[0]), rv.z);
+
+                Matrix3f m;
+                q.rotation_matrix(m);
+                const Vector3f mv = m * v;
+                EXPECT_NEAR(mv.x, rv.x, 1e-5);
+                EXPECT_NEAR(mv.y, rv.y, 1e-5);
+                EXPECT_NEAR(mv.z, rv.z, 1e-5);
+            }
+        }
+    }
+}
+
 INSTANTIATE_TEST_CASE_P(InvertibleMatrices,
                         Matrix3fTest,
                         ::testing::ValuesIn(invertible));
@@ -87,6 +87,10 @@ bool AP_MotorsMatrix::init(uint8_t expected_num_motors)
 
     normalise_rpy_factors();
 
+#if AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+    select_mixer();
+#endif
+
     set_update_rate(_speed_hz);
 
     return true;
@@ -211,6 +215,60 @@ float AP_MotorsMatrix::boost_ratio(float boost_value, float normal_value) const
 // output_armed - sends commands to the motors
 // includes new scaling stability patch
 void AP_MotorsMatrix::output_armed_stabilizing()
+{
+#if AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+    switch (_mixer_num_motors) {
+    case 4:
+        output_armed_stabilizing_mix<4, false>();
+        return;
+    case 6:
+        output_armed_stabilizing_mix<6, false>();
+        return;
+    case 8:
+        output_armed_stabilizing_mix<8, false>();
+        return;
+    default:
+        break;
+    }
+#endif
+    output_armed_stabilizing_mix<AP_MOTORS_MAX_NUM_MOTORS, true>();
+}
+
+#if AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+// use a fixed size mixer if the enabled motors are exactly the first 4, 6 or 8
+void AP_MotorsMatrix::select_mixer()
+{
+    _mixer_num_motors = 0;
+    uint8_t num_motors = 0;
+    while (num_motors < AP_MOTORS_MAX_NUM_MOTORS && motor_enabled[num_motors]) {
+        num_motors++;
+    }
+    for (uint8_t i = num_motors; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
+        if (motor_enabled[i]) {
+            return;
+        }
+    }
+    switch (num_motors) {
+    case 4:
+    case 6:
+    case 8:
+        _mixer_num_motors = num_motors;
+        break;
+    default:
+        break;
+    }
+}
+#endif
+
+/*
+  mix roll, pitch, yaw and throttle for motors 0 to N-1. The generic
+  mixer covers all motors and skips those that are not enabled, the
+  fixed size mixers are used when exactly the first N motors are
+  enabled so the loops have a constant trip count and no per motor
+  enabled checks
+ */
+template <uint8_t N, bool CHECK_ENABLED>
+void AP_MotorsMatrix::output_armed_stabilizing_mix()
 {
     // apply voltage and air pressure compensation
     const float compensation_gain = thr_lin.get_compensation_gain(); // compensation for battery voltage and altitude
@@ -274,26 +332,23 @@ void AP_MotorsMatrix::output_armed_stabilizing()
     // calculate amount of yaw we can fit into the throttle range
     // this is always equal to or less than the requested yaw from the pilot or rate controller
     float yaw_allowed = 1.0f; // amount of yaw we can fit in
-    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            // calculate the thrust outputs for roll and pitch
-            _thrust_rpyt_out[i] = roll_thrust * _roll_factor[i] + pitch_thrust * _pitch_factor[i];
-
-            // Check the maximum yaw control that can be used on this channel
-            // Exclude any lost motors if thrust boost is enabled
-            if (!is_zero(_yaw_factor[i]) && (!_thrust_boost || i != _motor_lost_index)) {
-                const float thrust_rp_best_throttle = throttle_thrust_best_rpy + _thrust_rpyt_out[i];
-                float motor_room;
-                if (is_positive(yaw_thrust * _yaw_factor[i])) {
-                    // room to upper limit
-                    motor_room = 1.0 - thrust_rp_best_throttle;
-                } else {
-                    // room to lower limit
-                    motor_room = thrust_rp_best_throttle;
-                }
-                const float motor_yaw_allowed = MAX(motor_room, 0.0)/fabsf(_yaw_factor[i]);
-                yaw_allowed = MIN(yaw_allowed, motor_yaw_allowed);
-            }
+    // motor excluded from the yaw headroom and saturation checks, no motor unless thrust boost is enabled
+    const uint8_t excluded_motor = _thrust_boost ? _motor_lost_index : UINT8_MAX;
+    for (uint8_t i = 0; i < N; i++) {
+        if (CHECK_ENABLED && !motor_enabled[i]) {
+            continue;
+        }
+        // calculate the thrust outputs for roll and pitch
+        _thrust_rpyt_out[i] = roll_thrust * _roll_factor[i] + pitch_thrust * _pitch_factor[i];
+
+        // Check the maximum yaw control that can be used on this channel
+        // Exclude any lost motors if thrust boost is enabled
+        if (!is_zero(_yaw_factor[i]) && i != excluded_motor) {
+            const float thrust_rp_best_throttle = throttle_thrust_best_rpy + _thrust_rpyt_out[i];
+            // room to upper limit or room to lower limit
+            const float motor_room = is_positive(yaw_thrust * _yaw_factor[i]) ? 1.0 - thrust_rp_best_throttle : thrust_rp_best_throttle;
+            const float motor_yaw_allowed = MAX(motor_room, 0.0)/fabsf(_yaw_factor[i]);
+            yaw_allowed = MIN(yaw_allowed, motor_yaw_allowed);
         }
     }
 
@@ -333,20 +388,18 @@ void AP_MotorsMatrix::output_armed_stabilizing()
     // add yaw control to thrust outputs
     float rpy_low = 1.0f;   // lowest thrust value
     float rpy_high = -1.0f; // highest thrust value
-    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            _thrust_rpyt_out[i] = _thrust_rpyt_out[i] + yaw_thrust * _yaw_factor[i];
-
-            // record lowest roll + pitch + yaw command
-            if (_thrust_rpyt_out[i] < rpy_low) {
-                rpy_low = _thrust_rpyt_out[i];
-            }
-            // record highest roll + pitch + yaw command
-            // Exclude any lost motors if thrust boost is enabled
-            if (_thrust_rpyt_out[i] > rpy_high && (!_thrust_boost || i != _motor_lost_index)) {
-                rpy_high = _thrust_rpyt_out[i];
-            }
+    for (uint8_t i = 0; i < N; i++) {
+        if (CHECK_ENABLED && !motor_enabled[i]) {
+            continue;
         }
+        const float thrust_rpy_out = _thrust_rpyt_out[i] + yaw_thrust * _yaw_factor[i];
+        _thrust_rpyt_out[i] = thrust_rpy_out;
+
+        // record lowest roll + pitch + yaw command
+        rpy_low = MIN(thrust_rpy_out, rpy_low);
+        // record highest roll + pitch + yaw command
+        // Exclude any lost motors if thrust boost is enabled
+        rpy_high = (i != excluded_motor) ? MAX(thrust_rpy_out, rpy_high) : rpy_high;
     }
     // Include the lost motor scaled by _thrust_boost_ratio to smoothly transition this motor in and out of the calculation
     if (_thrust_boost) {
@@ -389,10 +442,11 @@ void AP_MotorsMatrix::output_armed_stabilizing()
 
     // add scaled roll, pitch, constrained yaw and throttle for each motor
     const float throttle_thrust_best_plus_adj = throttle_thrust_best_rpy + thr_adj;
-    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            _thrust_rpyt_out[i] = (throttle_thrust_best_plus_adj * _throttle_factor[i]) + (rpy_scale * _thrust_rpyt_out[i]);
+    for (uint8_t i = 0; i < N; i++) {
+        if (CHECK_ENABLED && !motor_enabled[i]) {
+            continue;
         }
+        _thrust_rpyt_out[i] = (throttle_thrust_best_plus_adj * _throttle_factor[i]) + (rpy_scale * _thrust_rpyt_out[i]);
     }
 
     // determine throttle thrust for harmonic notch
@@ -512,6 +566,9 @@ void AP_MotorsMatrix::add_motor_raw(int8_t motor_num, float roll_fac, float pitc
 
         // enable motor
         motor_enabled[motor_num] = true;
+#if AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+        _mixer_num_motors = 0;
+#endif
 
         // set roll, pitch, yaw and throttle factors
         _roll_factor[motor_num] = roll_fac;
@@ -551,6 +608,9 @@ void AP_MotorsMatrix::remove_motor(int8_t motor_num)
     if (motor_num >= 0 && motor_num < AP_MOTORS_MAX_NUM_MOTORS) {
         // disable the motor, set all factors to zero
         motor_enabled[motor_num] = false;
+#if AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+        _mixer_num_motors = 0;
+#endif
         _roll_factor[motor_num] = 0.0f;
         _pitch_factor[motor_num] = 0.0f;
         _yaw_factor[motor_num] = 0.0f;
@@ -1346,6 +1406,10 @@ void AP_MotorsMatrix::setup_motors(motor_frame_class frame_class, motor_frame_ty
         _frame_class_string = "UNSUPPORTED";
     }
     set_initialised_ok(success);
+
+#if AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+    select_mixer();
+#endif
 }
 
 // normalizes the roll, pitch and yaw factors so maximum magnitude is 0.5
@@ -109,6 +109,15 @@ protected:
     // output - sends commands to the motors
     void                output_armed_stabilizing() override;
 
+    // mix for motors 0 to N-1, skipping motors that are not enabled if CHECK_ENABLED
+    template <uint8_t N, bool CHECK_ENABLED>
+    void                output_armed_stabilizing_mix();
+
+#if AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+    // select a fixed size mixer for the enabled motors, or the generic mixer
+    void                select_mixer();
+#endif
+
     // check for failed motor
     void                check_for_failed_motor(float throttle_thrust_best);
 
@@ -149,6 +158,10 @@ protected:
     float               _thrust_rpyt_out_filt[AP_MOTORS_MAX_NUM_MOTORS];    // filtered thrust outputs with 1 second time constant
     uint8_t             _motor_lost_index;  // index number of the lost motor
 
+#if AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+    uint8_t             _mixer_num_motors = 0;  // number of motors of the fixed size mixer in use, 0 for the generic mixer
+#endif
+
     motor_frame_class   _active_frame_class; // active frame class (i.e. quad, hexa, octa, etc)
     motor_frame_type    _active_frame_type;  // active frame type (i.e. plus, x, v, etc)
 
@@ -59,6 +59,11 @@
 #define AP_MOTORS_FRAME_OCTAQUAD_ENABLED AP_MOTORS_FRAME_DEFAULT_ENABLED
 #endif
 
+// use fixed size mixers for matrix frames with 4, 6 or 8 motors
+#ifndef AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+#define AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED (HAL_PROGRAM_SIZE_LIMIT_KB > 1024)
+#endif
+
 // scale factor for top layer to prevent beat frequency between top and bottom
 // layers of co-rotating motors. Must be less than 1.0
 #ifndef AP_MOTORS_FRAME_OCTAQUAD_COROTATING_SCALE_FACTOR
@@ -0,0 +1,61 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Motors/AP_Motors.h>
+#include <SRV_Channel/SRV_Channel.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#if AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+
+/*
+  cost of one fast loop iteration of the matrix mixer, comparing the
+  generic mixer with the fixed size mixer selected for the frame
+ */
+static SRV_Channels srvs;
+
+class AP_MotorsMatrix_Bench : public AP_MotorsMatrix {
+public:
+    using AP_MotorsMatrix::AP_MotorsMatrix;
+
+    void setup(motor_frame_class frame_class, bool generic) {
+        init(frame_class, MOTOR_FRAME_TYPE_X);
+        set_dt_s(1.0/400.0);
+        _throttle_thrust_max = 1.0;
+        if (generic) {
+            _mixer_num_motors = 0;
+        }
+    }
+
+    void mix(uint32_t n) {
+        // vary the inputs so each iteration does some saturation handling
+        const float t = n * 0.01;
+        set_roll(sinf(t));
+        set_pitch(cosf(t * 1.3));
+        set_yaw(0.5 * sinf(t * 0.7));
+        _throttle_filter.reset(0.5 + 0.4 * sinf(t * 0.3));
+        output_armed_stabilizing();
+    }
+};
+
+static AP_MotorsMatrix_Bench motors{400};
+
+static void BM_Mixer(benchmark::State& state, AP_Motors::motor_frame_class frame_class, bool generic)
+{
+    motors.setup(frame_class, generic);
+    uint32_t n = 0;
+    while (state.KeepRunning()) {
+        motors.mix(n++);
+        gbenchmark_escape(&motors);
+    }
+}
+
+BENCHMARK_CAPTURE(BM_Mixer, QuadGeneric, AP_Motors::MOTOR_FRAME_QUAD, true);
+BENCHMARK_CAPTURE(BM_Mixer, QuadFixed, AP_Motors::MOTOR_FRAME_QUAD, false);
+BENCHMARK_CAPTURE(BM_Mixer, HexaGeneric, AP_Motors::MOTOR_FRAME_HEXA, true);
+BENCHMARK_CAPTURE(BM_Mixer, HexaFixed, AP_Motors::MOTOR_FRAME_HEXA, false);
+BENCHMARK_CAPTURE(BM_Mixer, OctaGeneric, AP_Motors::MOTOR_FRAME_OCTA, true);
+BENCHMARK_CAPTURE(BM_Mixer, OctaFixed, AP_Motors::MOTOR_FRAME_OCTA, false);
+
+#endif  // AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+
+BENCHMARK_MAIN();
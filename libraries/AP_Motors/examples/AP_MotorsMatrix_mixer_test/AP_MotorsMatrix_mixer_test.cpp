@@ -0,0 +1,197 @@
+/*
+  check the fixed size matrix mixers give exactly the same outputs as
+  the generic mixer over a sweep of inputs, with and without thrust
+  boost
+
+  on Linux run with
+    ./waf configure --board linux
+    ./waf --targets examples/AP_MotorsMatrix_mixer_test
+    ./build/linux/examples/AP_MotorsMatrix_mixer_test
+*/
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_BattMonitor/AP_BattMonitor.h>
+#include <AP_Motors/AP_Motors.h>
+#include <SRV_Channel/SRV_Channel.h>
+#include <AP_ESC_Telem/AP_ESC_Telem.h>
+
+void setup();
+void loop();
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+// Instantiate a few classes that will be needed so that the singletons can be called from the motors lib
+#if HAL_WITH_ESC_TELEM
+AP_ESC_Telem esc_telem;
+#endif
+
+SRV_Channels srvs;
+AP_BattMonitor _battmonitor{0, nullptr, nullptr};
+
+#if AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+
+class AP_MotorsMatrix_MixerTest : public AP_MotorsMatrix {
+public:
+    using AP_MotorsMatrix::AP_MotorsMatrix;
+
+    uint8_t mixer_num_motors() const { return _mixer_num_motors; }
+
+    // state the mixer changes, saved so both mixers start from the same point
+    struct State {
+        float thrust_rpyt_out[AP_MOTORS_MAX_NUM_MOTORS];
+        float thrust_rpyt_out_filt[AP_MOTORS_MAX_NUM_MOTORS];
+        uint8_t motor_lost_index;
+        bool thrust_boost;
+        bool thrust_balanced;
+        AP_Motors_limit limit;
+    };
+
+    void get_state(State &state) const {
+        memcpy(state.thrust_rpyt_out, _thrust_rpyt_out, sizeof(state.thrust_rpyt_out));
+        memcpy(state.thrust_rpyt_out_filt, _thrust_rpyt_out_filt, sizeof(state.thrust_rpyt_out_filt));
+        state.motor_lost_index = _motor_lost_index;
+        state.thrust_boost = _thrust_boost;
+        state.thrust_balanced = _thrust_balanced;
+        state.limit = limit;
+    }
+
+    void set_state(const State &state) {
+        memcpy(_thrust_rpyt_out, state.thrust_rpyt_out, sizeof(_thrust_rpyt_out));
+        memcpy(_thrust_rpyt_out_filt, state.thrust_rpyt_out_filt, sizeof(_thrust_rpyt_out_filt));
+        _motor_lost_index = state.motor_lost_index;
+        _thrust_boost = state.thrust_boost;
+        _thrust_balanced = state.thrust_balanced;
+        limit = state.limit;
+    }
+
+    void set_inputs(float roll, float pitch, float yaw, float throttle, bool boost, float boost_ratio, uint8_t lost_index) {
+        set_roll(roll);
+        set_pitch(pitch);
+        set_yaw(yaw);
+        _throttle_filter.reset(throttle);
+        _throttle_thrust_max = 1.0;
+        _thrust_boost = boost;
+        _thrust_boost_ratio = boost_ratio;
+        _motor_lost_index = lost_index;
+        limit.set_all(false);
+    }
+
+    // run the fixed size mixer selected at init, or the generic mixer
+    void mix(bool generic) {
+        const uint8_t num_motors = _mixer_num_motors;
+        if (generic) {
+            _mixer_num_motors = 0;
+        }
+        output_armed_stabilizing();
+        _mixer_num_motors = num_motors;
+    }
+};
+
+static AP_MotorsMatrix_MixerTest motors{400};
+
+static const struct {
+    AP_Motors::motor_frame_class frame_class;
+    AP_Motors::motor_frame_type frame_type;
+} frames[] = {
+    { AP_Motors::MOTOR_FRAME_QUAD, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_QUAD, AP_Motors::MOTOR_FRAME_TYPE_PLUS },
+    { AP_Motors::MOTOR_FRAME_HEXA, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_OCTA, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_OCTA, AP_Motors::MOTOR_FRAME_TYPE_V },
+};
+
+static bool same_state(const AP_MotorsMatrix_MixerTest::State &a, const AP_MotorsMatrix_MixerTest::State &b)
+{
+    return memcmp(a.thrust_rpyt_out, b.thrust_rpyt_out, sizeof(a.thrust_rpyt_out)) == 0 &&
+           memcmp(a.thrust_rpyt_out_filt, b.thrust_rpyt_out_filt, sizeof(a.thrust_rpyt_out_filt)) == 0 &&
+           a.motor_lost_index == b.motor_lost_index &&
+           a.thrust_boost == b.thrust_boost &&
+           a.thrust_balanced == b.thrust_balanced &&
+           a.limit.roll == b.limit.roll &&
+           a.limit.pitch == b.limit.pitch &&
+           a.limit.yaw == b.limit.yaw &&
+           a.limit.throttle_lower == b.limit.throttle_lower &&
+           a.limit.throttle_upper == b.limit.throttle_upper;
+}
+
+void setup()
+{
+    hal.console->printf("AP_MotorsMatrix mixer test\n");
+
+    const float rpy_tests[] = {-1.0, -0.5, -0.1, 0.0, 0.2, 0.7, 1.0};
+    const float throttle_tests[] = {0.0, 0.1, 0.4, 0.7, 1.0};
+    const float boost_tests[] = {0.0, 0.5, 1.0};
+
+    motors.set_dt_s(1.0/400.0);
+
+    uint32_t failures = 0;
+    for (const auto &frame : frames) {
+        motors.init(frame.frame_class, frame.frame_type);
+        const uint8_t num_motors = motors.mixer_num_motors();
+        if (num_motors == 0) {
+            hal.console->printf("frame %u type %u: no fixed size mixer\n", frame.frame_class, frame.frame_type);
+            failures++;
+            continue;
+        }
+
+        uint32_t tests = 0;
+        uint32_t frame_failures = 0;
+        for (const float roll : rpy_tests) {
+            for (const float pitch : rpy_tests) {
+                for (const float yaw : rpy_tests) {
+                    for (const float throttle : throttle_tests) {
+                        for (const float boost_ratio : boost_tests) {
+                            for (uint8_t lost = 0; lost < num_motors; lost++) {
+                                const bool boost = is_positive(boost_ratio);
+                                if (!boost && lost > 0) {
+                                    break;
+                                }
+                                AP_MotorsMatrix_MixerTest::State initial, generic, fixed;
+                                motors.set_inputs(roll, pitch, yaw, throttle, boost, boost_ratio, lost);
+                                motors.get_state(initial);
+
+                                motors.mix(true);
+                                motors.get_state(generic);
+
+                                motors.set_state(initial);
+                                motors.mix(false);
+                                motors.get_state(fixed);
+
+                                tests++;
+                                if (!same_state(generic, fixed)) {
+                                    if (frame_failures++ < 5) {
+                                        hal.console->printf("mismatch R %.1f P %.1f Y %.1f T %.1f boost %.1f lost %u\n",
+                                                            roll, pitch, yaw, throttle, boost_ratio, lost);
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        hal.console->printf("frame %u type %u, %u motors: %u tests %u failures\n",
+                            frame.frame_class, frame.frame_type, num_motors,
+                            unsigned(tests), unsigned(frame_failures));
+        failures += frame_failures;
+    }
+
+    hal.console->printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+    hal.scheduler->delay(1000);
+    exit(failures == 0 ? 0 : 1);
+}
+
+#else
+
+void setup()
+{
+    hal.console->printf("AP_MotorsMatrix fixed size mixers not enabled\n");
+}
+
+#endif  // AP_MOTORS_MATRIX_FIXED_MIXER_ENABLED
+
+void loop()
+{
+}
+
+AP_HAL_MAIN();
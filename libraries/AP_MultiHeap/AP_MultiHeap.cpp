@@ -7,6 +7,7 @@
 #include "AP_MultiHeap.h"
 
 #include <AP_Math/AP_Math.h>
+#include <AP_InternalError/AP_InternalError.h>
 #include <stdio.h>
 
 /*
@@ -66,6 +67,7 @@ void MultiHeap::destroy(void)
     if (!available()) {
         return;
     }
+    slab_destroy();
     for (uint8_t i=0; i<num_heaps; i++) {
         if (heaps[i].hp != nullptr) {
             heap_destroy(heaps[i].hp);
@@ -93,6 +95,14 @@ void *MultiHeap::allocate(uint32_t size)
     if (!available() || size == 0) {
         return nullptr;
     }
+    const uint8_t slab_class = slab_class_for(size);
+    if (slab.region != nullptr && slab_class != SLAB_CLASS_NONE) {
+        void *newptr = slab_allocate(slab_class);
+        if (newptr != nullptr) {
+            last_failed = false;
+            return newptr;
+        }
+    }
     for (uint8_t i=0; i<num_heaps; i++) {
         if (heaps[i].hp == nullptr) {
             break;
@@ -166,6 +176,10 @@ void MultiHeap::deallocate(void *ptr)
     if (!available() || ptr == nullptr) {
         return;
     }
+    if (in_slab(ptr)) {
+        slab_free(ptr);
+        return;
+    }
     heap_free(ptr);
 }
 
@@ -185,6 +199,10 @@ void *MultiHeap::change_size(void *ptr, uint32_t old_size, uint32_t new_size)
       of having to move the allocation to a new heap, so we do a
       simple alloc/copy/deallocate for reallocation
      */
+    if (in_slab(ptr) && slab.page_info[((uint8_t *)ptr - slab.pages) / MULTIHEAP_SLAB_PAGE_SIZE].slab_class == slab_class_for(new_size)) {
+        // still fits in the same size class
+        return ptr;
+    }
     void *newp = allocate(new_size);
     if (ptr == nullptr) {
         return newp;
@@ -201,3 +219,181 @@ void *MultiHeap::change_size(void *ptr, uint32_t old_size, uint32_t new_size)
     deallocate(ptr);
     return newp;
 }
+
+/*
+  size class slabs for small allocations
+ */
+static const uint16_t slab_object_sizes[MultiHeap::num_slab_classes] { 16, 32, 64, 128 };
+
+uint8_t MultiHeap::slab_class_for(uint32_t size)
+{
+    for (uint8_t i=0; i<num_slab_classes; i++) {
+        if (size <= slab_object_sizes[i]) {
+            return i;
+        }
+    }
+    return SLAB_CLASS_NONE;
+}
+
+/*
+  reserve a region of the first heap for slabs
+ */
+bool MultiHeap::create_slabs(uint32_t region_size)
+{
+    if (!available() || slab.region != nullptr) {
+        return false;
+    }
+    const uint16_t num_pages = MIN(region_size / (MULTIHEAP_SLAB_PAGE_SIZE + sizeof(SlabPage)), SLAB_PAGE_NONE-1U);
+    if (num_pages == 0) {
+        return false;
+    }
+    // keep pages 16 byte aligned
+    const uint32_t info_size = (num_pages * sizeof(SlabPage) + 15U) & ~15U;
+    void *region = heap_allocate(heaps[0].hp, info_size + uint32_t(num_pages) * MULTIHEAP_SLAB_PAGE_SIZE);
+    if (region == nullptr) {
+        return false;
+    }
+
+    slab.region = region;
+    slab.page_info = (SlabPage *)region;
+    slab.pages = (uint8_t *)region + info_size;
+    slab.num_pages = num_pages;
+    slab.free_pages = SLAB_PAGE_NONE;
+    for (uint16_t i=0; i<num_pages; i++) {
+        slab.page_info[i].slab_class = SLAB_CLASS_NONE;
+        slab_list_push(slab.free_pages, i);
+    }
+    for (uint8_t i=0; i<num_slab_classes; i++) {
+        slab.partial[i] = SLAB_PAGE_NONE;
+        slab.stats[i] = {};
+        slab.stats[i].object_size = slab_object_sizes[i];
+        slab.stats[i].objects_per_page = MULTIHEAP_SLAB_PAGE_SIZE / slab_object_sizes[i];
+    }
+    return true;
+}
+
+// free the slab region, all slab allocations must have been freed
+void MultiHeap::slab_destroy(void)
+{
+    if (slab.region == nullptr) {
+        return;
+    }
+    heap_free(slab.region);
+    slab.region = nullptr;
+}
+
+// get usage of a slab class
+bool MultiHeap::get_slab_stats(uint8_t slab_class, SlabStats &stats) const
+{
+    if (slab.region == nullptr || slab_class >= num_slab_classes) {
+        return false;
+    }
+    stats = slab.stats[slab_class];
+    return true;
+}
+
+// add a page to the head of a list
+void MultiHeap::slab_list_push(uint16_t &head, uint16_t page)
+{
+    SlabPage &pg = slab.page_info[page];
+    pg.prev = SLAB_PAGE_NONE;
+    pg.next = head;
+    if (head != SLAB_PAGE_NONE) {
+        slab.page_info[head].prev = page;
+    }
+    head = page;
+}
+
+// remove a page from a list
+void MultiHeap::slab_list_remove(uint16_t &head, uint16_t page)
+{
+    SlabPage &pg = slab.page_info[page];
+    if (pg.prev != SLAB_PAGE_NONE) {
+        slab.page_info[pg.prev].next = pg.next;
+    } else {
+        head = pg.next;
+    }
+    if (pg.next != SLAB_PAGE_NONE) {
+        slab.page_info[pg.next].prev = pg.prev;
+    }
+    pg.next = SLAB_PAGE_NONE;
+    pg.prev = SLAB_PAGE_NONE;
+}
+
+/*
+  allocate an object of a slab class, returns nullptr if there are no free pages
+ */
+void *MultiHeap::slab_allocate(uint8_t slab_class)
+{
+    SlabStats &stats = slab.stats[slab_class];
+    uint16_t page = slab.partial[slab_class];
+    if (page == SLAB_PAGE_NONE) {
+        // assign a free page to this class
+        page = slab.free_pages;
+        if (page == SLAB_PAGE_NONE) {
+            return nullptr;
+        }
+        slab_list_remove(slab.free_pages, page);
+        SlabPage &pg = slab.page_info[page];
+        pg.free_list = nullptr;
+        pg.bump = 0;
+        pg.used = 0;
+        pg.slab_class = slab_class;
+        slab_list_push(slab.partial[slab_class], page);
+        stats.pages++;
+        stats.pages_max = MAX(stats.pages_max, stats.pages);
+    }
+
+    SlabPage &pg = slab.page_info[page];
+    void *obj;
+    if (pg.free_list != nullptr) {
+        obj = pg.free_list;
+        pg.free_list = *(void **)obj;
+    } else {
+        obj = slab.pages + uint32_t(page) * MULTIHEAP_SLAB_PAGE_SIZE + pg.bump;
+        pg.bump += stats.object_size;
+    }
+    pg.used++;
+
+    if (pg.used == stats.objects_per_page) {
+        // page is full
+        slab_list_remove(slab.partial[slab_class], page);
+    }
+
+    stats.objects++;
+    stats.objects_max = MAX(stats.objects_max, stats.objects);
+    return obj;
+}
+
+/*
+  free an object allocated with slab_allocate
+ */
+void MultiHeap::slab_free(void *ptr)
+{
+    const uint16_t page = ((uint8_t *)ptr - slab.pages) / MULTIHEAP_SLAB_PAGE_SIZE;
+    SlabPage &pg = slab.page_info[page];
+    const uint8_t slab_class = pg.slab_class;
+    if (slab_class >= num_slab_classes || pg.used == 0) {
+        INTERNAL_ERROR(AP_InternalError::error_t::flow_of_control);
+        return;
+    }
+    SlabStats &stats = slab.stats[slab_class];
+
+    const bool was_full = (pg.used == stats.objects_per_page);
+    *(void **)ptr = pg.free_list;
+    pg.free_list = ptr;
+    pg.used--;
+    stats.objects--;
+
+    if (pg.used == 0) {
+        // return empty page to the free list so any class can use it
+        if (!was_full) {
+            slab_list_remove(slab.partial[slab_class], page);
+        }
+        pg.slab_class = SLAB_CLASS_NONE;
+        slab_list_push(slab.free_pages, page);
+        stats.pages--;
+    } else if (was_full) {
+        slab_list_push(slab.partial[slab_class], page);
+    }
+}
@@ -12,6 +12,13 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/*
+  size of each slab page. Pages are assigned to a single size class
+ */
+#ifndef MULTIHEAP_SLAB_PAGE_SIZE
+#define MULTIHEAP_SLAB_PAGE_SIZE 512
+#endif
+
 class MultiHeap {
 public:
     /*
@@ -40,6 +47,28 @@ public:
         return expanded_to;
     }
 
+    /*
+      reserve region_size bytes of the first heap for size class
+      slabs. Allocations of up to 128 bytes are then served from
+      per-class free lists in constant time, falling back to the
+      heaps when the slabs are full
+     */
+    bool create_slabs(uint32_t region_size);
+
+    static constexpr uint8_t num_slab_classes = 4;
+
+    struct SlabStats {
+        uint16_t object_size;       // size of objects in this class
+        uint16_t objects_per_page;  // number of objects that fit in a page
+        uint32_t objects;           // objects currently allocated
+        uint32_t objects_max;       // high-water mark of objects allocated
+        uint32_t pages;             // pages currently assigned to this class
+        uint32_t pages_max;         // high-water mark of pages assigned
+    };
+
+    // get usage of a slab class, returns false if slabs are not in use
+    bool get_slab_stats(uint8_t slab_class, SlabStats &stats) const;
+
 private:
     struct Heap {
         void *hp;
@@ -57,6 +86,47 @@ private:
     // re-use memory when possible
     bool last_failed;
 
+    /*
+      slab allocator for small objects
+     */
+    static constexpr uint16_t SLAB_PAGE_NONE = 0xFFFF;
+    static constexpr uint8_t SLAB_CLASS_NONE = 0xFF;
+
+    struct SlabPage {
+        void *free_list;        // objects freed back to this page
+        uint16_t bump;          // offset of the first object never allocated from this page
+        uint16_t used;          // number of objects allocated from this page
+        uint16_t next;          // next page in the class's partial list or the free page list
+        uint16_t prev;          // previous page in the list
+        uint8_t slab_class;     // class of objects in this page, SLAB_CLASS_NONE if unassigned
+    };
+
+    struct {
+        void *region;           // allocation holding the page info and pages, nullptr if slabs are not in use
+        uint8_t *pages;         // start of first page
+        SlabPage *page_info;    // information for each page
+        uint16_t num_pages;
+        uint16_t free_pages;    // list of pages not assigned to a class
+        uint16_t partial[num_slab_classes]; // list of pages with free objects for each class
+        SlabStats stats[num_slab_classes];
+    } slab;
+
+    // return slab class for an allocation size, or SLAB_CLASS_NONE if too large
+    static uint8_t slab_class_for(uint32_t size);
+
+    // return true if ptr was allocated from the slabs
+    bool in_slab(const void *ptr) const {
+        return slab.region != nullptr &&
+            (const uint8_t *)ptr >= slab.pages &&
+            (const uint8_t *)ptr < slab.pages + uint32_t(slab.num_pages) * MULTIHEAP_SLAB_PAGE_SIZE;
+    }
+
+    void *slab_allocate(uint8_t slab_class);
+    void slab_free(void *ptr);
+    void slab_list_push(uint16_t &head, uint16_t page);
+    void slab_list_remove(uint16_t &head, uint16_t page);
+    void slab_destroy(void);
+
 
     /*
       low level allocation functions
@@ -0,0 +1,113 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_MultiHeap/AP_MultiHeap.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  replay an allocation pattern similar to a lua scripting workload:
+  mostly small, short lived strings, tables and userdata with some
+  larger table arrays and closures, resized in place as lua does
+ */
+
+static const uint32_t heap_size = 200*1024;
+static const uint16_t max_live = 1500;
+
+struct Alloc {
+    void *ptr;
+    uint32_t size;
+};
+
+static uint32_t next_random(uint32_t &seed)
+{
+    seed = seed * 1664525U + 1013904223U;
+    return seed >> 8;
+}
+
+static uint32_t lua_like_size(uint32_t r)
+{
+    const uint32_t bucket = r % 20;
+    if (bucket < 8) {
+        return 16 + r % 17;         // short strings, boxed numbers
+    }
+    if (bucket < 14) {
+        return 32 + r % 33;         // tables, closures, userdata
+    }
+    if (bucket < 18) {
+        return 64 + r % 65;         // table nodes, upvalues
+    }
+    return 128 + r % 900;           // table arrays, long strings, prototypes
+}
+
+static void run_workload(benchmark::State& state, bool use_slabs)
+{
+    static MultiHeap h;
+    if (!h.create(heap_size, 10, false, 0) ||
+        (use_slabs && !h.create_slabs(heap_size / 4))) {
+        h.destroy();
+        state.SetLabel("heap create failed");
+        while (state.KeepRunning()) {}
+        return;
+    }
+
+    auto *allocs = new Alloc[max_live] {};
+    uint32_t seed = 1;
+    uint32_t live_bytes = 0;
+    uint32_t peak_live_bytes = 0;
+    uint64_t num_allocs = 0;
+
+    while (state.KeepRunning()) {
+        const uint32_t r = next_random(seed);
+        Alloc &a = allocs[r % max_live];
+        // a quarter of operations free, the rest allocate or resize
+        const uint32_t new_size = ((r >> 12) % 4 == 0) ? 0 : lua_like_size(next_random(seed));
+        void *p = h.change_size(a.ptr, a.size, new_size);
+        if (p == nullptr && new_size != 0) {
+            // heap full, leave this object as it was
+            continue;
+        }
+        live_bytes = live_bytes - a.size + new_size;
+        peak_live_bytes = MAX(peak_live_bytes, live_bytes);
+        a.ptr = p;
+        a.size = new_size;
+        num_allocs++;
+        gbenchmark_escape(p);
+    }
+
+    uint32_t slab_pages_max = 0;
+    for (uint8_t i=0; i<MultiHeap::num_slab_classes; i++) {
+        MultiHeap::SlabStats stats;
+        if (h.get_slab_stats(i, stats)) {
+            slab_pages_max += stats.pages_max;
+        }
+    }
+
+    for (uint16_t i=0; i<max_live; i++) {
+        h.deallocate(allocs[i].ptr);
+    }
+    delete[] allocs;
+    h.destroy();
+
+    // items per second is the allocation rate
+    state.SetItemsProcessed(num_allocs);
+    char label[64];
+    snprintf(label, sizeof(label), "peak live %u bytes, slab pages max %u",
+             unsigned(peak_live_bytes), unsigned(slab_pages_max));
+    state.SetLabel(label);
+}
+
+static void BM_MultiHeapGeneral(benchmark::State& state)
+{
+    run_workload(state, false);
+}
+
+static void BM_MultiHeapSlabs(benchmark::State& state)
+{
+    run_workload(state, true);
+}
+
+BENCHMARK(BM_MultiHeapGeneral);
+BENCHMARK(BM_MultiHeapSlabs);
+
+BENCHMARK_MAIN();
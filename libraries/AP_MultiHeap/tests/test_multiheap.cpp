@@ -54,4 +54,69 @@ TEST(MultiHeap, Tests)
     delete[] allocs;
 }
 
+TEST(MultiHeap, Slabs)
+{
+    static MultiHeap h;
+
+    EXPECT_TRUE(h.create(150000, 10, false, 10000));
+    EXPECT_TRUE(h.create_slabs(20000));
+    EXPECT_FALSE(h.create_slabs(20000));
+
+    const uint32_t max_allocs = 500;
+    struct alloc {
+        void *ptr;
+        uint32_t size;
+    };
+    auto *allocs = new alloc[max_allocs] {};
+
+    for (uint32_t i=0; i<20000; i++) {
+        uint16_t idx = get_random16() % max_allocs;
+        auto &a = allocs[idx];
+        // mostly small allocations, some too large for the slabs
+        const uint16_t size = (get_random16() % 4 == 0) ? get_random16() % 300 : get_random16() % 130;
+        a.ptr = h.change_size(a.ptr, a.size, size);
+        EXPECT_TRUE(size==0?a.ptr == nullptr : a.ptr != nullptr);
+        if (a.ptr != nullptr) {
+            // the part that was kept must survive moving between classes and heaps
+            for (uint32_t j=0; j<MIN(a.size, uint32_t(size)); j++) {
+                EXPECT_EQ(((uint8_t *)a.ptr)[j], uint8_t(idx & 0xFF));
+            }
+            memset(a.ptr, idx & 0xFF, size);
+        }
+        a.size = size;
+    }
+
+    // contents must survive resizing between classes
+    for (uint32_t i=0; i<max_allocs; i++) {
+        auto &a = allocs[i];
+        for (uint32_t j=0; j<a.size; j++) {
+            EXPECT_EQ(((uint8_t *)a.ptr)[j], uint8_t(i & 0xFF));
+        }
+    }
+
+    for (uint8_t i=0; i<MultiHeap::num_slab_classes; i++) {
+        MultiHeap::SlabStats stats;
+        EXPECT_TRUE(h.get_slab_stats(i, stats));
+        EXPECT_LE(stats.objects, stats.objects_max);
+        EXPECT_LE(stats.objects, stats.pages * stats.objects_per_page);
+    }
+
+    for (uint32_t i=0; i<max_allocs; i++) {
+        auto &a = allocs[i];
+        h.deallocate(a.ptr);
+        a.size = 0;
+    }
+
+    // all pages are returned when empty
+    for (uint8_t i=0; i<MultiHeap::num_slab_classes; i++) {
+        MultiHeap::SlabStats stats;
+        EXPECT_TRUE(h.get_slab_stats(i, stats));
+        EXPECT_EQ(stats.objects, 0U);
+        EXPECT_EQ(stats.pages, 0U);
+        EXPECT_GT(stats.objects_max, 0U);
+    }
+    h.destroy();
+    delete[] allocs;
+}
+
 AP_GTEST_MAIN()
@@ -1692,7 +1692,7 @@ void AP_OSD_Screen::draw_gspeed(uint8_t x, uint8_t y)
     float angle = 0;
     const float length = v.length();
     if (length > 1.0f) {
-        angle = atan2f(v.y, v.x) - ahrs.get_yaw_rad();
+        angle = fast_atan2f(v.y, v.x) - ahrs.get_yaw_rad();
     }
     draw_speed(x + 1, y, angle, length);
 }
@@ -1721,8 +1721,8 @@ void AP_OSD_Screen::draw_horizon(uint8_t x, uint8_t y)
     }
 
     pitch = constrain_float(pitch, -ah_max_pitch, ah_max_pitch);
-    float ky = sinf(roll);
-    float kx = cosf(roll);
+    float ky = fast_sinf(roll);
+    float kx = fast_cosf(roll);
 
     float ratio = backend->get_aspect_ratio_correction();
 
@@ -1947,7 +1947,7 @@ void AP_OSD_Screen::draw_wind(uint8_t x, uint8_t y)
         if (check_option(AP_OSD::OPTION_INVERTED_WIND)) {
             angle = M_PI;
         }
-        angle = angle + atan2f(v.y, v.x) - ahrs.get_yaw_rad();
+        angle = angle + fast_atan2f(v.y, v.x) - ahrs.get_yaw_rad();
     } 
     draw_speed(x + 1, y, angle, length);
 
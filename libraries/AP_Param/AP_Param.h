@@ -571,6 +571,11 @@ public:
     // invalidate parameter count
     static void invalidate_count(void);
 
+    // changes each time the count is invalidated, which includes any
+    // change to the parameter tree, callers caching find() results
+    // must discard them when this changes
+    static uint16_t get_count_marker(void) { return _count_marker; }
+
     static void set_hide_disabled_groups(bool value) { _hide_disabled_groups = value; }
 
     // set frame type flags. Used to unhide frame specific parameters
@@ -81,7 +81,7 @@ const AP_Param::GroupInfo AP_Scripting::var_info[] = {
 
     // @Param: HEAP_SIZE
     // @DisplayName: Scripting Heap Size
-    // @Description: Amount of memory available for scripting
+    // @Description: Amount of memory available for scripting. A quarter of this is reserved for allocations of 128 bytes or less, so larger allocations can use at most three quarters of it
     // @Range: 1024 1048576
     // @Increment: 1024
     // @User: Advanced
@@ -94,10 +94,11 @@ const AP_Param::GroupInfo AP_Scripting::var_info[] = {
     // @Bitmask: 0: No Scripts to run message if all scripts have stopped
     // @Bitmask: 1: Runtime messages for memory usage and execution time
     // @Bitmask: 2: Suppress logging scripts to dataflash
-    // @Bitmask: 3: log runtime memory usage and execution time
+    // @Bitmask: 3: log runtime memory usage and execution time (SCR), and VM steps, allocations and peak heap of each run (LUAS)
     // @Bitmask: 4: Disable pre-arm check
     // @Bitmask: 5: Save CRC of current scripts to loaded and running checksum parameters enabling pre-arm
     // @Bitmask: 6: Disable heap expansion on allocation failure
+    // @Bitmask: 7: Profile scripts, sampled call stacks are available in @SYS/scripts_profile.txt
     // @User: Advanced
     AP_GROUPINFO("DEBUG_OPTS", 4, AP_Scripting, _debug_options, 0),
 
@@ -165,6 +166,25 @@ const AP_Param::GroupInfo AP_Scripting::var_info[] = {
     // @User: Advanced
     AP_GROUPINFO("THD_PRIORITY", 14, AP_Scripting, _thd_priority, uint8_t(ThreadPriority::NORMAL)),
 
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+    // @Param: ISO_THREADS
+    // @DisplayName: Scripting isolated threads
+    // @Description: Maximum number of scripts from the isolated subdirectory of the scripts directory that are run in their own lua state and thread, so they are not delayed by other scripts. Calls into the vehicle are still serialised by the semaphores of the objects being called. Scripts beyond this number are run with all other scripts, so with 0 the scripts in the isolated subdirectory are loaded into the main state. Older firmware ignored that subdirectory.
+    // @Range: 0 4
+    // @RebootRequired: True
+    // @User: Advanced
+    AP_GROUPINFO("ISO_THREADS", 19, AP_Scripting, _isolated_threads, 0),
+
+    // @Param: ISO_HEAP
+    // @DisplayName: Scripting isolated heap size
+    // @Description: Amount of memory available for each isolated script, this is in addition to SCR_HEAP_SIZE
+    // @Range: 1024 1048576
+    // @Increment: 1024
+    // @RebootRequired: True
+    // @User: Advanced
+    AP_GROUPINFO("ISO_HEAP", 20, AP_Scripting, _isolated_heap_size, 50*1024),
+#endif
+
 #if AP_SCRIPTING_SERIALDEVICE_ENABLED
     // @Param: SDEV_EN
     // @DisplayName: Scripting serial device enable
@@ -233,6 +253,15 @@ void AP_Scripting::init(void) {
     }
 #endif
 
+    if (!create_thread(FUNCTOR_BIND_MEMBER(&AP_Scripting::thread, void), "Scripting")) {
+        GCS_SEND_TEXT(MAV_SEVERITY_ERROR, "Scripting: %s", "failed to start");
+        _thread_failed = true;
+    }
+}
+
+// create a thread for running scripts at SCR_THD_PRIORITY
+bool AP_Scripting::create_thread(AP_HAL::MemberProc proc, const char *name)
+{
     AP_HAL::Scheduler::priority_base priority = AP_HAL::Scheduler::PRIORITY_SCRIPTING;
     static const struct {
         ThreadPriority scr_priority;
@@ -254,11 +283,7 @@ void AP_Scripting::init(void) {
         }
     }
 
-    if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&AP_Scripting::thread, void),
-                                      "Scripting", SCRIPTING_STACK_SIZE, priority, 0)) {
-        GCS_SEND_TEXT(MAV_SEVERITY_ERROR, "Scripting: %s", "failed to start");
-        _thread_failed = true;
-    }
+    return hal.scheduler->thread_create(proc, name, SCRIPTING_STACK_SIZE, priority, 0);
 }
 
 #if AP_SCRIPTING_SERIALDEVICE_ENABLED
@@ -390,6 +415,25 @@ void AP_Scripting::thread(void) {
     }
 }
 
+void AP_Scripting::wake(WakeEvent event)
+{
+    lua_scripts::wake(uint8_t(event));
+}
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+void AP_Scripting::profile_info(ExpandingString &str)
+{
+    lua_scripts::profile_info(str);
+}
+#endif
+
+#if AP_SCRIPTING_RUN_STATS_ENABLED
+void AP_Scripting::run_stats_info(ExpandingString &str)
+{
+    lua_scripts::run_stats_info(str);
+}
+#endif
+
 void AP_Scripting::handle_mission_command(const AP_Mission::Mission_Command& cmd_in)
 {
 #if AP_MISSION_ENABLED
@@ -488,6 +532,7 @@ void AP_Scripting::handle_message(const mavlink_message_t &msg, const mavlink_ch
         }
         if (mavlink_data.accept_msg_ids[i] == msg.msgid) {
             mavlink_data.rx_buffer->push(data);
+            wake(WakeEvent::MAVLINK_RX);
             return;
         }
     }
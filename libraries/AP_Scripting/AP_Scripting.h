@@ -95,6 +95,17 @@ public:
     };
     uint16_t get_disabled_dir() { return uint16_t(_dir_disable.get());}
 
+    // create a thread for running scripts at SCR_THD_PRIORITY
+    bool create_thread(AP_HAL::MemberProc proc, const char *name);
+
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+    uint8_t get_isolated_threads() const { return uint8_t(MAX(_isolated_threads.get(), 0)); }
+    const AP_Int32 &get_isolated_heap_size() const { return _isolated_heap_size; }
+#endif
+
+    // protects the device and socket storage below, which is shared by all lua states
+    HAL_Semaphore resource_sem;
+
     // the number of and storage for i2c devices
     uint8_t num_i2c_devices;
     AP_HAL::I2CDevice *_i2c_dev[SCRIPTING_MAX_NUM_I2C_DEVICE];
@@ -116,13 +127,13 @@ public:
         uint32_t time_ms;
     };
     ObjectBuffer<struct scripting_mission_cmd> * mission_data;
+    // scripts in isolated threads share mission_data, which only supports one reader
+    HAL_Semaphore mission_data_sem;
 #endif
 
     // PWMSource storage
     uint8_t num_pwm_source;
     AP_HAL::PWMSource *_pwm_source[SCRIPTING_MAX_NUM_PWM_SOURCE];
-    int get_current_env_ref() { return current_env_ref; }
-    void set_current_env_ref(int ref) { current_env_ref = ref; }
 
 #if AP_NETWORKING_ENABLED
     // SocketAPM storage
@@ -161,8 +172,30 @@ public:
         DISABLE_PRE_ARM = 1U << 4,
         SAVE_CHECKSUM = 1U << 5,
         DISABLE_HEAP_EXPANSION = 1U << 6,
+        PROFILE = 1U << 7,
     };
 
+    // events that run a script before its next run time, see lua_scripts::wake_on
+    enum class WakeEvent : uint8_t {
+        MAVLINK_RX = 1U << 0,
+        CAN_RX = 1U << 1,
+        SERIALDEVICE_RX = 1U << 2,
+        PARAM_SET = 1U << 3,
+    };
+
+    // wake scripts waiting on the event, may be called from any thread
+    void wake(WakeEvent event);
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+    // sampled call stacks of scripts for @SYS/scripts_profile.txt
+    void profile_info(ExpandingString &str);
+#endif
+
+#if AP_SCRIPTING_RUN_STATS_ENABLED
+    // run time percentiles and resource usage of scripts for @SYS/scripts.txt
+    void run_stats_info(ExpandingString &str);
+#endif
+
 private:
 
     void thread(void); // main script execution thread
@@ -196,6 +229,11 @@ private:
 
     AP_Enum<ThreadPriority> _thd_priority;
 
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+    AP_Int8 _isolated_threads;
+    AP_Int32 _isolated_heap_size;
+#endif
+
     bool option_is_set(DebugOption option) const {
         return (uint8_t(_debug_options.get()) & uint8_t(option)) != 0;
     }
@@ -210,7 +248,6 @@ private:
     bool _stop; // true if scripts should be stopped
 
     static AP_Scripting *_singleton;
-    int current_env_ref;
 };
 
 namespace AP {
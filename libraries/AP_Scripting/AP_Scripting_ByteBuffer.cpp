@@ -0,0 +1,315 @@
+#include "AP_Scripting_config.h"
+
+#if AP_SCRIPTING_BYTEBUFFER_ENABLED
+
+#include "AP_Scripting_ByteBuffer.h"
+#include <AP_Scripting/lua_generated_bindings.h>
+
+static_assert(SCRIPTING_BYTEBUFFER_COUNT <= 32, "pool in use mask is 32 bits");
+static_assert(SCRIPTING_BYTEBUFFER_SIZE <= UINT16_MAX, "buffer size must fit in 16 bits");
+
+extern const AP_HAL::HAL& hal;
+
+uint8_t *AP_Scripting_ByteBuffer::pool;
+uint32_t AP_Scripting_ByteBuffer::pool_in_use;
+HAL_Semaphore AP_Scripting_ByteBuffer::pool_sem;
+
+bool AP_Scripting_ByteBuffer::alloc(uint32_t capacity)
+{
+    WITH_SEMAPHORE(pool_sem);
+
+    if (pool == nullptr) {
+        // never freed, so buffers can be handed out again after a scripting restart
+        pool = (uint8_t *)hal.util->malloc_type(SCRIPTING_BYTEBUFFER_COUNT * SCRIPTING_BYTEBUFFER_SIZE, AP_HAL::Util::MEM_FAST);
+        if (pool == nullptr) {
+            return false;
+        }
+    }
+
+    for (uint8_t i = 0; i < SCRIPTING_BYTEBUFFER_COUNT; i++) {
+        if ((pool_in_use & (1U << i)) == 0) {
+            pool_in_use |= (1U << i);
+            _slot = i;
+            _data = &pool[i * SCRIPTING_BYTEBUFFER_SIZE];
+            _capacity = capacity;
+            _len = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+// return the storage to the pool
+int AP_Scripting_ByteBuffer::__gc(lua_State *L)
+{
+    AP_Scripting_ByteBuffer *buf = check_AP_Scripting_ByteBuffer(L, 1);
+
+    WITH_SEMAPHORE(pool_sem);
+    if (buf->_slot >= 0) {
+        pool_in_use &= ~(1U << buf->_slot);
+        buf->_slot = -1;
+        buf->_data = nullptr;
+        buf->_capacity = 0;
+        buf->_len = 0;
+    }
+    return 0;
+}
+
+void AP_Scripting_ByteBuffer::consume(uint32_t count)
+{
+    if (count >= _len) {
+        _len = 0;
+        return;
+    }
+    memmove(_data, &_data[count], _len - count);
+    _len -= count;
+}
+
+uint32_t AP_Scripting_ByteBuffer::append(const uint8_t *bytes, uint32_t count)
+{
+    count = MIN(count, space());
+    memcpy(tail(), bytes, count);
+    _len += count;
+    return count;
+}
+
+// Lua constructor, ByteBuffer(capacity) with capacity defaulting to the pool buffer size
+int lua_new_ByteBuffer(lua_State *L)
+{
+    const int args = lua_gettop(L);
+    if (args > 1) {
+        return luaL_argerror(L, args, "too many arguments");
+    }
+    uint32_t capacity = SCRIPTING_BYTEBUFFER_SIZE;
+    if (args == 1) {
+        capacity = get_uint32(L, 1, 1, SCRIPTING_BYTEBUFFER_SIZE);
+    }
+
+    AP_Scripting_ByteBuffer *buf = new_AP_Scripting_ByteBuffer(L);
+    if (!buf->alloc(capacity)) {
+        // buffers the script no longer references keep their slot until
+        // they are collected, so collect and try once more
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        if (!buf->alloc(capacity)) {
+            return luaL_error(L, "no byte buffers free");
+        }
+    }
+    return 1;
+}
+
+/*
+  formats are a subset of string.pack:
+    < > =  little, big and native (little) endian
+    b B    signed and unsigned 8 bit integer
+    h H    signed and unsigned 16 bit integer
+    i[n] I[n]  signed and unsigned integer of n bytes, default 4
+    f d    float and double
+    x      one byte of padding
+ */
+namespace {
+
+enum class ItemType : uint8_t {
+    INTEGER,
+    FLOAT,
+    DOUBLE,
+    PADDING,
+};
+
+struct PackItem {
+    ItemType type;
+    uint8_t size;
+    bool is_signed;
+};
+
+// parse the next item from the format, returns false at the end of the format
+bool next_item(lua_State *L, const char *&fmt, bool &little_endian, PackItem &item)
+{
+    while (*fmt != '\0') {
+        const char opt = *fmt++;
+        switch (opt) {
+        case ' ':
+            continue;
+        case '<':
+        case '=':
+            little_endian = true;
+            continue;
+        case '>':
+            little_endian = false;
+            continue;
+        case 'b':
+        case 'B':
+            item = { ItemType::INTEGER, 1, opt == 'b' };
+            return true;
+        case 'h':
+        case 'H':
+            item = { ItemType::INTEGER, 2, opt == 'h' };
+            return true;
+        case 'i':
+        case 'I': {
+            uint8_t size = 0;
+            while (*fmt >= '0' && *fmt <= '9') {
+                size = size * 10 + (*fmt++ - '0');
+                if (size > sizeof(lua_Integer)) {
+                    break;
+                }
+            }
+            if (size == 0) {
+                size = 4;
+            }
+            if (size > sizeof(lua_Integer)) {
+                luaL_error(L, "integral size out of limits [1,%d]", int(sizeof(lua_Integer)));
+            }
+            item = { ItemType::INTEGER, size, opt == 'i' };
+            return true;
+        }
+        case 'f':
+            item = { ItemType::FLOAT, sizeof(float), true };
+            return true;
+        case 'd':
+            item = { ItemType::DOUBLE, sizeof(double), true };
+            return true;
+        case 'x':
+            item = { ItemType::PADDING, 1, false };
+            return true;
+        default:
+            luaL_error(L, "invalid format option '%c'", opt);
+        }
+    }
+    return false;
+}
+
+uint64_t read_bytes(const uint8_t *p, uint8_t size, bool little_endian)
+{
+    uint64_t v = 0;
+    for (uint8_t i = 0; i < size; i++) {
+        const uint8_t b = little_endian ? p[size - 1 - i] : p[i];
+        v = (v << 8) | b;
+    }
+    return v;
+}
+
+void write_bytes(uint8_t *p, uint64_t v, uint8_t size, bool little_endian)
+{
+    for (uint8_t i = 0; i < size; i++) {
+        p[little_endian ? i : size - 1 - i] = v & 0xFF;
+        v >>= 8;
+    }
+}
+
+}  // namespace
+
+// buf:unpack_at(fmt, offset), returns the values followed by the offset of the next unread byte, offsets are 1 based
+int AP_Scripting_ByteBuffer::unpack_at(lua_State *L)
+{
+    binding_argcheck(L, 3);
+
+    AP_Scripting_ByteBuffer *buf = check_AP_Scripting_ByteBuffer(L, 1);
+    const char *fmt = luaL_checkstring(L, 2);
+    const uint32_t offset = get_uint32(L, 3, 1, buf->_len + 1) - 1;
+
+    bool little_endian = true;
+    PackItem item;
+    uint32_t pos = offset;
+    int results = 0;
+    while (next_item(L, fmt, little_endian, item)) {
+        if (item.size > buf->_len - pos) {
+            return luaL_argerror(L, 2, "data too short");
+        }
+        luaL_checkstack(L, 2, "too many results");
+        const uint8_t *p = &buf->_data[pos];
+        pos += item.size;
+        switch (item.type) {
+        case ItemType::INTEGER: {
+            uint64_t v = read_bytes(p, item.size, little_endian);
+            if (item.is_signed && item.size < 8) {
+                // sign extend
+                const uint64_t sign = 1ULL << (item.size * 8 - 1);
+                v = (v ^ sign) - sign;
+            }
+            lua_pushinteger(L, (lua_Integer)v);
+            break;
+        }
+        case ItemType::FLOAT: {
+            const uint32_t v = read_bytes(p, item.size, little_endian);
+            float f;
+            memcpy(&f, &v, sizeof(f));
+            lua_pushnumber(L, f);
+            break;
+        }
+        case ItemType::DOUBLE: {
+            const uint64_t v = read_bytes(p, item.size, little_endian);
+            double d;
+            memcpy(&d, &v, sizeof(d));
+            lua_pushnumber(L, (lua_Number)d);
+            break;
+        }
+        case ItemType::PADDING:
+            continue;
+        }
+        results++;
+    }
+
+    lua_pushinteger(L, pos + 1);
+    return results + 1;
+}
+
+// buf:pack_at(fmt, offset, values...), returns the offset of the byte after the last one written, offsets are 1 based
+int AP_Scripting_ByteBuffer::pack_at(lua_State *L)
+{
+    AP_Scripting_ByteBuffer *buf = check_AP_Scripting_ByteBuffer(L, 1);
+    const char *fmt = luaL_checkstring(L, 2);
+    const uint32_t offset = get_uint32(L, 3, 1, buf->_len + 1) - 1;
+
+    bool little_endian = true;
+    PackItem item;
+    uint32_t pos = offset;
+    int arg = 4;
+    while (next_item(L, fmt, little_endian, item)) {
+        if (item.size > buf->_capacity - pos) {
+            return luaL_argerror(L, 2, "buffer full");
+        }
+        uint8_t *p = &buf->_data[pos];
+        switch (item.type) {
+        case ItemType::INTEGER:
+            write_bytes(p, (uint64_t)luaL_checkinteger(L, arg++), item.size, little_endian);
+            break;
+        case ItemType::FLOAT: {
+            const float f = luaL_checknumber(L, arg++);
+            uint32_t v;
+            memcpy(&v, &f, sizeof(v));
+            write_bytes(p, v, item.size, little_endian);
+            break;
+        }
+        case ItemType::DOUBLE: {
+            const double d = luaL_checknumber(L, arg++);
+            uint64_t v;
+            memcpy(&v, &d, sizeof(v));
+            write_bytes(p, v, item.size, little_endian);
+            break;
+        }
+        case ItemType::PADDING:
+            *p = 0;
+            break;
+        }
+        pos += item.size;
+    }
+    if (arg <= lua_gettop(L)) {
+        return luaL_argerror(L, arg, "too many values");
+    }
+
+    buf->_len = MAX(buf->_len, pos);
+    lua_pushinteger(L, pos + 1);
+    return 1;
+}
+
+// contents as a string, for passing to functions that only take strings
+int AP_Scripting_ByteBuffer::tostring(lua_State *L)
+{
+    binding_argcheck(L, 1);
+
+    AP_Scripting_ByteBuffer *buf = check_AP_Scripting_ByteBuffer(L, 1);
+    lua_pushlstring(L, (const char *)buf->_data, buf->_len);
+    return 1;
+}
+
+#endif  // AP_SCRIPTING_BYTEBUFFER_ENABLED
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "AP_Scripting_config.h"
+
+#if AP_SCRIPTING_BYTEBUFFER_ENABLED
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include "lua/src/lua.hpp"
+
+int lua_new_ByteBuffer(lua_State *L);
+
+/*
+  byte buffer for protocol drivers, bulk reads and writes go straight
+  between the device and the buffer and values are packed and unpacked
+  in place, so parsing a frame doesn't create any strings. The storage
+  comes from a fixed pool shared by all scripts and is returned to it
+  when the buffer is garbage collected.
+ */
+class AP_Scripting_ByteBuffer {
+public:
+    static int __gc(lua_State *L);
+    static int unpack_at(lua_State *L);
+    static int pack_at(lua_State *L);
+    static int tostring(lua_State *L);
+
+    // number of bytes in use
+    uint32_t len() const { return _len; }
+
+    // number of bytes the buffer can hold
+    uint32_t capacity() const { return _capacity; }
+
+    // number of bytes that can be appended
+    uint32_t space() const { return _capacity - _len; }
+
+    void clear() { _len = 0; }
+
+    // remove count bytes from the start of the buffer, moving the rest down
+    void consume(uint32_t count);
+
+    // append bytes, returns the number of bytes that fitted
+    uint32_t append(const uint8_t *bytes, uint32_t count);
+
+    // start of the buffer and first free byte
+    uint8_t *data() const { return _data; }
+    uint8_t *tail() const { return &_data[_len]; }
+
+    // mark count more bytes as used after writing to tail()
+    void advance(uint32_t count) { _len = MIN(_len + count, _capacity); }
+
+private:
+    friend int lua_new_ByteBuffer(lua_State *L);
+
+    // take storage from the pool, returns false if it is exhausted
+    bool alloc(uint32_t capacity);
+
+    uint8_t *_data = nullptr;
+    uint16_t _capacity;
+    uint16_t _len;
+    int8_t _slot = -1;
+
+    // storage for all the buffers, allocated on first use
+    static uint8_t *pool;
+    static uint32_t pool_in_use;
+    static HAL_Semaphore pool_sem;
+};
+
+#endif  // AP_SCRIPTING_BYTEBUFFER_ENABLED
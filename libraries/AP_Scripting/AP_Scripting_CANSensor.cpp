@@ -16,6 +16,7 @@
   Scripting CANSensor class, for easy scripting CAN support
  */
 #include "AP_Scripting_CANSensor.h"
+#include "AP_Scripting.h"
 #include <AP_Math/AP_Math.h>
 
 #if AP_SCRIPTING_CAN_SENSOR_ENABLED
@@ -79,6 +80,7 @@ void ScriptingCANBuffer::handle_frame(AP_HAL::CANFrame &frame)
     // Add to buffer for scripting to read
     if (accept) {
         buffer.push(frame);
+        AP::scripting()->wake(AP_Scripting::WakeEvent::CAN_RX);
     }
 
     // filtering is not applied to other buffers
@@ -108,7 +108,11 @@ void AP_Scripting_SerialDevice::Port::_begin(uint32_t b, uint16_t rxS, uint16_t
 size_t AP_Scripting_SerialDevice::Port::_write(const uint8_t *buffer, size_t size)
 {
     WITH_SEMAPHORE(sem);
-    return writebuffer != nullptr ? writebuffer->write(buffer, size) : 0;
+    const size_t written = writebuffer != nullptr ? writebuffer->write(buffer, size) : 0;
+    if (written > 0) {
+        AP::scripting()->wake(AP_Scripting::WakeEvent::SERIALDEVICE_RX);
+    }
+    return written;
 }
 
 ssize_t AP_Scripting_SerialDevice::Port::_read(uint8_t *buffer, uint16_t count)
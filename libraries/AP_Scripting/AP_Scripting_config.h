@@ -3,6 +3,8 @@
 #include <AP_HAL/AP_HAL_Boards.h>
 #include <AP_SerialManager/AP_SerialManager_config.h>
 #include <AP_Vehicle/AP_Vehicle_config.h>
+#include <AP_Vehicle/AP_Vehicle_Type.h>
+#include <AP_Crypto/AP_Crypto_config.h>
 
 #ifndef AP_SCRIPTING_ENABLED
 #define AP_SCRIPTING_ENABLED (HAL_PROGRAM_SIZE_LIMIT_KB > 1024)
@@ -20,6 +22,51 @@
 #define AP_SCRIPTING_SERIALDEVICE_ENABLED AP_SERIALMANAGER_REGISTER_ENABLED && (HAL_PROGRAM_SIZE_LIMIT_KB>1024)
 #endif
 
+// decrypt AP_Crypto scripts and encrypt their bytecode cache, AP_Crypto and
+// the LAS_ parameters holding its key are only built into Plane
+#ifndef AP_SCRIPTING_CRYPTO_ENABLED
+#define AP_SCRIPTING_CRYPTO_ENABLED (AP_SCRIPTING_ENABLED && AP_CRYPTO_ENABLED && APM_BUILD_TYPE(APM_BUILD_ArduPlane))
+#endif
+
+// cache the compiled bytecode of scripts to speed up loading, needs a writable filesystem
+#ifndef AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+#define AP_SCRIPTING_BYTECODE_CACHE_ENABLED (AP_SCRIPTING_ENABLED && (AP_FILESYSTEM_POSIX_ENABLED || AP_FILESYSTEM_FATFS_ENABLED || AP_FILESYSTEM_ESP32_ENABLED || AP_FILESYSTEM_LITTLEFS_ENABLED))
+#endif
+
+// run the scripts in the isolated directory each in their own lua state and thread
+#ifndef AP_SCRIPTING_ISOLATED_STATES_ENABLED
+#define AP_SCRIPTING_ISOLATED_STATES_ENABLED (AP_SCRIPTING_ENABLED && (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX))
+#endif
+
+#ifndef SCRIPTING_MAX_ISOLATED_STATES
+#define SCRIPTING_MAX_ISOLATED_STATES 4
+#endif
+
+// sample the call stacks of running scripts into @SYS/scripts_profile.txt
+#ifndef AP_SCRIPTING_PROFILER_ENABLED
+#define AP_SCRIPTING_PROFILER_ENABLED (AP_SCRIPTING_ENABLED && AP_FILESYSTEM_SYS_ENABLED)
+#endif
+
+// per script run time percentiles and resource usage in @SYS/scripts.txt
+#ifndef AP_SCRIPTING_RUN_STATS_ENABLED
+#define AP_SCRIPTING_RUN_STATS_ENABLED (AP_SCRIPTING_ENABLED && AP_FILESYSTEM_SYS_ENABLED)
+#endif
+
+// preallocated byte buffers for bulk serial and CAN access from scripts
+#ifndef AP_SCRIPTING_BYTEBUFFER_ENABLED
+#define AP_SCRIPTING_BYTEBUFFER_ENABLED AP_SCRIPTING_ENABLED
+#endif
+
+// size in bytes of each buffer in the pool
+#ifndef SCRIPTING_BYTEBUFFER_SIZE
+#define SCRIPTING_BYTEBUFFER_SIZE 256
+#endif
+
+// number of buffers in the pool shared by all scripts, at most 32
+#ifndef SCRIPTING_BYTEBUFFER_COUNT
+#define SCRIPTING_BYTEBUFFER_COUNT 16
+#endif
+
 // bindings configuration
 #ifndef AP_SCRIPTING_BINDING_MOTORS_ENABLED
 #define AP_SCRIPTING_BINDING_MOTORS_ENABLED (AP_SCRIPTING_ENABLED && AP_VEHICLE_ENABLED)
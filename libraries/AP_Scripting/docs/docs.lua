@@ -414,6 +414,10 @@ function CAN:get_device(buffer_len) end
 ---@return ScriptingCANBuffer_ud|nil
 function CAN:get_device2(buffer_len) end
 
+-- Run the calling script as soon as a CAN frame is received by either scripting driver
+-- rather than waiting for its next run time. Applies until the script errors or scripting restarts.
+function CAN:wake_on_receive() end
+
 
 -- get latest FlexDebug message from a CAN node
 ---@param bus number -- CAN bus number, 0 for first bus, 1 for 2nd
@@ -522,6 +526,55 @@ function motor_factor_table_ud:roll(index) end
 ---@param value number
 function motor_factor_table_ud:roll(index, value) end
 
+-- Byte buffer for protocol drivers, serial and CAN data is read into and written
+-- from it in bulk, and values are packed and unpacked in place without creating strings.
+-- Buffers come from a fixed pool shared by all scripts, so create them once when
+-- the script loads rather than on each update. Offsets are 1 based as with string.unpack.
+---@class (exact) AP_Scripting_ByteBuffer_ud
+local AP_Scripting_ByteBuffer_ud = {}
+
+-- Get a new byte buffer from the pool, errors if none are free
+---@param capacity? integer -- size of the buffer in bytes, defaults to and at most SCRIPTING_BYTEBUFFER_SIZE (256)
+---@return AP_Scripting_ByteBuffer_ud
+function ByteBuffer(capacity) end
+
+-- Number of bytes in the buffer
+---@return uint32_t_ud
+function AP_Scripting_ByteBuffer_ud:len() end
+
+-- Maximum number of bytes the buffer can hold
+---@return uint32_t_ud
+function AP_Scripting_ByteBuffer_ud:capacity() end
+
+-- Number of bytes that can still be added to the buffer
+---@return uint32_t_ud
+function AP_Scripting_ByteBuffer_ud:space() end
+
+-- Empty the buffer
+function AP_Scripting_ByteBuffer_ud:clear() end
+
+-- Remove bytes from the start of the buffer, typically once a frame has been parsed
+---@param count uint32_t_ud|integer|number -- number of bytes to remove
+function AP_Scripting_ByteBuffer_ud:consume(count) end
+
+-- Unpack values from the buffer, formats are the subset of string.pack formats
+-- < > = b B h H i[n] I[n] f d and x, integers are at most 4 bytes
+---@param fmt string -- format
+---@param offset integer -- offset of the first byte to unpack
+---@return any ... -- unpacked values followed by the offset of the next unread byte
+function AP_Scripting_ByteBuffer_ud:unpack_at(fmt, offset) end
+
+-- Pack values into the buffer, extending its length if writing past the end
+---@param fmt string -- format, as for unpack_at
+---@param offset integer -- offset of the first byte to write, at most len() + 1
+---@param ... integer|number -- values to pack
+---@return integer -- offset of the byte after the last one written
+function AP_Scripting_ByteBuffer_ud:pack_at(fmt, offset, ...) end
+
+-- Copy the contents of the buffer to a string
+---@return string
+function AP_Scripting_ByteBuffer_ud:tostring() end
+
 -- network socket class
 ---@class (exact) SocketAPM_ud
 local SocketAPM_ud = {}
@@ -1224,6 +1277,13 @@ local ScriptingCANBuffer_ud = {}
 ---@return CANFrame_ud|nil
 function ScriptingCANBuffer_ud:read_frame() end
 
+-- Read frames into the end of a byte buffer while they fit. Each frame is 13 bytes:
+-- a little endian uint32 id including the flag bits, the dlc and the first 8 data bytes,
+-- so can be unpacked with "<I4BBBBBBBBB"
+---@param buffer AP_Scripting_ByteBuffer_ud
+---@return integer -- number of frames read
+function ScriptingCANBuffer_ud:read_frames_into(buffer) end
+
 -- Add a filter to the CAN buffer, mask is bitwise ANDed with the frame id and compared to value if not match frame is not buffered
 -- By default no filters are added and all frames are buffered, write is not affected by filters
 -- Maximum number of filters is 8
@@ -1336,6 +1396,16 @@ function AP_Scripting_SerialAccess_ud:read() end
 ---@return string|nil -- bytes actually read, which may be 0-length, or nil on error
 function AP_Scripting_SerialAccess_ud:readstring(count) end
 
+-- Reads as many bytes as are available and fit into the end of the buffer.
+---@param buffer AP_Scripting_ByteBuffer_ud -- buffer to append to
+---@return integer|nil -- number of bytes read, which may be 0, or nil on error
+function AP_Scripting_SerialAccess_ud:readinto(buffer) end
+
+-- Writes the contents of the buffer to the serial port, the buffer is not changed.
+---@param buffer AP_Scripting_ByteBuffer_ud -- buffer to write
+---@return integer -- number of bytes actually written, which may be 0
+function AP_Scripting_SerialAccess_ud:write_from(buffer) end
+
 -- Returns number of available bytes to read.
 ---@return uint32_t_ud
 function AP_Scripting_SerialAccess_ud:available() end
@@ -2346,6 +2416,10 @@ function param:add_table(table_key, prefix, num_params) end
 ---@return boolean
 function param:add_param(table_key, param_num, name, default_value) end
 
+-- Run the calling script as soon as a parameter is set from the GCS
+-- rather than waiting for its next run time. Applies until the script errors or scripting restarts.
+function param:wake_on_change() end
+
 -- desc
 ---@class (exact) ESCTelemetryData_ud
 local ESCTelemetryData_ud = {}
@@ -2505,6 +2579,10 @@ function serial:find_serial(instance) end
 ---@return AP_Scripting_SerialAccess_ud|nil -- access object for that instance, or nil if not found
 function serial:find_simulated_device(protocol, instance) end
 
+-- Run the calling script as soon as data is written to any simulated device port
+-- rather than waiting for its next run time. Applies until the script errors or scripting restarts.
+function serial:wake_on_receive() end
+
 
 -- desc
 rc = {}
@@ -3705,6 +3783,11 @@ function ahrs:handle_external_position_estimate(location, accuracy, timestamp_ms
 ---@return Quaternion_ud|nil
 function ahrs:get_quaternion() end
 
+-- Same as get_quaternion, but writes into the given Quaternion rather than allocating a new one
+---@param quat Quaternion_ud -- quaternion to fill
+---@return Quaternion_ud|nil -- quat if the attitude is available
+function ahrs:get_quaternion_into(quat) end
+
 -- desc
 ---@return integer
 function ahrs:get_posvelyaw_source_set() end
@@ -3791,14 +3874,29 @@ function ahrs:get_relative_position_D_home() end
 ---@return Vector3f_ud|nil
 function ahrs:get_relative_position_NED_origin() end
 
+-- Same as get_relative_position_NED_origin, but writes into the given Vector3f rather than allocating a new one
+---@param vec Vector3f_ud -- vector to fill
+---@return Vector3f_ud|nil -- vec if the position is available
+function ahrs:get_relative_position_NED_origin_into(vec) end
+
 -- desc
 ---@return Vector3f_ud|nil
 function ahrs:get_relative_position_NED_home() end
 
+-- Same as get_relative_position_NED_home, but writes into the given Vector3f rather than allocating a new one
+---@param vec Vector3f_ud -- vector to fill
+---@return Vector3f_ud|nil -- vec if the position is available
+function ahrs:get_relative_position_NED_home_into(vec) end
+
 -- Returns nil, or a Vector3f containing the current NED vehicle velocity in meters/second in north, east, and down components.
 ---@return Vector3f_ud|nil -- North, east, down velcoity in meters / second if available
 function ahrs:get_velocity_NED() end
 
+-- Same as get_velocity_NED, but writes into the given Vector3f rather than allocating a new one
+---@param vel Vector3f_ud -- vector to fill
+---@return Vector3f_ud|nil -- vel if the velocity is available
+function ahrs:get_velocity_NED_into(vel) end
+
 -- Get current groundspeed vector in meter / second
 ---@return Vector2f_ud -- ground speed vector, North East, meters / second
 function ahrs:groundspeed_vector() end
@@ -3844,6 +3942,17 @@ function ahrs:get_location() end
 ---@return Location_ud|nil
 function ahrs:get_position() end
 
+-- Same as get_location, but writes into the given Location rather than allocating a new one.
+-- Useful for scripts that fetch the position at high rate, the Location can be created once and reused.
+---@param loc Location_ud -- location to fill
+---@return Location_ud|nil -- loc if the current location is available
+function ahrs:get_location_into(loc) end
+
+-- same as `get_location_into`
+---@param loc Location_ud
+---@return Location_ud|nil
+function ahrs:get_position_into(loc) end
+
 -- Returns the current vehicle euler yaw angle in radians.
 ---@return number -- yaw angle in radians.
 ---@deprecated -- get_yaw_rad
@@ -4025,6 +4134,10 @@ function mavlink:send_chan(chan, msgid, message) end
 ---@return boolean
 function mavlink:block_command(comand_id) end
 
+-- Run the calling script as soon as a registered message is received
+-- rather than waiting for its next run time. Applies until the script errors or scripting restarts.
+function mavlink:wake_on_receive() end
+
 -- Geofence library
 fence = {}
 
@@ -0,0 +1,112 @@
+-- Microbenchmark of the cost of calling generated bindings.
+-- Compares methods that allocate a new userdata for each result with their
+-- _into variants that fill in an object passed in by the script, and reports
+-- the time and Lua heap used per call every 5 seconds.
+-- Results include the Lua loop overhead, the "empty" test shows how much that is.
+
+local ITERATIONS = 1000
+
+local loc = Location()
+local vec = Vector3f()
+
+local function empty()
+  for _ = 1, ITERATIONS do
+  end
+end
+
+local function get_position()
+  for _ = 1, ITERATIONS do
+    ahrs:get_position()
+  end
+end
+
+local function get_position_into()
+  for _ = 1, ITERATIONS do
+    ahrs:get_position_into(loc)
+  end
+end
+
+local function get_velocity_NED()
+  for _ = 1, ITERATIONS do
+    ahrs:get_velocity_NED()
+  end
+end
+
+local function get_velocity_NED_into()
+  for _ = 1, ITERATIONS do
+    ahrs:get_velocity_NED_into(vec)
+  end
+end
+
+-- only checks the argument, nothing is allocated
+local function vector_field()
+  for _ = 1, ITERATIONS do
+    vec:x()
+  end
+end
+
+-- allocates the result
+local function vector_add()
+  local sum
+  for _ = 1, ITERATIONS do
+    sum = vec + vec
+  end
+  return sum
+end
+
+-- name lookup on each call, through the parameter name cache
+local function param_get()
+  for _ = 1, ITERATIONS do
+    param:get("SCR_VM_I_COUNT")
+  end
+end
+
+-- lookup done once when the object was created
+local vm_i_count = Parameter("SCR_VM_I_COUNT")
+local function parameter_get()
+  for _ = 1, ITERATIONS do
+    vm_i_count:get()
+  end
+end
+
+local tests = {
+  { "empty", empty },
+  { "get_position", get_position },
+  { "get_position_into", get_position_into },
+  { "get_velocity_NED", get_velocity_NED },
+  { "get_velocity_NED_into", get_velocity_NED_into },
+  { "Vector3f:x", vector_field },
+  { "Vector3f add", vector_add },
+  { "param:get", param_get },
+  { "Parameter:get", parameter_get },
+}
+
+local test_index = 1
+
+local function run_test(name, func)
+  -- start from a clean heap so the memory difference is only this test
+  collectgarbage("collect")
+  collectgarbage("stop")
+  local mem_start = collectgarbage("count")
+  local start_us = micros()
+  func()
+  local elapsed_us = (micros() - start_us):toint()
+  local mem_used = (collectgarbage("count") - mem_start) * 1024
+  collectgarbage("restart")
+
+  gcs:send_text(6, string.format("bench %s: %.2f us %.1f bytes per call", name, elapsed_us / ITERATIONS, mem_used / ITERATIONS))
+end
+
+-- one test per run, so the script stays well within its time slice
+local function update()
+  local test = tests[test_index]
+  run_test(test[1], test[2])
+  test_index = test_index + 1
+  if test_index > #tests then
+    test_index = 1
+    return update, 5000
+  end
+  return update, 100
+end
+
+return update, 5000
@@ -0,0 +1,19 @@
+-- Reacts to SCR_USER1 changes as soon as they are set from the GCS, while
+-- only polling once every 10 seconds otherwise
+
+local user_param = Parameter('SCR_USER1')
+local last_value = user_param:get()
+
+-- run this script straight away whenever a parameter is set
+param:wake_on_change()
+
+local function update()
+  local value = user_param:get()
+  if value ~= last_value then
+    gcs:send_text(6, string.format("SCR_USER1 changed to %.2f", value))
+    last_value = value
+  end
+  return update, 10000
+end
+
+return update()
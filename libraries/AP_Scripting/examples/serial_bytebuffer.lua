@@ -0,0 +1,49 @@
+-- Parses frames from a scripting serial port using a byte buffer, so no strings
+-- are created while reading. Frames are a 0xA5 header, uint8 length, then that
+-- many payload bytes holding a little endian int16 and float, and a uint8 sum
+-- of the payload bytes.
+
+local HEADER = 0xA5
+local PAYLOAD_LEN = 6
+
+-- find the first scripting serial port instance, SERIALx_PROTOCOL 28
+local port = assert(serial:find_serial(0), "Could not find Scripting Serial Port")
+port:begin(115200)
+port:set_flow_control(0)
+
+-- allocated once, the storage comes from a fixed pool
+local buf = ByteBuffer()
+
+local function parse()
+  while buf:len() >= 2 + PAYLOAD_LEN + 1 do
+    local header, len = buf:unpack_at("BB", 1)
+    if header ~= HEADER or len ~= PAYLOAD_LEN then
+      -- resync on the next byte
+      buf:consume(1)
+    else
+      local value, reading, next = buf:unpack_at("<hf", 3)
+      local sum = 0
+      for i = 3, next - 1 do
+        sum = sum + buf:unpack_at("B", i)
+      end
+      local checksum = buf:unpack_at("B", next)
+      if (sum & 0xFF) == checksum then
+        gcs:send_text(6, string.format("value %d reading %.2f", value, reading))
+      end
+      buf:consume(next)
+    end
+  end
+end
+
+local function update()
+  if port:readinto(buf) then
+    parse()
+  end
+  if buf:space() == 0 then
+    -- nothing parseable in a full buffer
+    buf:clear()
+  end
+  return update, 20
+end
+
+return update()
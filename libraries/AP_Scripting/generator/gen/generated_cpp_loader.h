@@ -21,26 +21,68 @@ void * new_ap_object(lua_State *L, size_t size, const char * name) {
     return ud;
 }
 
-void set_userdata_metatable(lua_State *L, const char * name) {
-    if (luaL_newmetatable(L, name)) { // metatable just created, set it up
-        for (uint32_t i = 0; i < ARRAY_SIZE(userdata_fun); i++) {
-            if (strcmp(name, userdata_fun[i].name) == 0) {
-                lua_pushcfunction(L, userdata_fun[i].func);
-                lua_setfield(L, -2, "__index");
-                if (userdata_fun[i].operators != nullptr) {
-                    luaL_setfuncs(L, userdata_fun[i].operators, 0);
-                }
-                break;
+static_assert(ARRAY_SIZE(userdata_fun) == USERDATA_INDEX_COUNT, "userdata index must match userdata_fun");
+
+// each state caches registry references to the userdata metatables, indexed by
+// userdata_index, so creation and type checks don't need a string keyed lookup.
+// A pointer to them is kept in the state's extra space, which new threads copy
+static int * get_metatable_refs(lua_State *L) {
+    return *(int **)lua_getextraspace(L);
+}
+
+void load_generated_bindings(lua_State *L) {
+    int * refs = (int *)lua_newuserdata(L, sizeof(int) * USERDATA_INDEX_COUNT);
+    for (uint32_t i = 0; i < USERDATA_INDEX_COUNT; i++) {
+        refs[i] = LUA_NOREF;
+    }
+    luaL_ref(L, LUA_REGISTRYINDEX); // keep the references alive for the life of the state
+    *(int **)lua_getextraspace(L) = refs;
+}
+
+void set_userdata_metatable(lua_State *L, uint8_t index) {
+    int * refs = get_metatable_refs(L);
+    if (refs[index] != LUA_NOREF) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, refs[index]);
+    } else {
+        if (luaL_newmetatable(L, userdata_fun[index].name)) { // metatable just created, set it up
+            lua_pushcfunction(L, userdata_fun[index].func);
+            lua_setfield(L, -2, "__index");
+            if (userdata_fun[index].operators != nullptr) {
+                luaL_setfuncs(L, userdata_fun[index].operators, 0);
             }
         }
-        // if no name matched, the metatable will be pointless but otherwise
-        // valid, so it's safe to continue. since this function isn't
-        // accessible to user code, it's probably not worth raising an error.
+        lua_pushvalue(L, -1);
+        refs[index] = luaL_ref(L, LUA_REGISTRYINDEX);
     }
     // correct metatable is on stack regardless of if we just set it up
     lua_setmetatable(L, -2);
 }
 
+void * test_userdata(lua_State *L, int arg, uint8_t index) {
+    void * ud = lua_touserdata(L, arg);
+    if ((ud == nullptr) || !lua_getmetatable(L, arg)) {
+        return nullptr;
+    }
+    const int ref = get_metatable_refs(L)[index];
+    bool matched = false;
+    if (ref != LUA_NOREF) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+        matched = lua_rawequal(L, -1, -2);
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+    return matched ? ud : nullptr;
+}
+
+void * check_userdata(lua_State *L, int arg, uint8_t index) {
+    void * ud = test_userdata(L, arg, index);
+    if (ud != nullptr) {
+        return ud;
+    }
+    // generates the standard type error
+    return luaL_checkudata(L, arg, userdata_fun[index].name);
+}
+
 static int binding_index(lua_State *L) {
     const char * name = luaL_checkstring(L, 2);
 
@@ -33,6 +33,7 @@ char keyword_creation[]            = "creation";
 char keyword_manual_operator[]     = "manual_operator";
 char keyword_operator_getter[]     = "operator_getter";
 char keyword_field_valid_mask[]    = "valid_mask";
+char keyword_into[]                = "into";
 
 
 // attributes (should include the leading ' )
@@ -365,6 +366,8 @@ struct method {
   char *sanitized_name;  // sanitized name of the C++ singleton
   char *rename; // (optional) used for scripting access
   char *deprecate; // (optional) issue deprecation warning string on first call
+  char *cpp_name; // (optional) name of the C++ method if it differs from name
+  int into; // userdata out arguments are passed in by the caller rather than allocated
   int line; // line declared on
   struct type return_type;
   struct argument * arguments;
@@ -784,6 +787,44 @@ void handle_userdata_field(struct userdata *data) {
   field->access_flags = parse_access_flags(&(field->type));
 }
 
+int is_out_userdata(const struct type *type) {
+  return (type->type == TYPE_USERDATA) && (type->flags & (TYPE_FLAGS_NULLABLE | TYPE_FLAGS_REFERENCE));
+}
+
+// add a variant of a method that writes its userdata out arguments into
+// objects passed in by the caller, avoiding an allocation for each call
+void handle_into_method(struct userdata *node, const struct method *source_method, char *into_name) {
+  struct method * method = node->methods;
+  while (method != NULL && strcmp(method->name, into_name)) {
+    method = method-> next;
+  }
+  if (method != NULL) {
+    error(ERROR_USERDATA, "Method %s already exists for %s (declared on %d) cannot add into variant of %s", into_name, node->name, method->line, source_method->name);
+  }
+
+  int has_out_userdata = FALSE;
+  struct argument *arg = source_method->arguments;
+  while (arg != NULL) {
+    has_out_userdata |= is_out_userdata(&arg->type);
+    arg = arg->next;
+  }
+  if (!has_out_userdata) {
+    error(ERROR_USERDATA, "Method %s of %s has no userdata out arguments for %s", source_method->name, node->name, into_name);
+  }
+
+  trace(TRACE_USERDATA, "Adding into method %s", into_name);
+  method = allocate(sizeof(struct method));
+  memcpy(method, source_method, sizeof(struct method));
+  method->next = node->methods;
+  node->methods = method;
+  string_copy(&(method->name), into_name);
+  sanitize_name(&(method->sanitized_name), into_name);
+  string_copy(&(method->cpp_name), source_method->cpp_name ? source_method->cpp_name : source_method->name);
+  method->rename = NULL;
+  method->into = TRUE;
+  method->line = state.line_num;
+}
+
 void handle_method(struct userdata *node) {
   trace(TRACE_USERDATA, "Adding a method");
   char * parent_name = node->name;
@@ -825,6 +866,14 @@ void handle_method(struct userdata *node) {
       node->method_aliases = alias;
       return;
 
+    } else if (strcmp(token, keyword_into) == 0) {
+      char *into_name = next_token();
+      if (into_name == NULL) {
+        error(ERROR_USERDATA, "Missing into method name for %s %s", parent_name, name);
+      }
+      handle_into_method(node, method, into_name);
+      return;
+
     } else if (strcmp(token, keyword_deprecate) == 0) {
       char *deprecate = strtok(NULL, "");
       if (deprecate == NULL) {
@@ -1349,7 +1398,7 @@ void emit_userdata_allocators(void) {
     // convince compiler to remove null check on the new, lua_newuserdata can't return null
     fprintf(source, "    if (!ud) { __builtin_unreachable(); } // elide constructor null check\n");
     fprintf(source, "    new (ud) %s();\n", node->name);
-    fprintf(source, "    set_userdata_metatable(L, \"%s\");\n", node->rename ? node->rename :  node->name);
+    fprintf(source, "    set_userdata_metatable(L, USERDATA_INDEX_%s);\n", node->sanitized_name);
     fprintf(source, "    return (%s *)ud;\n", node->name);
     fprintf(source, "}\n");
 
@@ -1393,7 +1442,7 @@ void emit_userdata_checkers(void) {
   while (node) {
     start_dependency(source, node->dependency);
     fprintf(source, "%s * check_%s(lua_State *L, int arg) {\n", node->name, node->sanitized_name);
-    fprintf(source, "    return (%s *)luaL_checkudata(L, arg, \"%s\");\n", node->name, node->rename ? node->rename :  node->name);
+    fprintf(source, "    return (%s *)check_userdata(L, arg, USERDATA_INDEX_%s);\n", node->name, node->sanitized_name);
     fprintf(source, "}\n");
     end_dependency(source, node->dependency);
     fprintf(source, "\n");
@@ -1434,6 +1483,20 @@ void emit_singleton_checkers(void) {
   }
 }
 
+// the index of each userdata must match its entry in userdata_fun
+void emit_userdata_index(void) {
+  struct userdata * node = parsed_userdata;
+  fprintf(header, "enum userdata_index : uint8_t {\n");
+  while (node) {
+    start_dependency(header, node->dependency);
+    fprintf(header, "    USERDATA_INDEX_%s,\n", node->sanitized_name);
+    end_dependency(header, node->dependency);
+    node = node->next;
+  }
+  fprintf(header, "    USERDATA_INDEX_COUNT\n");
+  fprintf(header, "};\n\n");
+}
+
 void emit_userdata_declarations(void) {
   struct userdata * node = parsed_userdata;
   while (node) {
@@ -1919,8 +1982,10 @@ void emit_ap_object_fields() {
 }
 
 // emit references functions for a call, return the number of arguments added
-int emit_references(const struct argument *arg, const char * tab) {
+// for into methods userdata are returned by pushing the caller's object back
+int emit_references(const struct argument *arg, int into, const char * tab) {
   int arg_index = NULLABLE_ARG_COUNT_BASE + 2;
+  int stack_index = 2;
   int return_count = 0;
   // count arguments to return so we know if we need to check the stack
   const struct argument *count_arg = arg;
@@ -1958,7 +2023,11 @@ int emit_references(const struct argument *arg, const char * tab) {
           fprintf(source, "%slua_pushstring(L, data_%d);\n", tab, arg_index);
           break;
         case TYPE_USERDATA:
-          fprintf(source, "%s*new_%s(L) = data_%d;\n", tab, arg->type.data.ud.sanitized_name, arg_index);
+          if (into) {
+            fprintf(source, "%slua_pushvalue(L, %d);\n", tab, stack_index);
+          } else {
+            fprintf(source, "%s*new_%s(L) = data_%d;\n", tab, arg->type.data.ud.sanitized_name, arg_index);
+          }
           break;
         case TYPE_NONE:
           error(ERROR_INTERNAL, "Attempted to emit a nullable or reference argument of type none");
@@ -1971,6 +2040,10 @@ int emit_references(const struct argument *arg, const char * tab) {
           break;
       }
     }
+    if ((arg->type.type != TYPE_LITERAL) &&
+        (!(arg->type.flags & (TYPE_FLAGS_NULLABLE | TYPE_FLAGS_REFERENCE)) || (into && is_out_userdata(&arg->type)))) {
+      stack_index++;
+    }
     arg_index++;
     arg = arg->next;
   }
@@ -2001,7 +2074,8 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
   // sanity check number of args called with
   arg_count = 1;
   while (arg != NULL) {
-    if (!(arg->type.flags & (TYPE_FLAGS_NULLABLE | TYPE_FLAGS_REFERENCE)) && !(arg->type.type == TYPE_LITERAL)) {
+    if ((!(arg->type.flags & (TYPE_FLAGS_NULLABLE | TYPE_FLAGS_REFERENCE)) && !(arg->type.type == TYPE_LITERAL)) ||
+        (method->into && is_out_userdata(&arg->type))) {
       arg_count++;
     }
     arg = arg->next;
@@ -2032,6 +2106,13 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
   arg_count = 2;
   int skipped = 0;
   while (arg != NULL) {
+    if (method->into && is_out_userdata(&arg->type)) {
+      // write straight into the object the caller passed in
+      fprintf(source, "    %s &data_%d = *check_%s(L, %d);\n", arg->type.data.ud.name, arg_count + NULLABLE_ARG_COUNT_BASE, arg->type.data.ud.sanitized_name, arg_count - skipped);
+      arg_count++;
+      arg = arg->next;
+      continue;
+    }
     if (arg->type.type != TYPE_LITERAL) {
       // emit_checker will emit a nullable argument for us
       emit_checker(arg->type, arg_count, skipped, "    ");
@@ -2044,6 +2125,7 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
     arg = arg->next;
   }
 
+  const char *cpp_name = method->cpp_name ? method->cpp_name : method->name;
   const char *ud_name = (data->flags & UD_FLAG_LITERAL)?data->name:"ud";
   const char *ud_access = (data->flags & UD_FLAG_REFERENCE)?".":"->";
 
@@ -2061,28 +2143,28 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
 
   switch (method->return_type.type) {
     case TYPE_STRING:
-      fprintf(source, "    const char * data = %s%s%s(", ud_name, ud_access, method->name);
+      fprintf(source, "    const char * data = %s%s%s(", ud_name, ud_access, cpp_name);
       static_cast = FALSE;
       break;
     case TYPE_ENUM:
-      fprintf(source, "    const %s &data = %s%s%s(", method->return_type.data.enum_name, ud_name, ud_access, method->name);
+      fprintf(source, "    const %s &data = %s%s%s(", method->return_type.data.enum_name, ud_name, ud_access, cpp_name);
       static_cast = FALSE;
       break;
     case TYPE_USERDATA:
-      if (strcmp(method->name, "copy") == 0) {
+      if (strcmp(cpp_name, "copy") == 0) {
           // special case for copy method
           fprintf(source, "    const %s data = (*%s", method->return_type.data.ud.name, ud_name);
       } else {
-          fprintf(source, "    const %s &data = %s%s%s(", method->return_type.data.ud.name, ud_name, ud_access, method->name);
+          fprintf(source, "    const %s &data = %s%s%s(", method->return_type.data.ud.name, ud_name, ud_access, cpp_name);
       }
       static_cast = FALSE;
       break;
     case TYPE_AP_OBJECT:
-      fprintf(source, "    %s *data = %s%s%s(", method->return_type.data.ud.name, ud_name, ud_access, method->name);
+      fprintf(source, "    %s *data = %s%s%s(", method->return_type.data.ud.name, ud_name, ud_access, cpp_name);
       static_cast = FALSE;
       break;
     case TYPE_NONE:
-      fprintf(source, "    %s%s%s(", ud_name, ud_access, method->name);
+      fprintf(source, "    %s%s%s(", ud_name, ud_access, cpp_name);
       static_cast = FALSE;
       break;
     case TYPE_LITERAL:
@@ -2135,7 +2217,7 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
         error(ERROR_USERDATA, "Unexpected type");
         break;
     }
-    fprintf(source, "    const %s data = static_cast<%s>(%s%s%s(", var_type_name, var_type_name, ud_name, ud_access, method->name);
+    fprintf(source, "    const %s data = static_cast<%s>(%s%s%s(", var_type_name, var_type_name, ud_name, ud_access, cpp_name);
   }
 
   if (arg_count != 2) {
@@ -2196,7 +2278,7 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
   if (method->flags & TYPE_FLAGS_REFERENCE) {
     arg = method->arguments;
     // number of arguments to return
-    return_count += emit_references(arg,"    ");
+    return_count += emit_references(arg, method->into, "    ");
   }
 
   switch (method->return_type.type) {
@@ -2205,7 +2287,7 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
         fprintf(source, "    if (data) {\n");
         // we need to emit out nullable arguments, iterate the args again, creating and copying objects, while keeping a new count
         arg = method->arguments;
-        return_count = emit_references(arg,"        ");
+        return_count = emit_references(arg, method->into, "        ");
         fprintf(source, "        return %d;\n", return_count);
         fprintf(source, "    }\n");
         fprintf(source, "    return 0;\n");
@@ -2686,7 +2768,8 @@ void emit_docs_method(const char *name, const char *method_name, struct method *
   int count = 1;
   // input arguments
   while (arg != NULL) {
-    if ((arg->type.type != TYPE_LITERAL) && (arg->type.flags & (TYPE_FLAGS_NULLABLE | TYPE_FLAGS_REFERENCE)) == 0) {
+    if (((arg->type.type != TYPE_LITERAL) && (arg->type.flags & (TYPE_FLAGS_NULLABLE | TYPE_FLAGS_REFERENCE)) == 0) ||
+        (method->into && is_out_userdata(&arg->type))) {
       char *param_name = (char *)allocate(20);
       sprintf(param_name, "---@param param%i", count);
       emit_docs_param_type(arg->type, param_name, "\n");
@@ -3025,6 +3108,7 @@ int main(int argc, char **argv) {
   fprintf(header, "#include <AP_Scripting/generator/gen/generated_h_deps.h>\n");
   fprintf(header, "#include <new>\n\n");
 
+  emit_userdata_index();
   emit_userdata_declarations();
   emit_ap_object_declarations();
 
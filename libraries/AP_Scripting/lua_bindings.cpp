@@ -8,6 +8,7 @@
 #if AP_NETWORKING_ENABLED
 #include <AP_HAL/utility/Socket.h>
 #endif
+#include <AP_HAL/utility/sparse-endian.h>
 #include <AP_Logger/AP_Logger.h>
 #include <AP_Filesystem/AP_Filesystem.h>
 #include <AP_GPS/AP_GPS.h>
@@ -15,6 +16,7 @@
 #include "lua_bindings.h"
 
 #include "lua_boxed_numerics.h"
+#include "lua_scripts.h"
 #include <AP_Scripting/lua_generated_bindings.h>
 
 #include <AP_Scheduler/AP_Scheduler.h>
@@ -106,13 +108,21 @@ int lua_mavlink_receive_chan(lua_State *L) {
     binding_argcheck(L, 1);
 
     struct AP_Scripting::mavlink_msg msg;
-    ObjectBuffer<struct AP_Scripting::mavlink_msg> *rx_buffer = AP::scripting()->mavlink_data.rx_buffer;
+    struct AP_Scripting::mavlink &data = AP::scripting()->mavlink_data;
+    ObjectBuffer<struct AP_Scripting::mavlink_msg> *rx_buffer = data.rx_buffer;
 
     if (rx_buffer == nullptr) {
         return luaL_error(L, "RX not initialized");
     }
 
-    if (rx_buffer->pop(msg)) {
+    // scripts in isolated threads share the buffer, so only one may pop at a time
+    bool have_msg;
+    {
+        WITH_SEMAPHORE(data.sem);
+        have_msg = rx_buffer->pop(msg);
+    }
+
+    if (have_msg) {
         lua_pushlstring(L, (char *)&msg.msg, sizeof(msg.msg));
         lua_pushinteger(L, msg.chan);
         *new_uint32_t(L) = msg.timestamp_ms;
@@ -132,28 +142,37 @@ int lua_mavlink_register_rx_msgid(lua_State *L) {
 
     struct AP_Scripting::mavlink &data = AP::scripting()->mavlink_data;
 
-    // check that we aren't currently watching this ID
-    for (uint8_t i = 0; i < data.accept_msg_ids_size; i++) {
-        if (data.accept_msg_ids[i] == msgid) {
-            lua_pushboolean(L, false);
-            return 1;
+    // the check and the add must not be split, scripts in isolated threads
+    // may register at the same time
+    bool already_registered = false;
+    bool added = false;
+    {
+        WITH_SEMAPHORE(data.sem);
+
+        // check that we aren't currently watching this ID
+        for (uint8_t i = 0; i < data.accept_msg_ids_size; i++) {
+            if (data.accept_msg_ids[i] == msgid) {
+                already_registered = true;
+                break;
+            }
         }
-    }
 
-    int i = 0;
-    for (i = 0; i < data.accept_msg_ids_size; i++) {
-        if (data.accept_msg_ids[i] == UINT32_MAX) {
-            break;
+        for (uint8_t i = 0; !already_registered && (i < data.accept_msg_ids_size); i++) {
+            if (data.accept_msg_ids[i] == UINT32_MAX) {
+                data.accept_msg_ids[i] = msgid;
+                added = true;
+                break;
+            }
         }
-    }
+    } // release semaphore here as luaL_error will NOT do that!
 
-    if (i >= data.accept_msg_ids_size) {
-        return luaL_error(L, "no registrations free");
+    if (already_registered) {
+        lua_pushboolean(L, false);
+        return 1;
     }
 
-    {
-        WITH_SEMAPHORE(data.sem);
-        data.accept_msg_ids[i] = msgid;
+    if (!added) {
+        return luaL_error(L, "no registrations free");
     }
 
     lua_pushboolean(L, true);
@@ -233,6 +252,16 @@ int lua_mavlink_block_command(lua_State *L) {
     lua_pushboolean(L, true);
     return 1;
 }
+
+int lua_mavlink_wake_on_receive(lua_State *L) {
+    fix_dot_access_never_add_another_call(L, "mavlink");
+
+    binding_argcheck(L, 1);
+
+    lua_scripts::wake_on(L, AP_Scripting::WakeEvent::MAVLINK_RX);
+
+    return 0;
+}
 #endif // HAL_GCS_ENABLED
 
 #if AP_MISSION_ENABLED
@@ -248,7 +277,14 @@ int lua_mission_receive(lua_State *L) {
 
     struct AP_Scripting::scripting_mission_cmd cmd;
 
-    if (!input->pop(cmd)) {
+    // scripts in isolated threads share the buffer, so only one may pop at a time
+    bool have_cmd;
+    {
+        WITH_SEMAPHORE(AP::scripting()->mission_data_sem);
+        have_cmd = input->pop(cmd);
+    }
+
+    if (!have_cmd) {
         // no new item
         return 0;
     }
@@ -519,19 +555,27 @@ int lua_get_i2c_device(lua_State *L) {
     auto *scripting = AP::scripting();
 
     static_assert(SCRIPTING_MAX_NUM_I2C_DEVICE >= 0, "There cannot be a negative number of I2C devices");
-    if (scripting->num_i2c_devices >= SCRIPTING_MAX_NUM_I2C_DEVICE) {
-        return luaL_argerror(L, 1, "no i2c devices available");
+    AP_HAL::I2CDevice *dev = nullptr;
+    const char *error = nullptr;
+    {
+        // lua errors must not be raised while holding the semaphore
+        WITH_SEMAPHORE(scripting->resource_sem);
+        if (scripting->num_i2c_devices >= SCRIPTING_MAX_NUM_I2C_DEVICE) {
+            error = "no i2c devices available";
+        } else {
+            dev = hal.i2c_mgr->get_device_ptr(bus, address, bus_clock, use_smbus);
+            if (dev == nullptr) {
+                error = "i2c device nullptr";
+            } else {
+                scripting->_i2c_dev[scripting->num_i2c_devices++] = dev;
+            }
+        }
     }
-
-    scripting->_i2c_dev[scripting->num_i2c_devices] = hal.i2c_mgr->get_device_ptr(bus, address, bus_clock, use_smbus);
-
-    if (scripting->_i2c_dev[scripting->num_i2c_devices] == nullptr) {
-        return luaL_argerror(L, 1, "i2c device nullptr");
+    if (error != nullptr) {
+        return luaL_argerror(L, 1, error);
     }
 
-    *new_AP_HAL__I2CDevice(L) = scripting->_i2c_dev[scripting->num_i2c_devices];
-
-    scripting->num_i2c_devices++;
+    *new_AP_HAL__I2CDevice(L) = dev;
 
     return 1;
 }
@@ -616,12 +660,15 @@ int lua_get_CAN_device(lua_State *L) {
 
     auto *scripting = AP::scripting();
 
-    if (scripting->_CAN_dev == nullptr) {
-        scripting->_CAN_dev = NEW_NOTHROW ScriptingCANSensor(AP_CAN::Protocol::Scripting);
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
         if (scripting->_CAN_dev == nullptr) {
-            return luaL_argerror(L, 1, "CAN device nullptr");
+            scripting->_CAN_dev = NEW_NOTHROW ScriptingCANSensor(AP_CAN::Protocol::Scripting);
         }
     }
+    if (scripting->_CAN_dev == nullptr) {
+        return luaL_argerror(L, 1, "CAN device nullptr");
+    }
 
     if (!scripting->_CAN_dev->initialized()) {
         // Driver not initialized, probably because there is no can driver set to scripting
@@ -644,12 +691,15 @@ int lua_get_CAN_device2(lua_State *L) {
 
     auto *scripting = AP::scripting();
 
-    if (scripting->_CAN_dev2 == nullptr) {
-        scripting->_CAN_dev2 = NEW_NOTHROW ScriptingCANSensor(AP_CAN::Protocol::Scripting2);
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
         if (scripting->_CAN_dev2 == nullptr) {
-            return luaL_argerror(L, 1, "CAN device nullptr");
+            scripting->_CAN_dev2 = NEW_NOTHROW ScriptingCANSensor(AP_CAN::Protocol::Scripting2);
         }
     }
+    if (scripting->_CAN_dev2 == nullptr) {
+        return luaL_argerror(L, 1, "CAN device nullptr");
+    }
 
     if (!scripting->_CAN_dev2->initialized()) {
         // Driver not initialized, probably because there is no can driver set to scripting 2
@@ -661,6 +711,46 @@ int lua_get_CAN_device2(lua_State *L) {
 
     return 1;
 }
+
+#if AP_SCRIPTING_BYTEBUFFER_ENABLED
+/*
+  read frames into the end of a ByteBuffer while they fit, returns the
+  number of frames read. Each frame is 13 bytes, a little endian
+  uint32 id including the flag bits, uint8 dlc and the first 8 data
+  bytes, so unpacks with "<I4BBBBBBBBB"
+ */
+int lua_CAN_read_frames_into(lua_State *L) {
+    binding_argcheck(L, 2);
+
+    ScriptingCANBuffer * can_buf = *check_ScriptingCANBuffer(L, 1);
+    AP_Scripting_ByteBuffer * buf = check_AP_Scripting_ByteBuffer(L, 2);
+
+    const uint8_t frame_len = sizeof(uint32_t) + 1 + 8;
+    uint32_t frames = 0;
+    AP_HAL::CANFrame frame;
+    while (buf->space() >= frame_len && can_buf->read_frame(frame)) {
+        uint8_t *p = buf->tail();
+        put_le32_ptr(p, frame.id);
+        p[4] = frame.dlc;
+        memcpy(&p[5], frame.data, 8);
+        buf->advance(frame_len);
+        frames++;
+    }
+
+    lua_pushinteger(L, frames);
+    return 1;
+}
+#endif // AP_SCRIPTING_BYTEBUFFER_ENABLED
+
+int lua_CAN_wake_on_receive(lua_State *L) {
+    fix_dot_access_never_add_another_call(L, "CAN");
+
+    binding_argcheck(L, 1);
+
+    lua_scripts::wake_on(L, AP_Scripting::WakeEvent::CAN_RX);
+
+    return 0;
+}
 #endif // AP_SCRIPTING_CAN_SENSOR_ENABLED
 
 #if AP_SERIALMANAGER_ENABLED
@@ -721,6 +811,16 @@ int lua_serial_find_simulated_device(lua_State *L) {
 
     return 1;
 }
+
+int lua_serial_wake_on_receive(lua_State *L) {
+    fix_dot_access_never_add_another_call(L, "serial");
+
+    binding_argcheck(L, 1);
+
+    lua_scripts::wake_on(L, AP_Scripting::WakeEvent::SERIALDEVICE_RX);
+
+    return 0;
+}
 #endif // AP_SCRIPTING_SERIALDEVICE_ENABLED
 
 int lua_serial_writestring(lua_State *L)
@@ -764,6 +864,44 @@ int lua_serial_readstring(lua_State *L) {
     return 1;
 }
 
+#if AP_SCRIPTING_BYTEBUFFER_ENABLED
+// read as many bytes as are available and fit into the end of a ByteBuffer, returns the number read
+int lua_serial_readinto(lua_State *L) {
+    binding_argcheck(L, 2);
+
+    AP_Scripting_SerialAccess * port = check_AP_Scripting_SerialAccess(L, 1);
+    AP_Scripting_ByteBuffer * buf = check_AP_Scripting_ByteBuffer(L, 2);
+
+    const uint32_t count = MIN(port->available(), buf->space());
+    if (count == 0) {
+        lua_pushinteger(L, 0);
+        return 1;
+    }
+
+    const ssize_t read_bytes = port->read(buf->tail(), count);
+    if (read_bytes < 0) {
+        return 0; // error, return nil
+    }
+    buf->advance(read_bytes);
+
+    lua_pushinteger(L, read_bytes);
+    return 1;
+}
+
+// write the contents of a ByteBuffer, returns the number of bytes written
+int lua_serial_write_from(lua_State *L) {
+    binding_argcheck(L, 2);
+
+    AP_Scripting_SerialAccess * port = check_AP_Scripting_SerialAccess(L, 1);
+    AP_Scripting_ByteBuffer * buf = check_AP_Scripting_ByteBuffer(L, 2);
+
+    const size_t written = port->write(buf->data(), buf->len());
+
+    lua_pushinteger(L, written);
+    return 1;
+}
+#endif // AP_SCRIPTING_BYTEBUFFER_ENABLED
+
 int lua_serial_begin(lua_State *L) {
     const int args = lua_gettop(L);
     if (args > 2) {
@@ -837,18 +975,27 @@ int lua_get_PWMSource(lua_State *L) {
     auto *scripting = AP::scripting();
 
     static_assert(SCRIPTING_MAX_NUM_PWM_SOURCE >= 0, "There cannot be a negative number of PWMSources");
-    if (scripting->num_pwm_source >= SCRIPTING_MAX_NUM_PWM_SOURCE) {
-        return luaL_argerror(L, 1, "no PWMSources available");
+    AP_HAL::PWMSource *source = nullptr;
+    const char *error = nullptr;
+    {
+        // lua errors must not be raised while holding the semaphore
+        WITH_SEMAPHORE(scripting->resource_sem);
+        if (scripting->num_pwm_source >= SCRIPTING_MAX_NUM_PWM_SOURCE) {
+            error = "no PWMSources available";
+        } else {
+            source = NEW_NOTHROW AP_HAL::PWMSource;
+            if (source == nullptr) {
+                error = "PWMSources device nullptr";
+            } else {
+                scripting->_pwm_source[scripting->num_pwm_source++] = source;
+            }
+        }
     }
-
-    scripting->_pwm_source[scripting->num_pwm_source] = NEW_NOTHROW AP_HAL::PWMSource;
-    if (scripting->_pwm_source[scripting->num_pwm_source] == nullptr) {
-        return luaL_argerror(L, 1, "PWMSources device nullptr");
+    if (error != nullptr) {
+        return luaL_argerror(L, 1, error);
     }
 
-    *new_AP_HAL__PWMSource(L) = scripting->_pwm_source[scripting->num_pwm_source];
-
-    scripting->num_pwm_source++;
+    *new_AP_HAL__PWMSource(L) = source;
 
     return 1;
 }
@@ -866,14 +1013,23 @@ int lua_get_SocketAPM(lua_State *L) {
     if (sock == nullptr) {
         return luaL_argerror(L, 1, "SocketAPM device nullptr");
     }
-    for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
-        if (scripting->_net_sockets[i] == nullptr) {
-            scripting->_net_sockets[i] = sock;
-            *new_SocketAPM(L) = scripting->_net_sockets[i];
-            return 1;
+    bool stored = false;
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
+        for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
+            if (scripting->_net_sockets[i] == nullptr) {
+                scripting->_net_sockets[i] = sock;
+                stored = true;
+                break;
+            }
         }
     }
+    if (stored) {
+        *new_SocketAPM(L) = sock;
+        return 1;
+    }
 
+    delete sock;
     return luaL_argerror(L, 1, "no sockets available");
 }
 
@@ -888,15 +1044,22 @@ int SocketAPM_close(lua_State *L) {
     auto *scripting = AP::scripting();
 
     // clear allocated socket
-    for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
-        if (scripting->_net_sockets[i] == ud) {
-            ud->close();
-            delete ud;
-            scripting->_net_sockets[i] = nullptr;
-            *check_SocketAPM(L, 1) = nullptr;
-            break;
+    bool found = false;
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
+        for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
+            if (scripting->_net_sockets[i] == ud) {
+                scripting->_net_sockets[i] = nullptr;
+                found = true;
+                break;
+            }
         }
     }
+    if (found) {
+        ud->close();
+        delete ud;
+        *check_SocketAPM(L, 1) = nullptr;
+    }
 
     return 0;
 }
@@ -974,19 +1137,23 @@ int SocketAPM_accept(lua_State *L) {
     auto *scripting = AP::scripting();
 
     // find an empty slot
-    for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
-        if (scripting->_net_sockets[i] == nullptr) {
-            scripting->_net_sockets[i] = ud->accept(0);
+    SocketAPM *sock = nullptr;
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
+        for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
             if (scripting->_net_sockets[i] == nullptr) {
-                return 0;
+                sock = ud->accept(0);
+                scripting->_net_sockets[i] = sock;
+                break;
             }
-            *new_SocketAPM(L) = scripting->_net_sockets[i];
-            return 1;
         }
     }
-
-    // out of socket slots, return nil, caller can retry
-    return 0;
+    if (sock == nullptr) {
+        // out of socket slots or nothing to accept, return nil, caller can retry
+        return 0;
+    }
+    *new_SocketAPM(L) = sock;
+    return 1;
 }
 
 /*
@@ -1017,10 +1184,9 @@ int SocketAPM_string_to_ipv4_addr(lua_State *L) {
 #endif // AP_NETWORKING_ENABLED
 
 
-int lua_get_current_env_ref()
+int lua_get_current_env_ref(lua_State *L)
 {
-    auto *scripting = AP::scripting();
-    return scripting->get_current_env_ref();
+    return lua_scripts::get_current_env_ref(L);
 }
 
 // This is used when loading modules with require, lua must only look in enabled directory's
@@ -1050,6 +1216,61 @@ const char* lua_get_modules_path()
     return "";
 }
 
+// get a parameter value by name, nil if not found
+int lua_param_get(lua_State *L) {
+    fix_dot_access_never_add_another_call(L, "param");
+
+    binding_argcheck(L, 2);
+
+    const char *name = luaL_checkstring(L, 2);
+
+    Parameter p;
+    float value;
+    if (!lua_scripts::find_param(L, name, p) || !p.get(value)) {
+        return 0;
+    }
+
+    lua_pushnumber(L, value);
+    return 1;
+}
+
+// common part of setting a parameter by name
+static int param_set_common(lua_State *L, bool (Parameter::*set_fn)(float)) {
+    fix_dot_access_never_add_another_call(L, "param");
+
+    binding_argcheck(L, 3);
+
+    const char *name = luaL_checkstring(L, 2);
+    const float value = luaL_checknumber(L, 3);
+
+    Parameter p;
+    lua_pushboolean(L, lua_scripts::find_param(L, name, p) && (p.*set_fn)(value));
+    return 1;
+}
+
+int lua_param_set(lua_State *L) {
+    return param_set_common(L, &Parameter::set);
+}
+
+int lua_param_set_and_save(lua_State *L) {
+    return param_set_common(L, &Parameter::set_and_save);
+}
+
+int lua_param_set_default(lua_State *L) {
+    return param_set_common(L, &Parameter::set_default);
+}
+
+// run the calling script when a parameter is set from the GCS
+int lua_param_wake_on_change(lua_State *L) {
+    fix_dot_access_never_add_another_call(L, "param");
+
+    binding_argcheck(L, 1);
+
+    lua_scripts::wake_on(L, AP_Scripting::WakeEvent::PARAM_SET);
+
+    return 0;
+}
+
 // Simple print to GCS or over CAN
 int lua_print(lua_State *L) {
     // Only support a single argument
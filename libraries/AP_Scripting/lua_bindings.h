@@ -11,10 +11,15 @@ int AP_HAL__I2CDevice_read_registers(lua_State *L);
 int AP_HAL__I2CDevice_transfer(lua_State *L);
 int lua_get_CAN_device(lua_State *L);
 int lua_get_CAN_device2(lua_State *L);
+int lua_CAN_wake_on_receive(lua_State *L);
+int lua_CAN_read_frames_into(lua_State *L);
 int lua_serial_find_serial(lua_State *L);
 int lua_serial_find_simulated_device(lua_State *L);
+int lua_serial_wake_on_receive(lua_State *L);
 int lua_serial_writestring(lua_State *L);
 int lua_serial_readstring(lua_State *L);
+int lua_serial_readinto(lua_State *L);
+int lua_serial_write_from(lua_State *L);
 int lua_serial_begin(lua_State *L);
 int lua_dirlist(lua_State *L);
 int lua_removefile(lua_State *L);
@@ -32,6 +37,12 @@ int lua_mavlink_receive_chan(lua_State *L);
 int lua_mavlink_register_rx_msgid(lua_State *L);
 int lua_mavlink_send_chan(lua_State *L);
 int lua_mavlink_block_command(lua_State *L);
+int lua_mavlink_wake_on_receive(lua_State *L);
+int lua_param_wake_on_change(lua_State *L);
+int lua_param_get(lua_State *L);
+int lua_param_set(lua_State *L);
+int lua_param_set_and_save(lua_State *L);
+int lua_param_set_default(lua_State *L);
 int lua_print(lua_State *L);
 int lua_range_finder_handle_script_msg(lua_State *L);
 int lua_GCS_command_int(lua_State *L);
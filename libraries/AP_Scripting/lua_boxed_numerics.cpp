@@ -11,7 +11,7 @@ extern const AP_HAL::HAL& hal;
 
 uint32_t coerce_to_uint32_t(lua_State *L, int arg) {
     { // userdata
-        const uint32_t * ud = static_cast<uint32_t *>(luaL_testudata(L, arg, "uint32_t"));
+        const uint32_t * ud = static_cast<uint32_t *>(test_userdata(L, arg, USERDATA_INDEX_uint32_t));
         if (ud != nullptr) {
             return *ud;
         }
@@ -41,7 +41,7 @@ uint32_t coerce_to_uint32_t(lua_State *L, int arg) {
 
 uint64_t coerce_to_uint64_t(lua_State *L, int arg) {
     { // uint64_t userdata
-        const uint64_t * ud = static_cast<uint64_t *>(luaL_testudata(L, arg, "uint64_t"));
+        const uint64_t * ud = static_cast<uint64_t *>(test_userdata(L, arg, USERDATA_INDEX_uint64_t));
         if (ud != nullptr) {
             return *ud;
         }
@@ -56,7 +56,7 @@ uint64_t coerce_to_uint64_t(lua_State *L, int arg) {
         }
     }
     { // uint32_t userdata
-        const uint32_t * ud = static_cast<uint32_t *>(luaL_testudata(L, arg, "uint32_t"));
+        const uint32_t * ud = static_cast<uint32_t *>(test_userdata(L, arg, USERDATA_INDEX_uint32_t));
         if (ud != nullptr) {
             return static_cast<uint64_t>(*ud);
         }
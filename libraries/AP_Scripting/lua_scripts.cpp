@@ -21,17 +21,79 @@
 #include <AP_HAL/AP_HAL.h>
 #include "AP_Scripting.h"
 #include <AP_Logger/AP_Logger.h>
+#include <AP_Filesystem/AP_Filesystem.h>
+#include <AP_Common/ExpandingString.h>
+#if AP_SCRIPTING_CRYPTO_ENABLED
+#include <AP_Crypto/AP_Crypto.h>
+#include <AP_Crypto/AP_Crypto_Params.h>
+#endif
 
 #include <AP_Scripting/lua_generated_bindings.h>
+#include "lua/src/lstate.h"
 
 #define DISABLE_INTERRUPTS_FOR_SCRIPT_RUN 0
 
+// garbage collection is run in steps in the gaps between scripts. The pause is
+// reduced from Lua's default of 200% so that the heap does not grow to twice the
+// size of the live data before a new collection cycle starts
+#ifndef SCRIPTING_GC_PAUSE
+#define SCRIPTING_GC_PAUSE 110
+#endif
+#ifndef SCRIPTING_GC_BUDGET_US
+#define SCRIPTING_GC_BUDGET_US 1000
+#endif
+
+// percentage of the heap reserved for small allocation slabs
+#ifndef SCRIPTING_SLAB_PERCENT
+#define SCRIPTING_SLAB_PERCENT 25
+#endif
+
+#if AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+#ifndef SCRIPTING_CACHE_DIRECTORY
+#define SCRIPTING_CACHE_DIRECTORY SCRIPTING_DIRECTORY "/.cache"
+#endif
+#define SCRIPTING_CACHE_MAGIC 0x3243554CU // "LUC2", the first version was stripped of debug information
+#endif
+
+#if AP_SCRIPTING_RUN_STATS_ENABLED
+// number of scripts that run stats are kept for
+#ifndef SCRIPTING_RUN_STATS_ENTRIES
+#define SCRIPTING_RUN_STATS_ENTRIES 32
+#endif
+// run time histogram buckets, bucket n counts runs shorter than 16us << n, the last is unbounded
+#define SCRIPTING_RUN_STATS_BUCKETS 16
+#endif
+
+// number of entries in the parameter name cache of each state, must be a power of 2
+#ifndef SCRIPTING_PARAM_CACHE_SIZE
+#define SCRIPTING_PARAM_CACHE_SIZE 32
+#endif
+static_assert((SCRIPTING_PARAM_CACHE_SIZE & (SCRIPTING_PARAM_CACHE_SIZE - 1)) == 0, "SCRIPTING_PARAM_CACHE_SIZE must be a power of 2");
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+// number of VM instructions between samples of the call stack
+#ifndef SCRIPTING_PROFILE_INTERVAL
+#define SCRIPTING_PROFILE_INTERVAL 1000
+#endif
+// number of distinct call stacks recorded
+#ifndef SCRIPTING_PROFILE_ENTRIES
+#define SCRIPTING_PROFILE_ENTRIES 64
+#endif
+#define SCRIPTING_PROFILE_MAX_DEPTH 16
+#define SCRIPTING_PROFILE_STACK_LEN 128
+#endif
+
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+#ifndef SCRIPTING_ISOLATED_DIRECTORY
+#define SCRIPTING_ISOLATED_DIRECTORY SCRIPTING_DIRECTORY "/isolated"
+#endif
+#endif
+
 extern const AP_HAL::HAL& hal;
 #define ENABLE_DEBUG_MODULE 0
 
-bool lua_scripts::overtime;
-ap_jmp_buf lua_scripts::panic_jmp;
 char *lua_scripts::error_msg_buf;
+size_t lua_scripts::error_msg_buf_len;
 HAL_Semaphore lua_scripts::error_msg_buf_sem;
 uint8_t lua_scripts::print_error_count;
 uint32_t lua_scripts::last_print_ms;
@@ -40,6 +102,34 @@ uint32_t lua_scripts::loaded_checksum;
 uint32_t lua_scripts::running_checksum;
 HAL_Semaphore lua_scripts::crc_sem;
 
+lua_scripts *lua_scripts::wake_list;
+HAL_Semaphore lua_scripts::wake_sem;
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+struct lua_scripts::profile_entry {
+    uint64_t hash;      // hash of the call stack, 0 if the entry is unused
+    uint32_t count;     // number of samples
+    char stack[SCRIPTING_PROFILE_STACK_LEN];
+};
+lua_scripts::profile_entry *lua_scripts::profile_entries;
+uint32_t lua_scripts::profile_dropped;
+HAL_Semaphore lua_scripts::profile_sem;
+#endif
+
+#if AP_SCRIPTING_RUN_STATS_ENABLED
+struct lua_scripts::run_stats_entry {
+    char name[16];          // script file name without the directory, empty if unused
+    uint32_t runs;
+    uint32_t run_time_max;  // us
+    uint32_t steps_max;
+    uint64_t allocs;        // total over all runs
+    uint32_t heap_peak;     // highest heap usage of the state while this script ran
+    uint32_t run_time_hist[SCRIPTING_RUN_STATS_BUCKETS];
+};
+lua_scripts::run_stats_entry *lua_scripts::run_stats;
+HAL_Semaphore lua_scripts::run_stats_sem;
+#endif
+
 // return string error message for error object at top of stack
 static const char *get_error_object_message(lua_State *L) {
     const char *m = lua_tostring(L, -1);
@@ -49,20 +139,71 @@ static const char *get_error_object_message(lua_State *L) {
     return m;
 }
 
-lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, AP_Int8 &debug_options)
+lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, AP_Int8 &debug_options, const char *isolated_script)
     : _vm_steps(vm_steps),
       _debug_options(debug_options)
 {
     const bool allow_heap_expansion = !option_is_set(AP_Scripting::DebugOption::DISABLE_HEAP_EXPANSION);
     _heap.create(heap_size, 10, allow_heap_expansion, 20*1024);
+
+    // most lua allocations are small, serve these from size class slabs
+    _heap.create_slabs(heap_size * SCRIPTING_SLAB_PERCENT / 100);
+
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+    if ((isolated_script != nullptr) && _heap.available()) {
+        // keep a copy in our own heap, the caller's is not safe to use from our thread
+        const size_t len = strlen(isolated_script) + 1;
+        isolated_name = (char *)_heap.allocate(len);
+        if (isolated_name == nullptr) {
+            // treat as if the heap could not be allocated
+            _heap.destroy();
+            return;
+        }
+        memcpy(isolated_name, isolated_script, len);
+    }
+#else
+    (void)isolated_script;
+#endif
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+    if (isolated_script == nullptr) {
+        // the main state is only created when scripting starts or restarts
+        profile_reset();
+    }
+#endif
+
+    WITH_SEMAPHORE(wake_sem);
+    wake_next = wake_list;
+    wake_list = this;
 }
 
 lua_scripts::~lua_scripts() {
+    {
+        WITH_SEMAPHORE(wake_sem);
+        for (lua_scripts **state = &wake_list; *state != nullptr; state = &(*state)->wake_next) {
+            if (*state == this) {
+                *state = wake_next;
+                break;
+            }
+        }
+    }
     _heap.destroy();
 }
 
 void lua_scripts::hook(lua_State *L, lua_Debug *ar) {
-    lua_scripts::overtime = true;
+    lua_scripts *self = get_instance(L);
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+    if (self->profile_steps_remaining > 0) {
+        profile_sample(L, (self->running_script != nullptr) ? self->running_script->name : nullptr);
+        self->profile_steps_remaining -= self->profile_interval;
+        if (self->profile_steps_remaining > 0) {
+            return;
+        }
+    }
+#endif
+
+    self->overtime = true;
 
     // we need to aggressively bail out as we are over time
     // so we will aggressively trap errors until we clear out
@@ -88,7 +229,7 @@ void lua_scripts::set_and_print_new_error_message(MAV_SEVERITY severity, const c
     // reset buffer and print count
     print_error_count = 0;
     if (error_msg_buf) {
-        _heap.deallocate(error_msg_buf);
+        hal.util->free_type(error_msg_buf, error_msg_buf_len, AP_HAL::Util::MEM_FAST);
         error_msg_buf = nullptr;
     }
 
@@ -110,8 +251,10 @@ void lua_scripts::set_and_print_new_error_message(MAV_SEVERITY severity, const c
         return;
     }
 
-    // allocate buffer on scripting heap
-    error_msg_buf = (char *)_heap.allocate(len+1);
+    // allocate buffer outside of the scripting heaps, this may be called from
+    // the thread of any lua state
+    error_msg_buf_len = len+1;
+    error_msg_buf = (char *)hal.util->malloc_type(error_msg_buf_len, AP_HAL::Util::MEM_FAST);
     if (!error_msg_buf) {
         // allocation failed
         va_end(arg_list);
@@ -132,18 +275,31 @@ void lua_scripts::set_and_print_new_error_message(MAV_SEVERITY severity, const c
 
 int lua_scripts::atpanic(lua_State *L) {
     set_and_print_new_error_message(MAV_SEVERITY_CRITICAL, "Panic: %s", get_error_object_message(L));
-    ap_longjmp(panic_jmp, 1);
+    ap_longjmp(get_instance(L)->panic_jmp, 1);
     return 0;
 }
 
 // helper for print and log of runtime stats
-void lua_scripts::update_stats(const char *name, uint32_t run_time, int total_mem, int run_mem)
+// script file name without the directory, truncated to fit the log and stats name fields
+static void short_script_name(const char *name, char *short_name, size_t len)
+{
+    const char *name_short = strrchr(name, '/');
+    if ((strlen(name) > len) && (name_short != nullptr)) {
+        name = name_short + 1;
+    }
+    strncpy_noterm(short_name, name, len);
+}
+
+void lua_scripts::update_stats(const char *name, uint32_t run_time, int total_mem, int run_mem, uint32_t gc_time, int gc_mem, uint32_t wake_time)
 {
     if (option_is_set(AP_Scripting::DebugOption::RUNTIME_MSG)) {
-        GCS_SEND_TEXT(MAV_SEVERITY_DEBUG, "Lua: Time: %u Mem: %d + %d",
+        GCS_SEND_TEXT(MAV_SEVERITY_DEBUG, "Lua: Time: %u Mem: %d + %d GC: %u -%d Wake: %u",
                                             (unsigned int)run_time,
                                             (int)total_mem,
-                                            (int)run_mem);
+                                            (int)run_mem,
+                                            (unsigned int)gc_time,
+                                            (int)gc_mem,
+                                            (unsigned int)wake_time);
     }
 #if HAL_LOGGING_ENABLED
     if (option_is_set(AP_Scripting::DebugOption::LOG_RUNTIME)) {
@@ -153,21 +309,450 @@ void lua_scripts::update_stats(const char *name, uint32_t run_time, int total_me
             name         : {},
             run_time     : run_time,
             total_mem    : total_mem,
-            run_mem      : run_mem
+            run_mem      : run_mem,
+            gc_time      : gc_time,
+            gc_mem       : gc_mem,
+            wake_time    : wake_time
         };
-        const char * name_short = strrchr(name, '/');
-        if ((strlen(name) > sizeof(pkt.name)) && (name_short != nullptr)) {
-            strncpy_noterm(pkt.name, name_short+1, sizeof(pkt.name));
-        } else {
-            strncpy_noterm(pkt.name, name, sizeof(pkt.name));
-        }
+        short_script_name(name, pkt.name, sizeof(pkt.name));
+        AP::logger().WriteBlock(&pkt, sizeof(pkt));
+    }
+#endif // HAL_LOGGING_ENABLED
+}
+
+void lua_scripts::update_run_stats(const char *name, uint32_t steps, uint32_t run_time, uint32_t gc_time, uint32_t allocs, uint32_t heap_peak)
+{
+#if HAL_LOGGING_ENABLED
+    if (option_is_set(AP_Scripting::DebugOption::LOG_RUNTIME)) {
+        struct log_ScriptingRun pkt {
+            LOG_PACKET_HEADER_INIT(LOG_SCRIPTING_RUN_MSG),
+            time_us      : AP_HAL::micros64(),
+            name         : {},
+            vm_steps     : steps,
+            run_time     : run_time,
+            gc_time      : gc_time,
+            allocs       : allocs,
+            heap_peak    : heap_peak
+        };
+        short_script_name(name, pkt.name, sizeof(pkt.name));
         AP::logger().WriteBlock(&pkt, sizeof(pkt));
     }
 #endif // HAL_LOGGING_ENABLED
+
+#if AP_SCRIPTING_RUN_STATS_ENABLED
+    char short_name[sizeof(run_stats_entry::name)];
+    short_script_name(name, short_name, sizeof(short_name));
+
+    WITH_SEMAPHORE(run_stats_sem);
+    if (run_stats == nullptr) {
+        // not from a scripting heap as the table is shared by all states and kept over restarts
+        run_stats = (run_stats_entry *)hal.util->malloc_type(sizeof(run_stats_entry) * SCRIPTING_RUN_STATS_ENTRIES, AP_HAL::Util::MEM_FAST);
+        if (run_stats == nullptr) {
+            return;
+        }
+    }
+    for (uint8_t i=0; i<SCRIPTING_RUN_STATS_ENTRIES; i++) {
+        run_stats_entry &e = run_stats[i];
+        if (e.name[0] == 0) {
+            // entries are never removed, so the first free one ends the search
+            memcpy(e.name, short_name, sizeof(e.name));
+        } else if (strncmp(e.name, short_name, sizeof(e.name)) != 0) {
+            continue;
+        }
+        e.runs++;
+        e.run_time_max = MAX(e.run_time_max, run_time);
+        e.steps_max = MAX(e.steps_max, steps);
+        e.allocs += allocs;
+        e.heap_peak = MAX(e.heap_peak, heap_peak);
+        uint8_t bucket = 0;
+        while ((bucket < SCRIPTING_RUN_STATS_BUCKETS - 1) && (run_time >= (16U << bucket))) {
+            bucket++;
+        }
+        e.run_time_hist[bucket]++;
+        return;
+    }
+#endif // AP_SCRIPTING_RUN_STATS_ENABLED
+}
+
+#if AP_SCRIPTING_RUN_STATS_ENABLED
+void lua_scripts::run_stats_info(ExpandingString &str)
+{
+    WITH_SEMAPHORE(run_stats_sem);
+    if (run_stats == nullptr) {
+        return;
+    }
+    // percentiles are the upper bound of the histogram bucket they fall in, limited to the max
+    str.printf("Name Runs P50us P90us P99us MaxUs MaxSteps AllocsPerRun PeakHeap\n");
+    const uint8_t pct[] { 50, 90, 99 };
+    for (uint8_t i=0; i<SCRIPTING_RUN_STATS_ENTRIES; i++) {
+        const run_stats_entry &e = run_stats[i];
+        if (e.name[0] == 0) {
+            break;
+        }
+        uint32_t pct_us[ARRAY_SIZE(pct)] {};
+        for (uint8_t p=0; p<ARRAY_SIZE(pct); p++) {
+            uint64_t count = 0;
+            uint8_t bucket = 0;
+            for (; bucket < SCRIPTING_RUN_STATS_BUCKETS - 1; bucket++) {
+                count += e.run_time_hist[bucket];
+                if (count * 100U >= uint64_t(e.runs) * pct[p]) {
+                    break;
+                }
+            }
+            pct_us[p] = (bucket < SCRIPTING_RUN_STATS_BUCKETS - 1) ? MIN(16U << bucket, e.run_time_max) : e.run_time_max;
+        }
+        str.printf("%.*s %u %u %u %u %u %u %u %u\n",
+                   int(sizeof(e.name)), e.name,
+                   unsigned(e.runs),
+                   unsigned(pct_us[0]), unsigned(pct_us[1]), unsigned(pct_us[2]),
+                   unsigned(e.run_time_max),
+                   unsigned(e.steps_max),
+                   unsigned(e.allocs / MAX(e.runs, 1U)),
+                   unsigned(e.heap_peak));
+    }
+}
+#endif // AP_SCRIPTING_RUN_STATS_ENABLED
+
+uint32_t lua_scripts::steps_used(lua_State *L) const
+{
+    const int32_t vm_steps = MAX(_vm_steps, 1000);
+    if (overtime) {
+        return vm_steps;
+    }
+    // the hook count is decremented for each instruction from the value set in reset_loop_overtime
+    uint32_t steps = L->basehookcount - L->hookcount;
+#if AP_SCRIPTING_PROFILER_ENABLED
+    if (profile_steps_remaining > 0) {
+        // add the instructions before the most recent sample
+        steps += vm_steps - profile_steps_remaining;
+    }
+#endif
+    return steps;
+}
+
+#if AP_SCRIPTING_CRYPTO_ENABLED
+bool lua_scripts::is_encrypted_file(const char *filename) {
+    const int fd = AP::FS().open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    uint8_t header[4];
+    const bool encrypted = (AP::FS().read(fd, header, sizeof(header)) == sizeof(header)) &&
+                           (memcmp(header, "XOR1", sizeof(header)) == 0);
+    AP::FS().close(fd);
+    return encrypted;
+}
+
+int lua_scripts::load_encrypted_source(lua_State *L, const char *filename) {
+    // chunk name matches the one luaL_loadfile would use, pushed before
+    // decrypting so an allocation failure can't leak the plaintext
+    lua_pushfstring(L, "@%s", filename);
+
+    uint8_t *text;
+    size_t len;
+    if (!AP_Crypto::read_and_decrypt_file(filename, &text, &len)) {
+        lua_pop(L, 1);
+        lua_pushfstring(L, "cannot decrypt %s", filename);
+        return LUA_ERRFILE;
+    }
+
+    const int error = luaL_loadbufferx(L, (const char *)text, len, lua_tostring(L, -1), "t");
+    lua_remove(L, -2); // chunk name
+
+    memset(text, 0, len);
+    hal.util->free_type(text, len, AP_HAL::Util::MEM_DMA_SAFE);
+
+    return error;
+}
+#endif // AP_SCRIPTING_CRYPTO_ENABLED
+
+#if AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+bool lua_scripts::get_cache_filename(const char *filename, char *cache_name, uint8_t len) {
+    const char *base = strrchr(filename, '/');
+    base = (base == nullptr) ? filename : base + 1;
+
+    // scripts from ROMFS may share a name with those on the SD card
+    const char *prefix = (filename[0] == '@') ? "romfs_" : "";
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+    // as may isolated scripts, which are also loaded from another thread
+    if (strncmp(filename, SCRIPTING_ISOLATED_DIRECTORY "/", strlen(SCRIPTING_ISOLATED_DIRECTORY "/")) == 0) {
+        prefix = "isolated_";
+    }
+#endif
+
+    const int n = snprintf(cache_name, len, "%s/%s%sc", SCRIPTING_CACHE_DIRECTORY, prefix, base);
+    return (n > 0) && (n < len);
+}
+
+// reads from the cache file, decrypting if required
+struct cache_reader {
+    int fd;
+#if AP_SCRIPTING_CRYPTO_ENABLED
+    AP_Crypto::StreamingDecrypt ctx;
+    bool encrypted;
+#endif
+    size_t remaining;   // bytecode left to pass to lua
+    uint8_t buf[256];
+
+    // lua_Reader signature for lua_load, returns nullptr at the end of the chunk
+    // or on a read error, which lua reports as a truncated chunk
+    static const char *load(lua_State *L, void *ud, size_t *size) {
+        (void)L;
+        cache_reader *r = (cache_reader *)ud;
+        const size_t n = MIN(r->remaining, sizeof(r->buf));
+        if ((n == 0) || !r->read(r->buf, n)) {
+            r->remaining = 0;
+            *size = 0;
+            return nullptr;
+        }
+        r->remaining -= n;
+        *size = n;
+        return (const char *)r->buf;
+    }
+
+    bool read(void *buf, size_t len) {
+        uint8_t *b = (uint8_t *)buf;
+        while (len > 0) {
+            int32_t n;
+#if AP_SCRIPTING_CRYPTO_ENABLED
+            if (encrypted) {
+                n = AP_Crypto::streaming_decrypt_read_xor(&ctx, fd, b, len);
+            } else
+#endif
+            {
+                n = AP::FS().read(fd, b, len);
+            }
+            if (n <= 0) {
+                return false;
+            }
+            b += n;
+            len -= n;
+        }
+        return true;
+    }
+};
+
+bool lua_scripts::load_from_cache(lua_State *L, const char *cache_name, const char *filename, uint32_t crc) {
+    AP_Filesystem::stat_t st;
+    if (!AP::FS().stat(cache_name, st) || (st.size <= sizeof(bytecode_cache_header))) {
+        return false;
+    }
+
+    const int fd = AP::FS().open(cache_name, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    cache_reader reader {};
+    reader.fd = fd;
+    size_t len = st.size - sizeof(bytecode_cache_header);
+
+    uint8_t prefix[4];
+    if (AP::FS().read(fd, prefix, sizeof(prefix)) != sizeof(prefix)) {
+        AP::FS().close(fd);
+        return false;
+    }
+    const bool encrypted = memcmp(prefix, "XOR1", sizeof(prefix)) == 0;
+#if AP_SCRIPTING_CRYPTO_ENABLED
+    if (encrypted) {
+        // the decrypt init reads and checks the header itself
+        AP::FS().lseek(fd, 0, SEEK_SET);
+        if ((len <= sizeof(prefix)) || !AP_Crypto::streaming_decrypt_init_xor_from_params(&reader.ctx, fd)) {
+            AP::FS().close(fd);
+            return false;
+        }
+        reader.encrypted = true;
+        len -= sizeof(prefix);
+    } else if (AP_Crypto_Params::is_encryption_enabled()) {
+        // plaintext cache written before encryption was enabled, it will be
+        // replaced with an encrypted one
+        AP::FS().close(fd);
+        return false;
+    } else
+#endif
+    {
+        if (encrypted) {
+            AP::FS().close(fd);
+            return false;
+        }
+        AP::FS().lseek(fd, 0, SEEK_SET);
+    }
+
+    bytecode_cache_header header;
+    const bool header_ok = reader.read(&header, sizeof(header)) &&
+                           (header.magic == SCRIPTING_CACHE_MAGIC) &&
+                           (header.source_crc == crc);
+    int error = LUA_OK;
+    if (header_ok) {
+        // stream the bytecode straight into lua rather than reading the
+        // whole file into the heap first. Only binary chunks are accepted,
+        // a stale cache from a different lua build fails the header check
+        reader.remaining = len;
+        lua_pushfstring(L, "@%s", filename);
+        error = lua_load(L, cache_reader::load, &reader, lua_tostring(L, -1), "b");
+        lua_remove(L, -2); // chunk name
+    }
+    AP::FS().close(fd);
+    if (encrypted) {
+        memset(reader.buf, 0, sizeof(reader.buf));
+    }
+#if AP_SCRIPTING_CRYPTO_ENABLED
+    if (reader.encrypted) {
+        AP_Crypto::streaming_decrypt_cleanup(&reader.ctx);
+    }
+#endif
+
+    if (!header_ok) {
+        return false;
+    }
+    if (error != LUA_OK) {
+        lua_pop(L, 1); // error message
+        return false;
+    }
+    return true;
+}
+
+// writes to the cache file, encrypting if required
+struct cache_writer {
+    int fd;
+#if AP_SCRIPTING_CRYPTO_ENABLED
+    AP_Crypto::StreamingEncrypt ctx;
+    bool encrypted;
+#endif
+    bool failed;
+
+    // lua_writer signature for lua_dump, non zero return stops the dump
+    static int write(lua_State *L, const void *p, size_t sz, void *ud) {
+        (void)L;
+        cache_writer *w = (cache_writer *)ud;
+        if (sz == 0) {
+            return 0;
+        }
+        int32_t n;
+#if AP_SCRIPTING_CRYPTO_ENABLED
+        if (w->encrypted) {
+            n = AP_Crypto::streaming_encrypt_write_xor(&w->ctx, w->fd, (const uint8_t *)p, sz);
+        } else
+#endif
+        {
+            n = AP::FS().write(w->fd, p, sz);
+        }
+        w->failed = (n < 0) || (size_t(n) != sz);
+        return w->failed ? 1 : 0;
+    }
+};
+
+void lua_scripts::write_cache(lua_State *L, const char *cache_name, uint32_t crc, bool encrypt) {
+    cache_writer writer {};
+
+#if AP_SCRIPTING_CRYPTO_ENABLED
+    encrypt = encrypt || AP_Crypto_Params::is_encryption_enabled();
+    if (encrypt && !AP_Crypto::streaming_encrypt_init_xor_from_params(&writer.ctx)) {
+        // never fall back to writing plaintext bytecode
+        return;
+    }
+    writer.encrypted = encrypt;
+#else
+    if (encrypt) {
+        return;
+    }
+#endif
+
+    // this fails harmlessly if the directory already exists
+    AP::FS().mkdir(SCRIPTING_CACHE_DIRECTORY);
+
+    writer.fd = AP::FS().open(cache_name, O_WRONLY|O_CREAT|O_TRUNC);
+    if (writer.fd < 0) {
+#if AP_SCRIPTING_CRYPTO_ENABLED
+        AP_Crypto::streaming_encrypt_cleanup(&writer.ctx);
+#endif
+        return;
+    }
+
+#if AP_SCRIPTING_CRYPTO_ENABLED
+    if (writer.encrypted && !AP_Crypto::streaming_encrypt_write_header_xor(&writer.ctx, writer.fd)) {
+        writer.failed = true;
+    }
+#endif
+
+    const bytecode_cache_header header {
+        magic : SCRIPTING_CACHE_MAGIC,
+        source_crc : crc,
+    };
+    if (!writer.failed) {
+        cache_writer::write(L, &header, sizeof(header), &writer);
+    }
+    if (!writer.failed) {
+        // keep debug information so errors from cached scripts still give
+        // the file and line, and the profiler can attribute samples
+        lua_dump(L, cache_writer::write, &writer, 0);
+    }
+
+#if AP_SCRIPTING_CRYPTO_ENABLED
+    if (writer.encrypted) {
+        AP_Crypto::streaming_encrypt_finalize_xor(&writer.ctx, writer.fd);
+        AP_Crypto::streaming_encrypt_cleanup(&writer.ctx);
+    }
+#endif
+    AP::FS().close(writer.fd);
+
+    if (writer.failed) {
+        // a partial file would be rejected on load, but don't leave it around
+        AP::FS().unlink(cache_name);
+    }
+}
+#endif // AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+
+int lua_scripts::load_chunk(lua_State *L, const char *filename, bool have_crc, uint32_t crc, bool &from_cache) {
+    from_cache = false;
+
+#if AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+    char cache_name[96];
+    const bool use_cache = have_crc && get_cache_filename(filename, cache_name, sizeof(cache_name));
+    if (use_cache && load_from_cache(L, cache_name, filename, crc)) {
+        from_cache = true;
+        return LUA_OK;
+    }
+#else
+    (void)have_crc;
+    (void)crc;
+#endif
+
+    bool encrypted = false;
+    int error;
+#if AP_SCRIPTING_CRYPTO_ENABLED
+    encrypted = is_encrypted_file(filename);
+    if (encrypted) {
+        error = load_encrypted_source(L, filename);
+    } else
+#endif
+    {
+        error = luaL_loadfile(L, filename);
+    }
+
+#if AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+    if ((error == LUA_OK) && use_cache) {
+        write_cache(L, cache_name, crc, encrypted);
+    }
+#else
+    (void)encrypted;
+#endif
+
+    return error;
 }
 
 lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename) {
-    if (int error = luaL_loadfile(L, filename)) {
+    const int loadMem = get_mem_used(L);
+    const uint32_t loadStart = AP_HAL::micros();
+    const size_t startPeak = mem_in_use;
+    mem_peak = mem_in_use;
+
+    // Get checksum of file, this is also the key for the bytecode cache
+    uint32_t crc = 0;
+    const bool have_crc = AP::FS().crc32(filename, crc);
+
+    bool from_cache;
+    if (int error = load_chunk(L, filename, have_crc, crc, from_cache)) {
         switch (error) {
             case LUA_ERRSYNTAX:
                 set_and_print_new_error_message(MAV_SEVERITY_CRITICAL, "Error: %s", get_error_object_message(L));
@@ -188,9 +773,6 @@ lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename)
         }
     }
 
-    const int loadMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
-    const uint32_t loadStart = AP_HAL::micros();
-
     script_info *new_script = (script_info *)_heap.allocate(sizeof(script_info));
     if (new_script == nullptr) {
         // No memory, shouldn't happen, we even attempted to do a GC
@@ -205,18 +787,20 @@ lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename)
     lua_setupvalue(L, -3, 1);
 
     const uint32_t loadEnd = AP_HAL::micros();
-    const int endMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+    const int endMem = get_mem_used(L);
 
     update_stats(filename, loadEnd-loadStart, endMem, loadMem);
+    if (option_is_set(AP_Scripting::DebugOption::RUNTIME_MSG)) {
+        GCS_SEND_TEXT(MAV_SEVERITY_DEBUG, "Lua: %s peak load mem: %u%s", filename, unsigned(mem_peak - startPeak), from_cache ? " (cached)" : "");
+    }
 
     new_script->name = filename;
     new_script->env_ref = luaL_ref(L, LUA_REGISTRYINDEX); // store reference to script's environment
     new_script->run_ref = luaL_ref(L, LUA_REGISTRYINDEX); // store reference to function to run
     new_script->next_run_ms = AP_HAL::millis64() - 1; // force the script to be stale
+    new_script->wake_events = 0;
 
-    // Get checksum of file
-    uint32_t crc = 0;
-    if (AP::FS().crc32(filename, crc)) {
+    if (have_crc) {
         // Record crc of this script
         new_script->crc = crc;
         {
@@ -285,38 +869,241 @@ void lua_scripts::load_all_scripts_in_dir(lua_State *L, const char *dirname) {
             continue;
         }
 
-        // FIXME: because chunk name fetching is not working we are allocating and storing an extra string we shouldn't need to
-        size_t size = strlen(dirname) + strlen(de->d_name) + 2;
-        char * filename = (char *) _heap.allocate(size);
-        if (filename == nullptr) {
+        // we have something that looks like a lua file, attempt to load it
+        load_script_file(L, dirname, de->d_name);
+    }
+    AP::FS().closedir(d);
+}
+
+void lua_scripts::load_script_file(lua_State *L, const char *dirname, const char *name) {
+    // FIXME: because chunk name fetching is not working we are allocating and storing an extra string we shouldn't need to
+    size_t size = strlen(dirname) + strlen(name) + 2;
+    char * filename = (char *) _heap.allocate(size);
+    if (filename == nullptr) {
+        return;
+    }
+    snprintf(filename, size, "%s/%s", dirname, name);
+
+    script_info * script = load_script(L, filename);
+    if (script == nullptr) {
+        _heap.deallocate(filename);
+        return;
+    }
+    reschedule_script(script);
+
+#if HAL_LOGGER_FILE_CONTENTS_ENABLED
+    if (!option_is_set(AP_Scripting::DebugOption::SUPPRESS_SCRIPT_LOG)) {
+        AP::logger().log_file_content(filename);
+    }
+#endif
+}
+
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+void lua_scripts::load_isolated_scripts(lua_State *L) {
+    auto *d = AP::FS().opendir(SCRIPTING_ISOLATED_DIRECTORY);
+    if (d == nullptr) {
+        // the directory is optional
+        return;
+    }
+
+    for (struct dirent *de=AP::FS().readdir(d); de; de=AP::FS().readdir(d)) {
+        uint8_t length = strlen(de->d_name);
+        if ((length < 5) || (de->d_name[0] == '.') || strncmp(&de->d_name[length-4], ".lua", 4)) {
             continue;
         }
-        snprintf(filename, size, "%s/%s", dirname, de->d_name);
 
-        // we have something that looks like a lua file, attempt to load it
-        script_info * script = load_script(L, filename);
-        if (script == nullptr) {
-            _heap.deallocate(filename);
+        // states keep running if the main state is restarted after a panic
+        bool running = false;
+        for (uint8_t i=0; i<num_isolated_states; i++) {
+            if (strcmp(isolated_states[i]->isolated_name, de->d_name) == 0) {
+                running = true;
+                break;
+            }
+        }
+        if (running || start_isolated_state(de->d_name)) {
             continue;
         }
-        reschedule_script(script);
 
-#if HAL_LOGGER_FILE_CONTENTS_ENABLED
-        if (!option_is_set(AP_Scripting::DebugOption::SUPPRESS_SCRIPT_LOG)) {
-            AP::logger().log_file_content(filename);
-        }
-#endif
+        // no thread available, run it with the other scripts
+        GCS_SEND_TEXT(MAV_SEVERITY_WARNING, "Lua: %s not isolated", de->d_name);
+        load_script_file(L, SCRIPTING_ISOLATED_DIRECTORY, de->d_name);
     }
     AP::FS().closedir(d);
 }
 
+bool lua_scripts::start_isolated_state(const char *name) {
+    AP_Scripting *scripting = AP_Scripting::get_singleton();
+    if (num_isolated_states >= MIN(scripting->get_isolated_threads(), SCRIPTING_MAX_ISOLATED_STATES)) {
+        return false;
+    }
+
+    // each state has its own heap, the VM instruction limit applies to each state separately
+    lua_scripts *state = NEW_NOTHROW lua_scripts(_vm_steps, scripting->get_isolated_heap_size(), _debug_options, name);
+    if ((state == nullptr) || !state->heap_allocated()) {
+        delete state;
+        return false;
+    }
+
+    if (!scripting->create_thread(FUNCTOR_BIND(state, &lua_scripts::isolated_thread, void), "ScriptingIso")) {
+        delete state;
+        return false;
+    }
+
+    isolated_states[num_isolated_states++] = state;
+    return true;
+}
+
+void lua_scripts::stop_isolated_states() {
+    for (uint8_t i=0; i<num_isolated_states; i++) {
+        isolated_states[i]->stop_requested = true;
+    }
+    // a state finishes its current script or delay before returning
+    for (uint8_t i=0; i<num_isolated_states; i++) {
+        while (!isolated_states[i]->isolated_finished) {
+            hal.scheduler->delay(10);
+        }
+        delete isolated_states[i];
+        isolated_states[i] = nullptr;
+    }
+    num_isolated_states = 0;
+}
+
+void lua_scripts::isolated_thread(void) {
+    run();
+    isolated_finished = true;
+}
+#endif // AP_SCRIPTING_ISOLATED_STATES_ENABLED
+
 void lua_scripts::reset_loop_overtime(lua_State *L) {
     overtime = false;
     // reset the hook to clear the counter
     const int32_t vm_steps = MAX(_vm_steps, 1000);
+#if AP_SCRIPTING_PROFILER_ENABLED
+    if (option_is_set(AP_Scripting::DebugOption::PROFILE) && profile_start()) {
+        // the hook takes a sample every interval and checks the time limit itself
+        profile_interval = MIN(int32_t(SCRIPTING_PROFILE_INTERVAL), vm_steps);
+        profile_steps_remaining = vm_steps;
+        lua_sethook(L, hook, LUA_MASKCOUNT, profile_interval);
+        return;
+    }
+    profile_steps_remaining = 0;
+#endif
     lua_sethook(L, hook, LUA_MASKCOUNT, vm_steps);
 }
 
+#if AP_SCRIPTING_PROFILER_ENABLED
+bool lua_scripts::profile_start() {
+    WITH_SEMAPHORE(profile_sem);
+    if (profile_entries == nullptr) {
+        // not from a scripting heap as the table is shared by all states, it is cleared when scripting restarts
+        profile_entries = (profile_entry *)hal.util->malloc_type(sizeof(profile_entry) * SCRIPTING_PROFILE_ENTRIES, AP_HAL::Util::MEM_FAST);
+    }
+    return profile_entries != nullptr;
+}
+
+void lua_scripts::profile_reset() {
+    WITH_SEMAPHORE(profile_sem);
+    if (profile_entries != nullptr) {
+        memset(profile_entries, 0, sizeof(profile_entry) * SCRIPTING_PROFILE_ENTRIES);
+    }
+    profile_dropped = 0;
+}
+
+// name to report for a function, the script name replaces the "?" lua gives
+// when the chunk has no source name
+static const char *profile_source_name(const lua_Debug &ar, const char *script_name) {
+    const char *name = ar.short_src;
+    if ((strcmp(name, "?") == 0) && (script_name != nullptr)) {
+        name = script_name;
+    }
+    const char *base = strrchr(name, '/');
+    return (base != nullptr) ? base + 1 : name;
+}
+
+void lua_scripts::profile_sample(lua_State *L, const char *script_name) {
+    // hash the file and line of each function in the stack, and the current
+    // line of the innermost, the folded stack is only formatted for new entries
+    lua_Debug ar;
+    uint64_t hash = FNV_1_OFFSET_BASIS_64;
+    int depth = 0;
+    while ((depth < SCRIPTING_PROFILE_MAX_DEPTH) && lua_getstack(L, depth, &ar)) {
+        lua_getinfo(L, (depth == 0) ? "Sl" : "S", &ar);
+        const char *name = profile_source_name(ar, script_name);
+        hash_fnv_1a(strlen(name), (const uint8_t *)name, &hash);
+        hash_fnv_1a(sizeof(ar.linedefined), (const uint8_t *)&ar.linedefined, &hash);
+        if (depth == 0) {
+            hash_fnv_1a(sizeof(ar.currentline), (const uint8_t *)&ar.currentline, &hash);
+        }
+        depth++;
+    }
+    if ((depth == 0) || (hash == 0)) {
+        return;
+    }
+
+    WITH_SEMAPHORE(profile_sem);
+    // open addressing, the table never shrinks so probing can stop at the first free entry
+    for (uint8_t i=0; i<SCRIPTING_PROFILE_ENTRIES; i++) {
+        profile_entry &e = profile_entries[(hash + i) % SCRIPTING_PROFILE_ENTRIES];
+        if (e.hash == hash) {
+            e.count++;
+            return;
+        }
+        if (e.hash == 0) {
+            e.hash = hash;
+            e.count = 1;
+            profile_format_stack(L, depth, script_name, e.stack, sizeof(e.stack));
+            return;
+        }
+    }
+    profile_dropped++;
+}
+
+void lua_scripts::profile_format_stack(lua_State *L, int depth, const char *script_name, char *buf, size_t len) {
+    size_t ofs = 0;
+    buf[0] = 0;
+    for (int level = depth - 1; (level >= 0) && (ofs < len); level--) {
+        lua_Debug ar;
+        if (!lua_getstack(L, level, &ar) || !lua_getinfo(L, (level == 0) ? "Sl" : "S", &ar)) {
+            break;
+        }
+        const char *sep = (level == depth - 1) ? "" : ";";
+        int n;
+        if (*ar.what == 'C') {
+            n = snprintf(&buf[ofs], len - ofs, "%s[C]", sep);
+        } else {
+            // file name and the line the function is defined on, which is 0 for the main chunk
+            const char *name = profile_source_name(ar, script_name);
+            n = snprintf(&buf[ofs], len - ofs, "%s%s:%d", sep, name, ar.linedefined);
+            if ((level == 0) && (n > 0) && (size_t(n) < len - ofs)) {
+                // the innermost function also gets the line it is running
+                ofs += n;
+                n = snprintf(&buf[ofs], len - ofs, ":%d", ar.currentline);
+            }
+        }
+        if (n < 0) {
+            break;
+        }
+        ofs += n;
+    }
+}
+
+void lua_scripts::profile_info(ExpandingString &str) {
+    WITH_SEMAPHORE(profile_sem);
+    if (profile_entries == nullptr) {
+        return;
+    }
+    for (uint8_t i=0; i<SCRIPTING_PROFILE_ENTRIES; i++) {
+        const profile_entry &e = profile_entries[i];
+        if (e.hash != 0) {
+            str.printf("%s %u\n", e.stack, unsigned(e.count));
+        }
+    }
+    if (profile_dropped > 0) {
+        str.printf("[dropped] %u\n", unsigned(profile_dropped));
+    }
+}
+#endif // AP_SCRIPTING_PROFILER_ENABLED
+
 void lua_scripts::run_next_script(lua_State *L) {
     if (scripts == nullptr) {
 #if defined(AP_SCRIPTING_CHECKS) && AP_SCRIPTING_CHECKS >= 1
@@ -339,9 +1126,13 @@ void lua_scripts::run_next_script(lua_State *L) {
     // pop the function to the top of the stack
     lua_rawgeti(L, LUA_REGISTRYINDEX, script->run_ref);
     // set current environment for other users
-    AP::scripting()->set_current_env_ref(script->env_ref);
+    current_env_ref = script->env_ref;
 
-    if(lua_pcall(L, 0, LUA_MULTRET, 0)) {
+    running_script = script;
+    const int pcall_result = lua_pcall(L, 0, LUA_MULTRET, 0);
+    running_script = nullptr;
+
+    if (pcall_result) {
         if (overtime) {
             // script has consumed an excessive amount of CPU time
             set_and_print_new_error_message(MAV_SEVERITY_CRITICAL, "%s exceeded time limit", script->name);
@@ -395,6 +1186,115 @@ void lua_scripts::run_next_script(lua_State *L) {
      }
 }
 
+void lua_scripts::wait_for_event(uint64_t delay_ms) {
+    uint8_t wanted;
+    {
+        WITH_SEMAPHORE(wake_sem);
+        wanted = wake_events_wanted;
+    }
+    // long delays are waited for in parts, the caller checks again when this returns
+    if (wanted == 0) {
+        // no script is waiting on events
+        hal.scheduler->delay(MIN(delay_ms, uint64_t(UINT16_MAX)));
+        return;
+    }
+
+    if (!wake_signal.wait(MIN(delay_ms, uint64_t(UINT32_MAX / 1000U)) * 1000U)) {
+        // timed out, the next script is due
+        return;
+    }
+
+    uint8_t events;
+    {
+        WITH_SEMAPHORE(wake_sem);
+        events = wake_events_pending;
+        wake_events_pending = 0;
+    }
+    if (events == 0) {
+        return;
+    }
+
+    // rebuild the queue with the woken scripts due now
+    const uint64_t now_ms = AP_HAL::millis64();
+    script_info *list = scripts;
+    scripts = nullptr;
+    while (list != nullptr) {
+        script_info *script = list;
+        list = script->next;
+        if (((script->wake_events & events) != 0) && (script->next_run_ms > now_ms)) {
+            script->next_run_ms = now_ms;
+        }
+        reschedule_script(script);
+    }
+}
+
+void lua_scripts::wake(uint8_t events) {
+    WITH_SEMAPHORE(wake_sem);
+    for (lua_scripts *state = wake_list; state != nullptr; state = state->wake_next) {
+        const uint8_t woken = state->wake_events_wanted & events;
+        if (woken != 0) {
+            state->wake_events_pending |= woken;
+            state->wake_signal.signal();
+        }
+    }
+}
+
+void lua_scripts::wake_on(lua_State *L, AP_Scripting::WakeEvent event) {
+    lua_scripts *state = get_instance(L);
+    if (state->running_script == nullptr) {
+        return;
+    }
+    state->running_script->wake_events |= uint8_t(event);
+
+    WITH_SEMAPHORE(wake_sem);
+    state->wake_events_wanted |= uint8_t(event);
+}
+
+bool lua_scripts::find_param(lua_State *L, const char *name, Parameter &param) {
+    lua_scripts *self = get_instance(L);
+    const size_t cache_size = sizeof(param_cache_entry) * SCRIPTING_PARAM_CACHE_SIZE;
+    const uint16_t marker = AP_Param::get_count_marker();
+
+    if (self->param_cache == nullptr) {
+        self->param_cache = (param_cache_entry *)self->_heap.allocate(cache_size);
+        if (self->param_cache == nullptr) {
+            // no memory for the cache, search every time
+            return param.init(name);
+        }
+        memset(self->param_cache, 0, cache_size);
+        self->param_cache_marker = marker;
+    }
+
+    if (self->param_cache_marker != marker) {
+        // the parameter tree has changed, cached pointers may no longer be valid
+        memset(self->param_cache, 0, cache_size);
+        self->param_cache_marker = marker;
+    }
+
+    const size_t len = strnlen(name, AP_MAX_NAME_SIZE+1);
+    if (len > AP_MAX_NAME_SIZE) {
+        return false;
+    }
+
+    uint64_t hash = FNV_1_OFFSET_BASIS_64;
+    hash_fnv_1a(len, (const uint8_t *)name, &hash);
+    param_cache_entry &entry = self->param_cache[hash & (SCRIPTING_PARAM_CACHE_SIZE - 1)];
+
+    if (strncmp(entry.name, name, sizeof(entry.name)) != 0) {
+        // miss, replace whatever was in this slot
+        if (!param.init(name)) {
+            // not cached, so a typo doesn't evict a valid entry
+            return false;
+        }
+        memcpy(entry.name, name, len + 1);
+        entry.param = param;
+        return true;
+    }
+
+    param = entry.param;
+    return true;
+}
+
 void lua_scripts::remove_script(lua_State *L, script_info *script) {
     if (script == nullptr) {
         return;
@@ -464,11 +1364,63 @@ void lua_scripts::reschedule_script(script_info *script) {
     previous->next = script;
 }
 
-MultiHeap lua_scripts::_heap;
+// print usage of each slab class, fragmentation is the percentage of
+// objects in the assigned pages that are not in use
+void lua_scripts::print_slab_stats() const {
+    for (uint8_t i=0; i<MultiHeap::num_slab_classes; i++) {
+        MultiHeap::SlabStats stats;
+        if (!_heap.get_slab_stats(i, stats)) {
+            return;
+        }
+        const uint32_t capacity = uint32_t(stats.pages) * stats.objects_per_page;
+        const uint32_t frag_pct = (capacity > 0) ? (100U * (capacity - stats.objects) / capacity) : 0;
+        GCS_SEND_TEXT(MAV_SEVERITY_DEBUG, "Lua: Slab %u: %u/%u max %u pages %u max %u frag %u%%",
+                      unsigned(stats.object_size),
+                      unsigned(stats.objects), unsigned(capacity), unsigned(stats.objects_max),
+                      unsigned(stats.pages), unsigned(stats.pages_max),
+                      unsigned(frag_pct));
+    }
+}
+
+int lua_scripts::get_mem_used(lua_State *L) {
+    return lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+}
+
+// run incremental garbage collection for at most budget_us
+// stops when a cycle is finished, and does not start a new cycle until memory has been allocated
+// at least one step is always taken, so collection keeps up even when the next script is already due
+// returns time spent in microseconds
+uint32_t lua_scripts::collect_garbage(lua_State *L, uint32_t budget_us) {
+    if (gc.cycle_complete && (get_mem_used(L) <= gc.mem_after_cycle)) {
+        // nothing has been allocated since the last cycle
+        return 0;
+    }
+    gc.cycle_complete = false;
+
+    const uint32_t start_us = AP_HAL::micros();
+    do {
+        // a basic step returns 1 when it finishes a cycle
+        if (lua_gc(L, LUA_GCSTEP, 0)) {
+            gc.cycle_complete = true;
+            gc.mem_after_cycle = get_mem_used(L);
+            break;
+        }
+    } while ((AP_HAL::micros() - start_us) < budget_us);
+    return AP_HAL::micros() - start_us;
+}
 
 void *lua_scripts::alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
-    (void)ud; /* not used */
-    return _heap.change_size(ptr, osize, nsize);
+    lua_scripts *self = (lua_scripts *)ud;
+    void *ret = self->_heap.change_size(ptr, osize, nsize);
+    if ((ret != nullptr) || (nsize == 0)) {
+        // when ptr is null osize is the type of the new object, not a size
+        self->mem_in_use += nsize - ((ptr != nullptr) ? osize : 0);
+        self->mem_peak = MAX(self->mem_peak, self->mem_in_use);
+        if ((ptr == nullptr) && (nsize != 0)) {
+            self->alloc_count++;
+        }
+    }
+    return ret;
 }
 
 void lua_scripts::run(void) {
@@ -482,6 +1434,9 @@ void lua_scripts::run(void) {
     // panic should be hooked first
     if (ap_setjmp(panic_jmp)) {
         if (!succeeded_initial_load) {
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+            stop_isolated_states();
+#endif
             return;
         }
         if (lua_state != nullptr) {
@@ -492,10 +1447,16 @@ void lua_scripts::run(void) {
             remove_script(nullptr, script);
         }
         scripts = nullptr;
+        running_script = nullptr;
         overtime = false;
+        {
+            WITH_SEMAPHORE(wake_sem);
+            wake_events_wanted = 0;
+            wake_events_pending = 0;
+        }
     }
 
-    lua_state = lua_newstate(alloc, NULL);
+    lua_state = lua_newstate(alloc, this);
     lua_State *L = lua_state;
     if (L == nullptr) {
         GCS_SEND_TEXT(MAV_SEVERITY_CRITICAL, "Lua: Couldn't allocate a lua state");
@@ -504,6 +1465,13 @@ void lua_scripts::run(void) {
 
     lua_atpanic(L, atpanic);
 
+    // must be done before any userdata is created
+    load_generated_bindings(L);
+
+    // the collector is stepped between scripts, see collect_garbage
+    lua_gc(L, LUA_GCSETPAUSE, SCRIPTING_GC_PAUSE);
+    gc.cycle_complete = false;
+
     // set up string metatable. we set up one for all scripts that no script has
     // access to, as it's impossible to set up one per-script and we don't want
     // any script to be able to mess with it.
@@ -515,7 +1483,7 @@ void lua_scripts::run(void) {
     lua_pop(L, 1);  /* pop dummy string */
 
     if (option_is_set(AP_Scripting::DebugOption::RUNTIME_MSG)) {
-        const int loaded_mem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+        const int loaded_mem = get_mem_used(L);
         GCS_SEND_TEXT(MAV_SEVERITY_DEBUG, "Lua: State memory usage: %i\n", loaded_mem);
     }
 
@@ -523,18 +1491,31 @@ void lua_scripts::run(void) {
     // Skip those directores disabled with SCR_DIR_DISABLE param
     uint16_t dir_disable = AP_Scripting::get_singleton()->get_disabled_dir();
     bool loaded = false;
-    if ((dir_disable & uint16_t(AP_Scripting::SCR_DIR::SCRIPTS)) == 0) {
+    const uint32_t boot_start_ms = AP_HAL::millis();
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+    if (is_isolated()) {
+        // an isolated state only runs its own script
+        load_script_file(L, SCRIPTING_ISOLATED_DIRECTORY, isolated_name);
+        loaded = true;
+    }
+#endif
+    if (!is_isolated() && ((dir_disable & uint16_t(AP_Scripting::SCR_DIR::SCRIPTS)) == 0)) {
         load_all_scripts_in_dir(L, SCRIPTING_DIRECTORY);
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+        load_isolated_scripts(L);
+#endif
         loaded = true;
     }
 #ifdef HAL_HAVE_AP_ROMFS_EMBEDDED_LUA
-    if ((dir_disable & uint16_t(AP_Scripting::SCR_DIR::ROMFS)) == 0) {
+    if (!is_isolated() && ((dir_disable & uint16_t(AP_Scripting::SCR_DIR::ROMFS)) == 0)) {
         load_all_scripts_in_dir(L, "@ROMFS/scripts");
         loaded = true;
     }
 #endif
     if (!loaded) {
         GCS_SEND_TEXT(MAV_SEVERITY_CRITICAL, "Lua: All directory's disabled see SCR_DIR_DISABLE");
+    } else if (option_is_set(AP_Scripting::DebugOption::RUNTIME_MSG)) {
+        GCS_SEND_TEXT(MAV_SEVERITY_DEBUG, "Lua: Loaded scripts in %u ms", unsigned(AP_HAL::millis() - boot_start_ms));
     }
 
 #ifndef __clang_analyzer__
@@ -542,8 +1523,9 @@ void lua_scripts::run(void) {
 #endif // __clang_analyzer__
 
     uint32_t expansion_size = 0;
+    uint32_t last_slab_print_ms = 0;
 
-    while (AP_Scripting::get_singleton()->should_run()) {
+    while (should_run()) {
 #if defined(AP_SCRIPTING_CHECKS) && AP_SCRIPTING_CHECKS >= 1
         if (lua_gettop(L) != 0) {
             AP_HAL::panic("Lua: Stack should be empty before running scripts");
@@ -565,9 +1547,16 @@ void lua_scripts::run(void) {
             // compute delay time
             uint64_t now_ms = AP_HAL::millis64();
             if (now_ms < scripts->next_run_ms) {
-                hal.scheduler->delay(scripts->next_run_ms - now_ms);
+                // an event may change which script is next, so check again after waiting
+                wait_for_event(scripts->next_run_ms - now_ms);
+                continue;
             }
 
+            // how late the script is, this includes waiting for the other scripts in this state
+            const uint64_t due_us = scripts->next_run_ms * 1000U;
+            const uint64_t wake_us = AP_HAL::micros64();
+            const uint32_t wake_time = (wake_us > due_us) ? MIN(wake_us - due_us, uint64_t(UINT32_MAX)) : 0;
+
             if (option_is_set(AP_Scripting::DebugOption::RUNTIME_MSG)) {
                 GCS_SEND_TEXT(MAV_SEVERITY_DEBUG, "Lua: Running %s", scripts->name);
             }
@@ -581,7 +1570,9 @@ void lua_scripts::run(void) {
             void *istate = hal.scheduler->disable_interrupts_save();
 #endif
 
-            const int startMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+            const int startMem = get_mem_used(L);
+            const uint32_t startAllocs = alloc_count;
+            mem_peak = mem_in_use;
             const uint32_t loadEnd = AP_HAL::micros();
 
             // NOTE!  the base pointer of our scripts linked list,
@@ -591,17 +1582,28 @@ void lua_scripts::run(void) {
             run_next_script(L);
 
             const uint32_t runEnd = AP_HAL::micros();
-            const int endMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+            const int endMem = get_mem_used(L);
+            const uint32_t steps = steps_used(L);
 
 #if DISABLE_INTERRUPTS_FOR_SCRIPT_RUN
             hal.scheduler->restore_interrupts(istate);
 #endif
 
-            update_stats(script_name, runEnd - loadEnd, endMem, endMem - startMem);
-
+            // collect garbage in the gap before the next script is due, this
+            // keeps the heap close to the size of the live data without the
+            // cost of a full collection after every script. If the next
+            // script is already due this is a single step
+            uint32_t gc_budget_us = SCRIPTING_GC_BUDGET_US;
+            if (scripts != nullptr) {
+                const uint64_t gc_now_ms = AP_HAL::millis64();
+                const uint64_t gap_ms = (scripts->next_run_ms > gc_now_ms) ? (scripts->next_run_ms - gc_now_ms) : 0;
+                gc_budget_us = MIN(gap_ms * 1000U, gc_budget_us);
+            }
+            const uint32_t gc_time = collect_garbage(L, gc_budget_us);
+            const int gc_mem = endMem - get_mem_used(L);
 
-            // garbage collect after each script, this shouldn't matter, but seems to resolve a memory leak
-            lua_gc(L, LUA_GCCOLLECT, 0);
+            update_stats(script_name, runEnd - loadEnd, endMem, endMem - startMem, gc_time, gc_mem, wake_time);
+            update_run_stats(script_name, steps, runEnd - loadEnd, gc_time, alloc_count - startAllocs, mem_peak);
 
         } else {
             if (option_is_set(AP_Scripting::DebugOption::NO_SCRIPTS_TO_RUN)) {
@@ -618,7 +1620,18 @@ void lua_scripts::run(void) {
         const uint32_t new_expansion_size = _heap.get_expansion_size();
         if (new_expansion_size > expansion_size) {
             expansion_size = new_expansion_size;
-            set_and_print_new_error_message(MAV_SEVERITY_WARNING, "Required SCR_HEAP_SIZE over %u", unsigned(expansion_size));
+            set_and_print_new_error_message(MAV_SEVERITY_WARNING, "Required %s over %u", is_isolated() ? "SCR_ISO_HEAP" : "SCR_HEAP_SIZE", unsigned(expansion_size));
+        }
+
+        if (is_isolated()) {
+            // the main state reports shared stats and errors
+            continue;
+        }
+
+        // report slab usage every 10 seconds
+        if (option_is_set(AP_Scripting::DebugOption::RUNTIME_MSG) && (AP_HAL::millis() - last_slab_print_ms > 10000)) {
+            last_slab_print_ms = AP_HAL::millis();
+            print_slab_stats();
         }
 
         // re-print the latest error message every 10 seconds 10 times
@@ -640,9 +1653,17 @@ void lua_scripts::run(void) {
         lua_state = nullptr;
     }
 
+    if (is_isolated()) {
+        return;
+    }
+
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+    stop_isolated_states();
+#endif
+
     error_msg_buf_sem.take_blocking();
     if (error_msg_buf != nullptr) {
-        _heap.deallocate(error_msg_buf);
+        hal.util->free_type(error_msg_buf, error_msg_buf_len, AP_HAL::Util::MEM_FAST);
         error_msg_buf = nullptr;
     }
     error_msg_buf_sem.give();
@@ -28,13 +28,14 @@
 #include <AP_HAL/Semaphores.h>
 #include <AP_MultiHeap/AP_MultiHeap.h>
 #include "lua_common_defs.h"
+#include "AP_Scripting_helpers.h"
 
 #include "lua/src/lua.hpp"
 
 class lua_scripts
 {
 public:
-    lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, AP_Int8 &debug_options);
+    lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, AP_Int8 &debug_options, const char *isolated_script=nullptr);
 
     ~lua_scripts();
 
@@ -46,10 +47,21 @@ public:
     // run scripts, does not return unless an error occured
     void run(void);
 
-    static bool overtime; // script exceeded it's execution slot, and we are bailing out
+    // return the environment of the script currently running in this state, used by require
+    static int get_current_env_ref(lua_State *L) { return get_instance(L)->current_env_ref; }
 
 private:
 
+    // return the instance that owns a lua state, this is the allocator user data
+    static lua_scripts *get_instance(lua_State *L) {
+        void *ud;
+        lua_getallocf(L, &ud);
+        return (lua_scripts *)ud;
+    }
+
+    bool overtime; // script exceeded it's execution slot, and we are bailing out
+    int current_env_ref; // environment of the script being run
+
     void create_sandbox(lua_State *L);
 
     typedef struct script_info {
@@ -57,16 +69,48 @@ private:
        int run_ref;          // reference to the function to run
        uint64_t next_run_ms; // time (in milliseconds) the script should next be run at
        uint32_t crc;         // crc32 checksum
+       uint8_t wake_events;  // AP_Scripting::WakeEvent bits that run the script before next_run_ms
        char *name;           // filename for the script // FIXME: This information should be available from Lua
        script_info *next;
     } script_info;
 
     script_info *load_script(lua_State *L, char *filename);
 
+    // load the chunk for a script onto the stack, from the bytecode cache if
+    // it is valid for the given source crc, returns a lua error code
+    int load_chunk(lua_State *L, const char *filename, bool have_crc, uint32_t crc, bool &from_cache);
+
+#if AP_SCRIPTING_CRYPTO_ENABLED
+    // return true if the file has an AP_Crypto header
+    static bool is_encrypted_file(const char *filename);
+
+    // decrypt and compile an encrypted script, returns a lua error code
+    static int load_encrypted_source(lua_State *L, const char *filename);
+#endif
+
+#if AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+    // file the compiled bytecode of a script is cached in, returns false if the name does not fit
+    static bool get_cache_filename(const char *filename, char *cache_name, uint8_t len);
+
+    // load bytecode from the cache, returns false if there is no valid cache for this crc
+    bool load_from_cache(lua_State *L, const char *cache_name, const char *filename, uint32_t crc);
+
+    // write the bytecode of the function at the top of the stack to the cache
+    void write_cache(lua_State *L, const char *cache_name, uint32_t crc, bool encrypt);
+
+    struct PACKED bytecode_cache_header {
+        uint32_t magic;
+        uint32_t source_crc;  // crc32 of the script the bytecode was compiled from
+    };
+#endif
+
     void reset_loop_overtime(lua_State *L);
 
     void load_all_scripts_in_dir(lua_State *L, const char *dirname);
 
+    // load and schedule a single script
+    void load_script_file(lua_State *L, const char *dirname, const char *name);
+
     void run_next_script(lua_State *L);
 
     void remove_script(lua_State *L, script_info *script);
@@ -75,14 +119,61 @@ private:
     void reschedule_script(script_info *script);
 
     script_info *scripts; // linked list of scripts to be run, sorted by next run time (soonest first)
+    script_info *running_script; // script being run, nullptr between scripts
+
+    // sleep for up to delay_ms, returning early if an event a script is
+    // waiting on happens, those scripts are then moved to the front of the queue
+    void wait_for_event(uint64_t delay_ms);
+
+    // states that can be woken by events, protected by wake_sem
+    static lua_scripts *wake_list;
+    lua_scripts *wake_next;
+    static HAL_Semaphore wake_sem;
+
+    uint8_t wake_events_wanted;  // events any script in this state is waiting on
+    uint8_t wake_events_pending; // events that have happened since last checked
+    HAL_BinarySemaphore wake_signal;
+
+    // cache of parameter name lookups, direct mapped on a hash of the name
+    struct param_cache_entry {
+        char name[AP_MAX_NAME_SIZE+1]; // empty if unused
+        Parameter param;
+    };
+    param_cache_entry *param_cache; // allocated on first use
+    uint16_t param_cache_marker;    // AP_Param count marker the entries are valid for
 
     // hook will be run when CPU time for a script is exceeded
     // it must be static to be passed to the C API
     static void hook(lua_State *L, lua_Debug *ar);
 
+#if AP_SCRIPTING_PROFILER_ENABLED
+    // when profiling the hook runs more often to take samples, counting
+    // down the instructions left before the script is over time
+    int32_t profile_steps_remaining;
+    int32_t profile_interval;
+
+    // allocate the table of samples, returns false if there is no memory
+    static bool profile_start();
+
+    // clear the samples from scripts that ran before a restart
+    static void profile_reset();
+
+    // count a sample of the call stack of the running script, script_name is
+    // used for functions with no source name, such as from stripped bytecode
+    static void profile_sample(lua_State *L, const char *script_name);
+
+    // write the call stack to buf in folded format, outermost function first
+    static void profile_format_stack(lua_State *L, int depth, const char *script_name, char *buf, size_t len);
+
+    struct profile_entry;
+    static profile_entry *profile_entries;
+    static uint32_t profile_dropped; // samples that did not fit in the table
+    static HAL_Semaphore profile_sem;
+#endif
+
     // lua panic handler, will jump back to the start of run
     static int atpanic(lua_State *L);
-    static ap_jmp_buf panic_jmp;
+    ap_jmp_buf panic_jmp;
 
     lua_State *lua_state;
 
@@ -95,14 +186,84 @@ private:
 
     static void *alloc(void *ud, void *ptr, size_t osize, size_t nsize);
 
-    static MultiHeap _heap;
+    MultiHeap _heap;
+
+    // bytes allocated by lua and the high water mark, used to report the peak heap needed to load a script
+    size_t mem_in_use;
+    size_t mem_peak;
 
     // helper for print and log of runtime stats
-    void update_stats(const char *name, uint32_t run_time, int total_mem, int run_mem);
+    void update_stats(const char *name, uint32_t run_time, int total_mem, int run_mem, uint32_t gc_time=0, int gc_mem=0, uint32_t wake_time=0);
+
+    // number of allocations made by lua, used for the per run count
+    uint32_t alloc_count;
+
+    // number of VM instructions run since reset_loop_overtime
+    uint32_t steps_used(lua_State *L) const;
+
+    // log and record the resources used by a single run of a script
+    void update_run_stats(const char *name, uint32_t steps, uint32_t run_time, uint32_t gc_time, uint32_t allocs, uint32_t heap_peak);
+
+#if AP_SCRIPTING_RUN_STATS_ENABLED
+    // table of run stats by script name, shared by all states
+    struct run_stats_entry;
+    static run_stats_entry *run_stats;
+    static HAL_Semaphore run_stats_sem;
+#endif
+
+#if AP_SCRIPTING_ISOLATED_STATES_ENABLED
+    // file name of the single script run by an isolated state, nullptr for the main state
+    char *isolated_name;
+
+    // isolated states started by the main state, each runs one script in its own thread
+    lua_scripts *isolated_states[SCRIPTING_MAX_ISOLATED_STATES];
+    uint8_t num_isolated_states;
+
+    // set by the main state to stop an isolated state, and by its thread once run has returned
+    volatile bool stop_requested;
+    volatile bool isolated_finished;
+
+    bool is_isolated() const { return isolated_name != nullptr; }
+
+    bool should_run() const { return !stop_requested && AP_Scripting::get_singleton()->should_run(); }
+
+    // start a state for each script in the isolated directory, up to SCR_ISO_THREADS
+    // scripts that can't be given a thread are loaded into the main state
+    void load_isolated_scripts(lua_State *L);
+
+    // returns false if there is no free thread or memory for the state
+    bool start_isolated_state(const char *name);
+
+    // stop the isolated states, waiting for their threads to finish
+    void stop_isolated_states();
+
+    // thread of an isolated state
+    void isolated_thread(void);
+#else
+    bool is_isolated() const { return false; }
+
+    bool should_run() const { return AP_Scripting::get_singleton()->should_run(); }
+#endif
+
+    // print usage of the heap's small allocation slabs
+    void print_slab_stats() const;
+
+    // return memory in use by the lua state in bytes
+    static int get_mem_used(lua_State *L);
+
+    // run incremental garbage collection for at most budget_us
+    // returns time spent in microseconds
+    uint32_t collect_garbage(lua_State *L, uint32_t budget_us);
+
+    struct {
+        bool cycle_complete;    // true if the last collection finished a cycle
+        int mem_after_cycle;    // memory in use when the last cycle finished
+    } gc;
 
     // must be static for use in atpanic
     static void print_error(MAV_SEVERITY severity);
     static char *error_msg_buf;
+    static size_t error_msg_buf_len;
     static HAL_Semaphore error_msg_buf_sem;
     static uint8_t print_error_count;
     static uint32_t last_print_ms;
@@ -126,6 +287,26 @@ public:
     static uint32_t get_loaded_checksum();
     static uint32_t get_running_checksum();
 
+    // wake the scripts in any state that are waiting on the events, may be called from any thread
+    static void wake(uint8_t events);
+
+    // run the script that is running on L when the event happens, for bindings
+    static void wake_on(lua_State *L, AP_Scripting::WakeEvent event);
+
+    // find a parameter by name for the param:get and param:set bindings,
+    // looked up through a cache in the state running L
+    static bool find_param(lua_State *L, const char *name, Parameter &param);
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+    // sampled call stacks in folded format for @SYS/scripts_profile.txt
+    static void profile_info(ExpandingString &str);
+#endif
+
+#if AP_SCRIPTING_RUN_STATS_ENABLED
+    // run time percentiles and resource usage of each script for @SYS/scripts.txt
+    static void run_stats_info(ExpandingString &str);
+#endif
+
 };
 
 #endif  // AP_SCRIPTING_ENABLED
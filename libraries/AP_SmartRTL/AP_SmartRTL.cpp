@@ -31,7 +31,7 @@ const AP_Param::GroupInfo AP_SmartRTL::var_info[] = {
     // @Param: POINTS
     // @DisplayName: SmartRTL maximum number of points on path
     // @Description: SmartRTL maximum number of points on path. Set to 0 to disable SmartRTL.  100 points consumes about 3k of memory.
-    // @Range: 0 500
+    // @Range: 0 5000
     // @User: Advanced
     // @RebootRequired: True
     AP_GROUPINFO("POINTS", 1, AP_SmartRTL, _points_max, SMARTRTL_POINTS_DEFAULT),
@@ -70,7 +70,14 @@ const AP_Param::GroupInfo AP_SmartRTL::var_info[] = {
 *    The simplification and pruning algorithms run in the background and do not
 *    alter the path in memory.  Two definitions, SMARTRTL_SIMPLIFY_TIME_US and
 *    SMARTRTL_PRUNING_LOOP_TIME_US are used to limit how long each algorithm will
-*    be run before they save their state and return.
+*    be run before they save their state and return.  The simplification
+*    algorithm saves its state part way through searching a segment so that
+*    long segments do not overrun the time limit.
+*
+*    For paths of more than SMARTRTL_PRUNING_GRID_MIN_POINTS points, pruning
+*    first adds each segment to a grid of cells (hashed into a fixed number of
+*    buckets) so that each segment is only compared with the segments that
+*    share a cell with it, instead of with every earlier segment.
 *
 *    Both algorithms are "anytime algorithms" meaning they can be interrupted
 *    before they complete which is helpful when memory is filling up and we just
@@ -127,6 +134,26 @@ void AP_SmartRTL::init()
 
     _path_points_max = _points_max;
 
+    // allocate segment grid for long paths.  If this fails pruning falls back
+    // to checking every pair of segments
+    if (_points_max > SMARTRTL_PRUNING_GRID_MIN_POINTS && !_prune.grid.disabled) {
+        uint16_t num_buckets = 1;
+        while (num_buckets < _points_max / 2) {
+            num_buckets <<= 1;
+        }
+        _prune.grid.entries_max = _points_max * SMARTRTL_PRUNING_GRID_ENTRIES_MULT;
+        _prune.grid.heads = (uint16_t*)calloc(num_buckets, sizeof(uint16_t));
+        _prune.grid.entries = (decltype(_prune.grid.entries))calloc(_prune.grid.entries_max, sizeof(_prune.grid.entries[0]));
+        if (_prune.grid.heads == nullptr || _prune.grid.entries == nullptr) {
+            free(_prune.grid.heads);
+            free(_prune.grid.entries);
+            _prune.grid.heads = nullptr;
+            _prune.grid.entries = nullptr;
+        } else {
+            _prune.grid.num_buckets = num_buckets;
+        }
+    }
+
     // when running the example sketch, we want the cleanup tasks to run when we tell them to, not in the background (so that they can be timed.)
     if (!_example_mode){
         // register background cleanup to run in IO thread
@@ -500,7 +527,7 @@ void AP_SmartRTL::detect_simplifications()
     }
 
     // if not complete but also nothing to do, we must be restarting
-    if (_simplify.stack_count == 0) {
+    if (_simplify.stack_count == 0 && !_simplify.scan.active) {
         // reset to beginning state. add a single element in the array with:
         //   start = first path point OR the index of the last already-simplified point
         //   finish = final path point
@@ -510,37 +537,52 @@ void AP_SmartRTL::detect_simplifications()
     }
 
     const uint32_t start_time_us = AP_HAL::micros();
-    while (_simplify.stack_count > 0) { // while there is something to do
+    while (_simplify.stack_count > 0 || _simplify.scan.active) { // while there is something to do
 
         // if this method has run for long enough, exit
         if (AP_HAL::micros() - start_time_us > SMARTRTL_SIMPLIFY_TIME_US) {
             return;
         }
 
-        // pop last item off the simplify stack
-        const simplify_start_finish_t tmp = _simplify.stack[--_simplify.stack_count];
-        const uint16_t start_index = tmp.start;
-        const uint16_t end_index = tmp.finish;
+        if (!_simplify.scan.active) {
+            // pop last item off the simplify stack
+            const simplify_start_finish_t tmp = _simplify.stack[--_simplify.stack_count];
+            _simplify.scan.active = true;
+            _simplify.scan.start = tmp.start;
+            _simplify.scan.finish = tmp.finish;
+            _simplify.scan.index = tmp.start + 1;
+            _simplify.scan.farthest_point_index = tmp.start;
+            _simplify.scan.max_dist = 0.0f;
+        }
+        const uint16_t start_index = _simplify.scan.start;
+        const uint16_t end_index = _simplify.scan.finish;
 
         // find the point between start and end points that is farthest from the start-end line segment
-        float max_dist = 0.0f;
-        uint16_t farthest_point_index = start_index;
-        for (uint16_t i = start_index + 1; i < end_index; i++) {
+        // a limited number of points are checked before checking the time again
+        const uint16_t scan_limit = MIN(end_index, _simplify.scan.index + SMARTRTL_SIMPLIFY_POINTS_PER_CHECK);
+        for (uint16_t i = _simplify.scan.index; i < scan_limit; i++) {
             // only check points that have not already been flagged for simplification
             if (_simplify.bitmask.get(i)) {
                 const float dist = _path[i].distance_to_segment(_path[start_index], _path[end_index]);
-                if (dist > max_dist) {
-                    farthest_point_index = i;
-                    max_dist = dist;
+                if (dist > _simplify.scan.max_dist) {
+                    _simplify.scan.farthest_point_index = i;
+                    _simplify.scan.max_dist = dist;
                 }
             }
         }
+        _simplify.scan.index = scan_limit;
+        if (_simplify.scan.index < end_index) {
+            // more points to check
+            continue;
+        }
+        _simplify.scan.active = false;
+        const uint16_t farthest_point_index = _simplify.scan.farthest_point_index;
 
         // if the farthest point is more than ACCURACY * 0.5 add two new elements to the _simplification_stack
         // so that on the next iteration we will check between start-to-farthestpoint and farthestpoint-to-end
-        if (max_dist > SMARTRTL_SIMPLIFY_EPSILON) {
-            // if the to-do list is full, give up on simplifying. This should never happen.
-            if (_simplify.stack_count >= _simplify.stack_max) {
+        if (_simplify.scan.max_dist > SMARTRTL_SIMPLIFY_EPSILON) {
+            // if the to-do list does not have room for both new elements, give up on simplifying. This should never happen.
+            if (_simplify.stack_count + 2 > _simplify.stack_max) {
                 _simplify.complete = true;
                 return;
             }
@@ -576,6 +618,12 @@ void AP_SmartRTL::detect_loops()
     // capture start time
     const uint32_t start_time_us = AP_HAL::micros();
 
+    // the segment grid must hold all segments before it can be searched
+    const bool use_grid = (_prune.grid.heads != nullptr) && !_prune.grid.overflow;
+    if (use_grid && !segment_grid_build(start_time_us)) {
+        return;
+    }
+
     // run for defined amount of time
     while (AP_HAL::micros() - start_time_us < SMARTRTL_PRUNING_LOOP_TIME_US) {
 
@@ -594,6 +642,16 @@ void AP_SmartRTL::detect_loops()
             }
         }
 
+        // with the segment grid only nearby segments need to be checked
+        if (use_grid && !_prune.grid.overflow && (_prune.j == 1) && segment_grid_check(_prune.i)) {
+            if (_prune.complete) {
+                return;
+            }
+            // set inner loop forward to trigger outer loop move to next segment
+            _prune.j = _prune.i;
+            continue;
+        }
+
         // find the closest distance between two line segments and the mid-point
         dist_point dp = segment_segment_dist(_path[_prune.i], _path[_prune.i-1], _path[_prune.j-1], _path[_prune.j]);
         if (dp.distance < SMARTRTL_PRUNING_DELTA) {
@@ -608,6 +666,125 @@ void AP_SmartRTL::detect_loops()
     }
 }
 
+// get the range of grid cells covered by the segment ending at end_index
+// the bounding box is expanded by half the pruning distance so that any two segments closer
+// than the pruning distance share at least one cell
+void AP_SmartRTL::segment_grid_cells(uint16_t end_index, grid_cells_t &cells) const
+{
+    const Vector3f &p1 = _path[end_index-1];
+    const Vector3f &p2 = _path[end_index];
+    const float margin = _prune.grid.margin;
+    const float inv_cell_size = 1.0f / _prune.grid.cell_size;
+    cells.x_min = floorf((MIN(p1.x, p2.x) - margin) * inv_cell_size);
+    cells.x_max = floorf((MAX(p1.x, p2.x) + margin) * inv_cell_size);
+    cells.y_min = floorf((MIN(p1.y, p2.y) - margin) * inv_cell_size);
+    cells.y_max = floorf((MAX(p1.y, p2.y) + margin) * inv_cell_size);
+}
+
+// hash a grid cell into a bucket.  num_buckets must be a power of two
+uint16_t AP_SmartRTL::segment_grid_hash(int32_t x, int32_t y, uint16_t num_buckets)
+{
+    return ((uint32_t(x) * 73856093U) ^ (uint32_t(y) * 19349663U)) & (num_buckets - 1);
+}
+
+// add the segment ending at end_index to the segment grid.  returns false if the grid is full
+bool AP_SmartRTL::segment_grid_add(uint16_t end_index)
+{
+    grid_cells_t cells;
+    segment_grid_cells(end_index, cells);
+    const uint32_t num_cells = uint32_t(cells.x_max - cells.x_min + 1) * uint32_t(cells.y_max - cells.y_min + 1);
+
+    // long segments go into their own list
+    if (num_cells > SMARTRTL_PRUNING_GRID_MAX_CELLS) {
+        if (_prune.grid.entries_count >= _prune.grid.entries_max) {
+            return false;
+        }
+        _prune.grid.entries[_prune.grid.entries_count] = {end_index, _prune.grid.long_head};
+        _prune.grid.long_head = _prune.grid.entries_count++;
+        return true;
+    }
+
+    for (int32_t x = cells.x_min; x <= cells.x_max; x++) {
+        for (int32_t y = cells.y_min; y <= cells.y_max; y++) {
+            if (_prune.grid.entries_count >= _prune.grid.entries_max) {
+                return false;
+            }
+            const uint16_t bucket = segment_grid_hash(x, y, _prune.grid.num_buckets);
+            _prune.grid.entries[_prune.grid.entries_count] = {end_index, _prune.grid.heads[bucket]};
+            _prune.grid.heads[bucket] = _prune.grid.entries_count++;
+        }
+    }
+    return true;
+}
+
+// add segments to the segment grid until it holds all segments or the time limit is reached
+// returns true once all segments have been added (or the grid has filled up)
+bool AP_SmartRTL::segment_grid_build(uint32_t start_time_us)
+{
+    while (_prune.grid.segments_added < _prune.path_points_count) {
+        if (AP_HAL::micros() - start_time_us > SMARTRTL_PRUNING_LOOP_TIME_US) {
+            return false;
+        }
+        if (!segment_grid_add(_prune.grid.segments_added)) {
+            // grid is full, fall back to checking every pair of segments
+            _prune.grid.overflow = true;
+            _prune.grid.fallback_count++;
+            log_action(Action::PRUNING_GRID_FULL);
+            return true;
+        }
+        _prune.grid.segments_added++;
+    }
+    return true;
+}
+
+// check the segment ending at end_index against earlier segments found in the grid
+// the loop with the earliest start is added, as the search over all segments would find
+// returns false if the segment is too long for the grid and must be checked against all segments
+bool AP_SmartRTL::segment_grid_check(uint16_t end_index)
+{
+    grid_cells_t cells;
+    segment_grid_cells(end_index, cells);
+    const uint32_t num_cells = uint32_t(cells.x_max - cells.x_min + 1) * uint32_t(cells.y_max - cells.y_min + 1);
+    if (num_cells > SMARTRTL_PRUNING_GRID_MAX_CELLS) {
+        return false;
+    }
+
+    // only segments at least two before this one can form a loop
+    const uint16_t max_j = end_index - 2;
+    uint16_t best_j = SMARTRTL_PRUNING_GRID_NONE;
+    Vector3f best_midpoint;
+
+    // check all segments in a list, recording the earliest that gets close enough
+    auto check_list = [&](uint16_t entry) {
+        for (; entry != SMARTRTL_PRUNING_GRID_NONE; entry = _prune.grid.entries[entry].next) {
+            const uint16_t j = _prune.grid.entries[entry].end_index;
+            if (j > max_j || j >= best_j) {
+                continue;
+            }
+            const dist_point dp = segment_segment_dist(_path[end_index], _path[end_index-1], _path[j-1], _path[j]);
+            if (dp.distance < SMARTRTL_PRUNING_DELTA) {
+                best_j = j;
+                best_midpoint = dp.midpoint;
+            }
+        }
+    };
+
+    for (int32_t x = cells.x_min; x <= cells.x_max; x++) {
+        for (int32_t y = cells.y_min; y <= cells.y_max; y++) {
+            check_list(_prune.grid.heads[segment_grid_hash(x, y, _prune.grid.num_buckets)]);
+        }
+    }
+    check_list(_prune.grid.long_head);
+
+    if (best_j != SMARTRTL_PRUNING_GRID_NONE) {
+        if (!add_loop(best_j, end_index-1, best_midpoint)) {
+            // if the buffer is full, stop trying to prune
+            _prune.complete = true;
+        }
+    }
+    return true;
+}
+
 // restart simplify if new points have been added to path
 // path_points_count is _path_points_count but passed in to avoid having to take the semaphore
 void AP_SmartRTL::restart_simplify_if_new_points(uint16_t path_points_count)
@@ -634,6 +811,7 @@ void AP_SmartRTL::restart_simplification(uint16_t path_points_count)
     _simplify.removal_required = false;
     _simplify.bitmask.setall();
     _simplify.stack_count = 0;
+    _simplify.scan.active = false;
     _simplify.path_points_count = path_points_count;
 }
 
@@ -651,6 +829,17 @@ void AP_SmartRTL::restart_pruning(uint16_t path_points_count)
     _prune.i = (path_points_count > 0) ? path_points_count - 1 : 0;
     _prune.j = 0;
     _prune.path_points_count = path_points_count;
+
+    // the path may have changed so the segment grid is rebuilt
+    if (_prune.grid.heads != nullptr) {
+        memset(_prune.grid.heads, 0xFF, _prune.grid.num_buckets * sizeof(_prune.grid.heads[0]));
+        _prune.grid.entries_count = 0;
+        _prune.grid.long_head = SMARTRTL_PRUNING_GRID_NONE;
+        _prune.grid.segments_added = 1;
+        _prune.grid.cell_size = SMARTRTL_PRUNING_GRID_CELL_SIZE;
+        _prune.grid.margin = SMARTRTL_PRUNING_DELTA * 0.5f;
+        _prune.grid.overflow = false;
+    }
 }
 
 // reset pruning algorithm so that it will re-check all points in the path
@@ -8,7 +8,7 @@
 // definitions and macros
 #define SMARTRTL_ACCURACY_DEFAULT        2.0f   // default _ACCURACY parameter value.  Points will be no closer than this distance (in meters) together.
 #define SMARTRTL_POINTS_DEFAULT          300    // default _POINTS parameter value.  High numbers improve path pruning but use more memory and CPU for cleanup. Memory used will be 20bytes * this number.
-#define SMARTRTL_POINTS_MAX              500    // the absolute maximum number of points this library can support.
+#define SMARTRTL_POINTS_MAX              5000   // the absolute maximum number of points this library can support.
 #define SMARTRTL_TIMEOUT                 15000  // the time in milliseconds with no points saved to the path (for whatever reason), before SmartRTL is disabled for the flight
 #define SMARTRTL_CLEANUP_POINT_TRIGGER   50     // simplification will trigger when this many points are added to the path
 #define SMARTRTL_CLEANUP_START_MARGIN    10     // routine cleanup algorithms begin when the path array has only this many empty slots remaining
@@ -18,9 +18,15 @@
                                                 // The minimum is int((s/2-1)+min(s/2, SMARTRTL_POINTS_MAX-s)), where s = pow(2, floor(log(SMARTRTL_POINTS_MAX)/log(2)))
                                                 // To avoid this annoying math, a good-enough overestimate is ceil(SMARTRTL_POINTS_MAX*2.0f/3.0f)
 #define SMARTRTL_SIMPLIFY_TIME_US        200    // maximum time (in microseconds) the simplification algorithm will run before returning
+#define SMARTRTL_SIMPLIFY_POINTS_PER_CHECK 32   // number of points the simplification algorithm checks between checks of the time limit
 #define SMARTRTL_PRUNING_DELTA (_accuracy * 0.99)   // How many meters apart must two points be, such that we can assume that there is no obstacle between them.  must be smaller than _ACCURACY parameter
 #define SMARTRTL_PRUNING_LOOP_BUFFER_LEN_MULT 0.25f // pruning loop buffer size as compared to maximum number of points
 #define SMARTRTL_PRUNING_LOOP_TIME_US    200    // maximum time (in microseconds) that the loop finding algorithm will run before returning
+#define SMARTRTL_PRUNING_GRID_MIN_POINTS 500    // the segment grid is only used for loop detection when the path can hold more than this many points
+#define SMARTRTL_PRUNING_GRID_CELL_SIZE (_accuracy * 4.0f)  // size (in meters) of the cells of the segment grid used for loop detection
+#define SMARTRTL_PRUNING_GRID_MAX_CELLS  4      // segments covering more than this many grid cells are kept in a separate list and checked against every segment
+#define SMARTRTL_PRUNING_GRID_ENTRIES_MULT 2    // segment grid entries as compared to maximum number of points
+#define SMARTRTL_PRUNING_GRID_NONE       0xFFFF // end of list marker for the segment grid
 
 class AP_SmartRTL {
 
@@ -38,6 +44,13 @@ public:
     // returns number of points on the path
     uint16_t get_num_points() const;
 
+    // returns the number of times the segment grid filled up and loop detection fell back to checking every pair of segments
+    uint32_t get_pruning_grid_fallbacks() const { return _prune.grid.fallback_count; }
+
+    // do not use the segment grid for loop detection.  Used by the example sketch to compare the
+    // grid against the pairwise search.  Must be called before init()
+    void disable_pruning_grid() { _prune.grid.disabled = true; }
+
     // get a point on the path
     const Vector3f& get_point(uint16_t index) const { return _path[index]; }
 
@@ -104,6 +117,7 @@ private:
         DEACTIVATED_BAD_POSITION_TIMEOUT = 9,
         DEACTIVATED_PATH_FULL_TIMEOUT = 10,
         DEACTIVATED_PROGRAM_ERROR = 11,
+        PRUNING_GRID_FULL = 12,
     };
 
     // enum for SRTL_OPTIONS parameter
@@ -155,6 +169,26 @@ private:
     // returns false if it failed to remove points (because it could not take semaphore)
     bool remove_points_by_loops(uint16_t num_points_to_remove);
 
+    // segment grid used to find loops without comparing every pair of segments
+    // cell range of a segment's bounding box, expanded by half the pruning distance
+    typedef struct {
+        int32_t x_min, x_max;
+        int32_t y_min, y_max;
+    } grid_cells_t;
+    void segment_grid_cells(uint16_t end_index, grid_cells_t &cells) const;
+    static uint16_t segment_grid_hash(int32_t x, int32_t y, uint16_t num_buckets);
+
+    // add the segment ending at end_index to the segment grid.  returns false if the grid is full
+    bool segment_grid_add(uint16_t end_index);
+
+    // add segments to the segment grid until it holds all segments or the time limit is reached
+    // returns true once all segments have been added
+    bool segment_grid_build(uint32_t start_time_us);
+
+    // check the segment ending at end_index against earlier segments found in the grid
+    // returns false if the segment is too long for the grid and must be checked against all segments
+    bool segment_grid_check(uint16_t end_index);
+
     // add loop to loops array
     //  returns true if loop added successfully, false on failure (because loop array is full)
     //  checks if loop overlaps with an existing loop, keeps only the longer loop
@@ -218,6 +252,14 @@ private:
         uint16_t stack_max;     // maximum number of elements in the _simplify_stack array
         uint16_t stack_count;   // number of elements in _simplify_stack array
         Bitmask<SMARTRTL_POINTS_MAX> bitmask;  // simplify algorithm clears bits for each point that can be removed
+        struct {
+            bool active;        // true if a start-finish segment is part way through being checked
+            uint16_t start;     // start and finish of the segment being checked
+            uint16_t finish;
+            uint16_t index;     // next point to check
+            uint16_t farthest_point_index;  // farthest point from the segment found so far
+            float max_dist;     // distance of farthest point from the segment
+        } scan;                 // allows the search for the farthest point to be split across calls
     } _simplify;
 
     // Pruning
@@ -236,6 +278,23 @@ private:
         prune_loop_t* loops;// the result of the pruning algorithm
         uint16_t loops_max; // maximum number of elements in the _prunable_loops array
         uint16_t loops_count;   // number of elements in the _prunable_loops array
+        struct {
+            uint16_t* heads;        // hash buckets of cells, each the index of the first entry or SMARTRTL_PRUNING_GRID_NONE. nullptr if the grid is not used
+            uint16_t num_buckets;   // number of hash buckets, a power of two
+            struct entry_t {
+                uint16_t end_index; // index of the last point of the segment
+                uint16_t next;      // next entry in the same bucket
+            } *entries;
+            uint16_t entries_max;   // maximum number of elements in the entries array
+            uint16_t entries_count; // number of elements in the entries array
+            uint16_t long_head;     // list of segments covering too many cells to add to the buckets
+            uint16_t segments_added;// segments up to this end index have been added to the grid
+            float cell_size;        // cell size in meters, captured when the grid is reset
+            float margin;           // distance in meters segment bounding boxes are expanded by, captured when the grid is reset
+            bool overflow;          // true if the entries array filled up, every segment is checked against every segment
+            bool disabled;          // true if the grid should not be allocated (see disable_pruning_grid)
+            uint32_t fallback_count;// number of times the entries array filled up
+        } grid;
     } _prune;
 
     // returns true if the two loops overlap (used within add_loop to determine which loops to keep or throw away)
@@ -27,18 +27,33 @@ static DummyVehicle vehicle;
 
 AP_AHRS &ahrs(vehicle.ahrs);
 AP_SmartRTL smart_rtl{true};
+AP_SmartRTL smart_rtl_large{true};
+AP_SmartRTL smart_rtl_pairwise{true};
 AP_BoardConfig board_config;
 
 void setup();
 void loop();
 void reset();
 void check_path(const std::vector<Vector3p> &correct_path, const char* test_name, uint32_t time_us);
+void reset_large_path(AP_SmartRTL &srtl);
+bool cleanup_large_path(AP_SmartRTL &srtl, const char *test_name);
+void test_large_path();
 
 void setup()
 {
     hal.console->printf("SmartRTL test\n");
     board_config.init();
     smart_rtl.init();
+
+    // large path objects use the maximum number of points, one with the segment grid
+    // and one using the pairwise search the grid results are checked against
+    if (!AP_Param::set_object_value(&smart_rtl_large, AP_SmartRTL::var_info, "POINTS", SMARTRTL_POINTS_MAX) ||
+        !AP_Param::set_object_value(&smart_rtl_pairwise, AP_SmartRTL::var_info, "POINTS", SMARTRTL_POINTS_MAX)) {
+        hal.console->printf("failed to set SRTL_POINTS\n");
+    }
+    smart_rtl_large.init();
+    smart_rtl_pairwise.disable_pruning_grid();
+    smart_rtl_pairwise.init();
 }
 
 void loop()
@@ -76,6 +91,10 @@ void loop()
     run_time = AP_HAL::micros() - reference_time;
     check_path(test_path_complete, "simplify and pruning", run_time);
 
+    // test cleanup time on a long path
+    hal.scheduler->delay(5);
+    test_large_path();
+
     // delay before next display
     hal.scheduler->delay(5e3); // 5 seconds
 }
@@ -89,6 +108,88 @@ void reset()
     }
 }
 
+// reset path (i.e. clear path and add home) and upload a long survey path that crosses itself many times
+void reset_large_path(AP_SmartRTL &srtl)
+{
+    srtl.set_home(true, Vector3p{0.0f, 0.0f, 0.0f});
+
+    // north-south survey lines 5m apart with a small zigzag so points are not simplified away
+    const uint16_t num_lines = 40;
+    const float line_length = 200.0f;
+    for (uint16_t line = 0; line < num_lines; line++) {
+        const float y = line * 5.0f;
+        for (float d = 0; d <= line_length; d += 3.0f) {
+            const float x = (line % 2 == 0) ? d : line_length - d;
+            const float zigzag = ((uint32_t)(d / 3.0f) % 2 == 0) ? 1.5f : -1.5f;
+            srtl.update(true, Vector3p{x, y + zigzag, 0.0f});
+        }
+    }
+    // east-west lines back across the survey area
+    for (uint16_t line = 0; line < 10; line++) {
+        const float x = line_length - line * 20.0f;
+        for (float d = 0; d <= num_lines * 5.0f; d += 3.0f) {
+            const float y = (line % 2 == 0) ? num_lines * 5.0f - d : d;
+            const float zigzag = ((uint32_t)(d / 3.0f) % 2 == 0) ? 1.5f : -1.5f;
+            srtl.update(true, Vector3p{x + zigzag, y, 0.0f});
+        }
+    }
+}
+
+// time the cleanup of the long path
+// each call to run_background_cleanup should stay close to the SMARTRTL_SIMPLIFY_TIME_US and
+// SMARTRTL_PRUNING_LOOP_TIME_US limits regardless of the number of points
+bool cleanup_large_path(AP_SmartRTL &srtl, const char *test_name)
+{
+    reset_large_path(srtl);
+    const uint16_t points_before = srtl.get_num_points();
+
+    uint32_t max_call_us = 0;
+    uint32_t num_calls = 0;
+    const uint32_t reference_time = AP_HAL::micros();
+    while (!srtl.request_thorough_cleanup(AP_SmartRTL::THOROUGH_CLEAN_ALL)) {
+        const uint32_t call_start_us = AP_HAL::micros();
+        srtl.run_background_cleanup();
+        max_call_us = MAX(max_call_us, AP_HAL::micros() - call_start_us);
+        num_calls++;
+    }
+    const uint32_t run_time = AP_HAL::micros() - reference_time;
+
+    hal.console->printf("%s: %s time:%u us calls:%u max call:%u us\n",
+                        test_name,
+                        srtl.is_active() ? "success" : "fail",
+                        (unsigned)run_time, (unsigned)num_calls, (unsigned)max_call_us);
+    hal.console->printf("   points before %u, after %u, grid fallbacks %u\n",
+                        (unsigned)points_before, (unsigned)srtl.get_num_points(),
+                        (unsigned)srtl.get_pruning_grid_fallbacks());
+    return srtl.is_active();
+}
+
+// clean up the long path with and without the segment grid and check both leave the same points
+void test_large_path()
+{
+    if (!cleanup_large_path(smart_rtl_large, "large path cleanup") ||
+        !cleanup_large_path(smart_rtl_pairwise, "large path pairwise cleanup")) {
+        return;
+    }
+
+    bool points_match = smart_rtl_large.get_num_points() == smart_rtl_pairwise.get_num_points();
+    const uint16_t points_to_compare = MIN(smart_rtl_large.get_num_points(), smart_rtl_pairwise.get_num_points());
+    uint16_t failure_index = 0;
+    for (uint16_t i = 0; i < points_to_compare && points_match; i++) {
+        if (smart_rtl_large.get_point(i) != smart_rtl_pairwise.get_point(i)) {
+            failure_index = i;
+            points_match = false;
+        }
+    }
+    hal.console->printf("large path grid matches pairwise: %s\n", points_match ? "success" : "fail");
+    if (!points_match) {
+        hal.console->printf("   grid %u points, pairwise %u points, first difference at point %u\n",
+                            (unsigned)smart_rtl_large.get_num_points(),
+                            (unsigned)smart_rtl_pairwise.get_num_points(),
+                            (unsigned)failure_index);
+    }
+}
+
 // compare the vector array passed in with the path held in the smart_rtl object
 void check_path(const std::vector<Vector3p>& correct_path, const char* test_name, uint32_t time_us)
 {
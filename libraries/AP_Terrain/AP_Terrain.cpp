@@ -27,6 +27,7 @@
 #include <AP_Vehicle/AP_Vehicle_Type.h>
 #include <AP_Filesystem/AP_Filesystem.h>
 #include <AP_Rally/AP_Rally.h>
+#include <AP_Mission/AP_Mission.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -58,7 +59,7 @@ const AP_Param::GroupInfo AP_Terrain::var_info[] = {
     // @Param: OPTIONS
     // @DisplayName: Terrain options
     // @Description: Options to change behaviour of terrain system
-    // @Bitmask: 0:Disable Download,1:Disable Disk
+    // @Bitmask: 0:Disable Download,1:Disable Disk,2:Disable Prefetch
     // @User: Advanced
     AP_GROUPINFO("OPTIONS",   2, AP_Terrain, options, 0),
 
@@ -80,7 +81,7 @@ const AP_Param::GroupInfo AP_Terrain::var_info[] = {
 
     // @Param: CACHE_SZ
     // @DisplayName: Terrain cache size
-    // @Description: The number of 32x28 cache blocks to keep in memory. Each block uses about 1800 bytes of memory
+    // @Description: The number of 32x28 cache blocks to keep in memory. Each block uses about 1800 bytes of memory. Blocks beyond the first 10 are used to prefetch terrain ahead of the vehicle, and each of them allows another disk read to be queued on boards with enough memory
     // @Range: 0 128
     // @User: Advanced
     AP_GROUPINFO("CACHE_SZ",  5, AP_Terrain, config_cache_size, TERRAIN_GRID_BLOCK_CACHE_SIZE),
@@ -90,7 +91,6 @@ const AP_Param::GroupInfo AP_Terrain::var_info[] = {
 
 // constructor
 AP_Terrain::AP_Terrain() :
-    disk_io_state(DiskIoIdle),
     fd(-1)
 {
     AP_Param::setup_object_defaults(this, var_info);
@@ -137,6 +137,32 @@ bool AP_Terrain::height_amsl(const Location &loc, float &height, bool corrected)
     // find the grid
     const struct grid_block &grid = find_grid_cache(info).grid;
 
+    if (!interpolate_height(grid, info, height)) {
+        return false;
+    }
+
+    if (loc.lat == ahrs.get_home().lat &&
+        loc.lng == ahrs.get_home().lng) {
+        // remember home altitude as a special case
+        home_height = height;
+        home_loc = loc;
+        have_home_height = true;
+    }
+
+    if (corrected && have_reference_offset) {
+        height += reference_offset;
+    }
+    
+    return true;
+}
+
+
+/*
+  interpolate the height at a grid_info within a grid block. Return
+  false if the block does not have all 4 surrounding heights
+ */
+bool AP_Terrain::interpolate_height(const struct grid_block &grid, const struct grid_info &info, float &height)
+{
     /*
       note that we rely on the one square overlap to ensure these
       calculations don't go past the end of the arrays
@@ -168,21 +194,106 @@ bool AP_Terrain::height_amsl(const Location &loc, float &height, bool corrected)
 
     height = avg;
 
-    if (loc.lat == ahrs.get_home().lat &&
-        loc.lng == ahrs.get_home().lng) {
-        // remember home altitude as a special case
-        home_height = height;
-        home_loc = loc;
-        have_home_height = true;
+    return true;
+}
+
+/*
+  return terrain height in meters above average sea level for an
+  array of locations.
+
+  The grid_info for each location is calculated first, then each grid
+  block referenced is found in the cache once and used for all of the
+  locations that fall within it. Locations are processed in batches of
+  TERRAIN_BATCH_SIZE to bound stack usage.
+
+  Only as many blocks as the cache has spare beyond the vehicle's own
+  surrounding and home blocks are claimed for blocks that aren't
+  already cached, so a large query can't evict the blocks we are
+  flying over. Locations in blocks beyond that are left unavailable
+  for the caller to ask for again later.
+
+  Returns the number of locations for which the height is available
+ */
+uint16_t AP_Terrain::height_amsl(const Location *locs, float *heights, bool *available, uint16_t count, bool corrected)
+{
+    if (available != nullptr) {
+        memset(available, 0, count * sizeof(available[0]));
+    }
+    if (!allocate()) {
+        return 0;
     }
 
-    if (corrected && have_reference_offset) {
-        height += reference_offset;
+    const float offset = (corrected && have_reference_offset) ? reference_offset : 0;
+    const Location &home = AP::ahrs().get_home();
+    const uint8_t max_new_blocks = MAX(cache_size - 10, 1);
+    uint8_t new_blocks = 0;
+    uint16_t found = 0;
+
+    for (uint32_t base=0; base<count; base += TERRAIN_BATCH_SIZE) {
+        const uint8_t n = MIN(count - base, uint32_t(TERRAIN_BATCH_SIZE));
+        struct grid_info info[TERRAIN_BATCH_SIZE];
+        bool done[TERRAIN_BATCH_SIZE];
+
+        for (uint8_t i=0; i<n; i++) {
+            const Location &loc = locs[base+i];
+            done[i] = false;
+            if (have_home_height &&
+                loc.lat == home_loc.lat &&
+                loc.lng == home_loc.lng) {
+                // quick access for home altitude
+                heights[base+i] = home_height + offset;
+                if (available != nullptr) {
+                    available[base+i] = true;
+                }
+                found++;
+                done[i] = true;
+                continue;
+            }
+            calculate_grid_info(loc, info[i]);
+        }
+
+        // visit each grid block once, handling all locations within it
+        for (uint8_t i=0; i<n; i++) {
+            if (done[i]) {
+                continue;
+            }
+            bool claim = true;
+            if (!grid_cached(info[i])) {
+                claim = new_blocks < max_new_blocks;
+                if (claim) {
+                    new_blocks++;
+                }
+            }
+            const struct grid_block *grid = claim ? &find_grid_cache(info[i]).grid : nullptr;
+            for (uint8_t j=i; j<n; j++) {
+                if (done[j] ||
+                    info[j].grid_lat != info[i].grid_lat ||
+                    info[j].grid_lon != info[i].grid_lon) {
+                    continue;
+                }
+                done[j] = true;
+                float height;
+                if (grid == nullptr || !interpolate_height(*grid, info[j], height)) {
+                    continue;
+                }
+                const Location &loc = locs[base+j];
+                if (loc.lat == home.lat && loc.lng == home.lng) {
+                    // remember home altitude as a special case
+                    home_height = height;
+                    home_loc = loc;
+                    have_home_height = true;
+                }
+                heights[base+j] = height + offset;
+                if (available != nullptr) {
+                    available[base+j] = true;
+                }
+                found++;
+            }
+        }
     }
-    
-    return true;
-}
 
+    return found;
+}
 
 /* 
    find difference between home terrain height and the terrain
@@ -335,16 +446,25 @@ float AP_Terrain::lookahead(float bearing, float distance, float climb_ratio)
     float climb = 0;
     float lookahead_estimate = 0;
 
-    // check for terrain at grid spacing intervals
+    // check for terrain at grid spacing intervals, a batch at a time
+    Location locs[TERRAIN_BATCH_SIZE];
+    float heights[TERRAIN_BATCH_SIZE];
+    bool available[TERRAIN_BATCH_SIZE];
     while (distance > 0) {
-        loc.offset_bearing(bearing, grid_spacing);
-        climb += climb_ratio * grid_spacing;
-        distance -= grid_spacing;
-        float height;
-        if (height_amsl(loc, height)) {
-            float rise = (height - base_height) - climb;
-            if (rise > lookahead_estimate) {
-                lookahead_estimate = rise;
+        uint8_t n = 0;
+        while (n < TERRAIN_BATCH_SIZE && distance > 0) {
+            loc.offset_bearing(bearing, grid_spacing);
+            distance -= grid_spacing;
+            locs[n++] = loc;
+        }
+        height_amsl(locs, heights, available, n);
+        for (uint8_t i=0; i<n; i++) {
+            climb += climb_ratio * grid_spacing;
+            if (available[i]) {
+                float rise = (heights[i] - base_height) - climb;
+                if (rise > lookahead_estimate) {
+                    lookahead_estimate = rise;
+                }
             }
         }
     }
@@ -397,6 +517,11 @@ void AP_Terrain::update(void)
         have_surrounding_tiles = false;
     }
 
+    // load blocks we are about to fly into before they are needed
+    if (pos_valid) {
+        update_prefetch(loc);
+    }
+
     // update capabilities and status
     if (allocate()) {
         if (!pos_valid) {
@@ -431,6 +556,77 @@ bool AP_Terrain::update_surrounding_tiles(const Location &loc)
     return ret;
 }
 
+/*
+  prefetch grid blocks along the groundspeed vector and the current
+  mission leg. Blocks not yet in the cache are queued for disk read
+  (or GCS download if they are not on disk) so that fast vehicles do
+  not outrun the terrain data.
+ */
+void AP_Terrain::update_prefetch(const Location &loc)
+{
+    if ((options.get() & uint16_t(Options::DisablePrefetch)) || grid_spacing <= 0) {
+        return;
+    }
+
+    // leave room in the LRU cache for the 3x3 surrounding grids and
+    // home, so prefetching never evicts the blocks we are using
+    if (cache_size <= 10) {
+        return;
+    }
+    uint8_t max_blocks = cache_size - 10;
+
+    // the surrounding tiles already cover 0.7 of a block in each
+    // direction, so start prefetching beyond that
+    const float start_m = 1.4f * TERRAIN_GRID_BLOCK_SPACING_X * grid_spacing;
+
+    const Vector2f &gnd_vel = AP::ahrs().groundspeed_vector();
+    const float speed = gnd_vel.length();
+    if (speed >= TERRAIN_PREFETCH_MIN_SPEED) {
+        const float bearing = wrap_360(degrees(atan2f(gnd_vel.y, gnd_vel.x)));
+        max_blocks -= prefetch_path(loc, bearing, start_m, start_m + speed * TERRAIN_PREFETCH_TIME_S, max_blocks);
+    }
+
+#if AP_MISSION_ENABLED
+    const AP_Mission *mission = AP::mission();
+    if (max_blocks == 0 ||
+        mission == nullptr ||
+        mission->state() != AP_Mission::MISSION_RUNNING) {
+        return;
+    }
+    const Location &target = mission->get_current_nav_cmd().content.location;
+    if (target.lat == 0 && target.lng == 0) {
+        return;
+    }
+    prefetch_path(loc, degrees(loc.get_bearing(target)), start_m, loc.get_distance(target), max_blocks);
+#endif
+}
+
+/*
+  prefetch the grid blocks along a path between start_m and end_m
+  meters from loc. Returns the number of distinct blocks touched
+ */
+uint8_t AP_Terrain::prefetch_path(const Location &loc, float bearing, float start_m, float end_m, uint8_t max_blocks)
+{
+    // step in half the smaller block dimension so we can't skip a block
+    const float step = 0.5f * TERRAIN_GRID_BLOCK_SPACING_X * grid_spacing;
+    uint8_t count = 0;
+    int32_t last_lat = 0, last_lon = 0;
+    for (float d = start_m; d < end_m && count < max_blocks; d += step) {
+        Location loc2 = loc;
+        loc2.offset_bearing(bearing, d);
+        struct grid_info info;
+        calculate_grid_info(loc2, info);
+        if (count != 0 && info.grid_lat == last_lat && info.grid_lon == last_lon) {
+            continue;
+        }
+        find_grid_cache(info);
+        last_lat = info.grid_lat;
+        last_lon = info.grid_lon;
+        count++;
+    }
+    return count;
+}
+
 bool AP_Terrain::pre_arm_checks(char *failure_msg, uint8_t failure_msg_len) const
 {
     // check no outstanding requests for data:
@@ -485,6 +681,25 @@ void AP_Terrain::log_terrain_data()
         reference_offset : have_reference_offset?reference_offset:0,
     };
     AP::logger().WriteBlock(&pkt, sizeof(pkt));
+
+    uint8_t io_queued = 0;
+    for (uint8_t i=0; i<disk_io_count; i++) {
+        if (disk_io[i].state != DiskIoIdle) {
+            io_queued++;
+        }
+    }
+    struct log_TERRAIN_CACHE pkt2 = {
+        LOG_PACKET_HEADER_INIT(LOG_TERRAIN_CACHE_MSG),
+        time_us        : pkt.time_us,
+        cache_hits     : stats.cache_hits,
+        cache_misses   : stats.cache_misses,
+        io_queued      : io_queued,
+        io_latency_us  : stats.io_latency_max_us,
+    };
+    AP::logger().WriteBlock(&pkt2, sizeof(pkt2));
+
+    // statistics are per log message
+    stats = {};
 }
 #endif
 
@@ -506,6 +721,18 @@ bool AP_Terrain::allocate(void)
         memory_alloc_failed = true;
         return false;
     }
+    // one IO slot, plus one for each block the cache can spare for
+    // prefetch. A deeper queue would have nothing to read
+    const uint8_t io_count = constrain_int16(config_cache_size - 9, 1, TERRAIN_DISK_IO_QUEUE_SIZE);
+    disk_io = (struct disk_io_slot *)calloc(io_count, sizeof(disk_io[0]));
+    if (disk_io == nullptr) {
+        free(cache);
+        cache = nullptr;
+        GCS_SEND_TEXT(MAV_SEVERITY_CRITICAL, "Terrain: Allocation failed");
+        memory_alloc_failed = true;
+        return false;
+    }
+    disk_io_count = io_count;
     cache_size = config_cache_size;
     return true;
 }
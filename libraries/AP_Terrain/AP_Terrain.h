@@ -50,6 +50,40 @@
 #define TERRAIN_GRID_BLOCK_CACHE_SIZE 12
 #endif
 
+// maximum number of grid_blocks that can be queued for disk IO at
+// once. Each queue entry costs a 2k IO buffer, and only as many are
+// allocated as the cache has blocks to spare for prefetch
+#ifndef TERRAIN_DISK_IO_QUEUE_SIZE
+#if HAL_MEM_CLASS >= HAL_MEM_CLASS_1000
+#define TERRAIN_DISK_IO_QUEUE_SIZE 4
+#else
+#define TERRAIN_DISK_IO_QUEUE_SIZE 1
+#endif
+#endif
+
+// how far beyond the surrounding grid blocks (in seconds at the
+// current groundspeed) to prefetch grid blocks
+#ifndef TERRAIN_PREFETCH_TIME_S
+#define TERRAIN_PREFETCH_TIME_S 60
+#endif
+
+// number of locations processed at once by the bulk height lookup
+#define TERRAIN_BATCH_SIZE 16
+
+// minimum groundspeed in m/s for velocity based prefetch
+#define TERRAIN_PREFETCH_MIN_SPEED 2
+
+// number of degree files that can be memory mapped at once
+#ifndef TERRAIN_MMAP_MAX_FILES
+#define TERRAIN_MMAP_MAX_FILES 4
+#endif
+
+// degree files are mapped this many blocks past their end, so a file
+// that grows while terrain is downloading isn't remapped on every read
+#ifndef TERRAIN_MMAP_GROW_BLOCKS
+#define TERRAIN_MMAP_GROW_BLOCKS 256
+#endif
+
 // format of grid on disk
 #define TERRAIN_GRID_FORMAT_VERSION 1
 
@@ -82,6 +116,9 @@ public:
     /* Do not allow copies */
     CLASS_NO_COPY(AP_Terrain);
 
+    // allow the IO benchmark to call the disk IO functions
+    friend class AP_Terrain_Benchmark;
+
     static AP_Terrain *get_singleton(void) { return singleton; }
 
     enum TerrainStatus {
@@ -125,6 +162,21 @@ public:
      */
     bool height_amsl(const Location &loc, float &height, bool corrected = true);
 
+    /*
+      find the terrain height in meters above sea level for an array
+      of locations. Points are grouped by grid block so each block is
+      looked up in the cache once, however the locations are ordered.
+
+      available[i] is set to whether heights[i] is valid. available
+      may be nullptr if the caller only needs the count. Only a few
+      blocks that aren't already cached are loaded per call, so
+      callers with many locations should call again until all are
+      available.
+
+      returns the number of locations with a height available
+     */
+    uint16_t height_amsl(const Location *locs, float *heights, bool *available, uint16_t count, bool corrected = true);
+
     /* 
        find difference between home terrain height and the terrain
        height at the current location in meters. A positive result
@@ -301,11 +353,17 @@ private:
     // given a location, fill a grid_info structure
     void calculate_grid_info(const Location &loc, struct grid_info &info) const;
 
+    // interpolate the height at a grid_info within a grid block
+    bool interpolate_height(const struct grid_block &grid, const struct grid_info &info, float &height);
+
     /*
       find a grid structure given a grid_info
     */
     struct grid_cache &find_grid_cache(const struct grid_info &info);
 
+    // return true if the grid block for a grid_info is in the cache
+    bool grid_cached(const struct grid_info &info) const;
+
     /*
       calculate bit number in grid_block bitmap. This corresponds to a
       bit representing a 4x4 mavlink transmitted block
@@ -339,20 +397,41 @@ private:
     /*
       disk IO functions
      */
-    int16_t find_io_idx(enum GridCacheState state);
+    struct disk_io_slot;
+    int16_t find_io_idx(const struct grid_block &block, enum GridCacheState state);
     uint16_t get_block_crc(struct grid_block &block);
-    void check_disk_read(void);
-    void check_disk_write(void);
+    bool io_queued(const struct grid_block &block) const;
+    bool check_disk_read(struct disk_io_slot &io);
+    bool check_disk_write(struct disk_io_slot &io);
     void io_timer(void);
-    void open_file(void);
-    void seek_offset(void);
-    uint32_t east_blocks(struct grid_block &block) const;
-    void write_block(void);
-    void read_block(void);
+    void open_file(const struct grid_block &block);
+    uint32_t block_file_offset(const struct grid_block &block) const;
+    void seek_offset(const struct grid_block &block);
+    uint32_t east_blocks(const struct grid_block &block) const;
+    void write_block(struct disk_io_slot &io);
+    void read_block(struct disk_io_slot &io);
+
+#if AP_TERRAIN_MMAP_ENABLED
+    /*
+      memory mapped disk access functions
+     */
+    struct mmap_file;
+    struct mmap_file *mmap_find(int8_t lat_degrees, int16_t lon_degrees);
+    void mmap_update(const struct grid_block &block);
+    bool mmap_read_block(struct grid_block &block);
+    void mmap_block_written(const struct grid_block &block);
+#endif
 
     // check for missing data in squares surrounding loc:
     bool update_surrounding_tiles(const Location &loc);
 
+    /*
+      prefetch grid blocks ahead of the vehicle, along the current
+      groundspeed vector and the current mission leg
+     */
+    void update_prefetch(const Location &loc);
+    uint8_t prefetch_path(const Location &loc, float bearing, float start_m, float end_m, uint8_t max_blocks);
+
     /*
       check for missing mission terrain data
      */
@@ -380,6 +459,7 @@ private:
     enum class Options {
         DisableDownload = (1U<<0),
         DisableDisk = (1U<<1),
+        DisablePrefetch = (1U<<2),
     };
 
     inline bool diskless() const {
@@ -398,8 +478,58 @@ private:
         DiskIoDoneRead  = 3,
         DiskIoDoneWrite = 4
     };
-    volatile enum DiskIoState disk_io_state;
-    union grid_io_block disk_block;
+
+    /*
+      a queue entry for disk IO. Each entry has its own state, so
+      several blocks can be in flight in the IO thread at once
+     */
+    struct disk_io_slot {
+        volatile enum DiskIoState state;
+        // time the IO was queued, for latency statistics
+        uint32_t queued_us;
+        // corner of the queued block. Only used by the main thread,
+        // which can't look at disk_block while the IO thread owns it
+        int32_t lat;
+        int32_t lon;
+        union grid_io_block disk_block;
+    };
+    struct disk_io_slot *disk_io;
+    uint8_t disk_io_count;
+
+#if AP_TERRAIN_MMAP_ENABLED
+    // state of a block in a mapped file. The CRC is checked once, on
+    // first use, and again after the block is written
+    enum MmapBlockState : uint8_t {
+        MmapBlockUnchecked = 0,
+        MmapBlockValid     = 1,
+        MmapBlockInvalid   = 2,
+    };
+
+    /*
+      a memory mapped degree file. Files are mapped by the IO thread
+      and read by the main thread, both holding mmap_sem
+     */
+    struct mmap_file {
+        const uint8_t *data;
+        // bytes of the file that can be read, and bytes mapped
+        uint32_t size;
+        uint32_t capacity;
+        enum MmapBlockState *block_state;
+        uint32_t last_use_ms;
+        uint16_t spacing;
+        int16_t lon_degrees;
+        int8_t lat_degrees;
+    } mmap_files[TERRAIN_MMAP_MAX_FILES];
+    HAL_Semaphore mmap_sem;
+#endif
+
+    // cache and IO statistics, reset on each TERR log message. The
+    // counters saturate so they can't wrap when logging is disabled
+    struct {
+        uint16_t cache_hits;
+        uint16_t cache_misses;
+        uint32_t io_latency_max_us;
+    } stats;
 
 #if HAL_GCS_ENABLED
     // last time we asked for more grids
@@ -452,9 +582,6 @@ private:
     // next mission command to check
     uint16_t next_mission_index;
 
-    // next mission position to check
-    uint8_t next_mission_pos;
-
     // last time the mission changed
     uint32_t last_mission_change_ms;
 
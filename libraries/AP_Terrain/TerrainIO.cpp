@@ -28,32 +28,56 @@
 
 extern const AP_HAL::HAL& hal;
 
+/*
+  return true if a block is already queued for disk IO
+ */
+bool AP_Terrain::io_queued(const struct grid_block &block) const
+{
+    for (uint8_t i=0; i<disk_io_count; i++) {
+        const auto &io = disk_io[i];
+        if (io.state != DiskIoIdle &&
+            TERRAIN_LATLON_EQUAL(io.lat, block.lat) &&
+            TERRAIN_LATLON_EQUAL(io.lon, block.lon)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /*
   check for blocks that need to be read from disk
  */
-void AP_Terrain::check_disk_read(void)
+bool AP_Terrain::check_disk_read(struct disk_io_slot &io)
 {
     for (uint16_t i=0; i<cache_size; i++) {
-        if (cache[i].state == GRID_CACHE_DISKWAIT) {
-            disk_block.block = cache[i].grid;
-            disk_io_state = DiskIoWaitRead;
-            return;
+        if (cache[i].state == GRID_CACHE_DISKWAIT && !io_queued(cache[i].grid)) {
+            io.disk_block.block = cache[i].grid;
+            io.lat = cache[i].grid.lat;
+            io.lon = cache[i].grid.lon;
+            io.queued_us = AP_HAL::micros();
+            io.state = DiskIoWaitRead;
+            return true;
         }
-    }    
+    }
+    return false;
 }
 
 /*
   check for blocks that need to be written to disk
  */
-void AP_Terrain::check_disk_write(void)
+bool AP_Terrain::check_disk_write(struct disk_io_slot &io)
 {
     for (uint16_t i=0; i<cache_size; i++) {
-        if (cache[i].state == GRID_CACHE_DIRTY) {
-            disk_block.block = cache[i].grid;
-            disk_io_state = DiskIoWaitWrite;
-            return;
+        if (cache[i].state == GRID_CACHE_DIRTY && !io_queued(cache[i].grid)) {
+            io.disk_block.block = cache[i].grid;
+            io.lat = cache[i].grid.lat;
+            io.lon = cache[i].grid.lon;
+            io.queued_us = AP_HAL::micros();
+            io.state = DiskIoWaitWrite;
+            return true;
         }
-    }    
+    }
+    return false;
 }
 
 /*
@@ -70,48 +94,50 @@ void AP_Terrain::schedule_disk_io(void)
         hal.scheduler->register_io_process(FUNCTOR_BIND_MEMBER(&AP_Terrain::io_timer, void));
     }
 
-    switch (disk_io_state) {
-    case DiskIoIdle:
-        // look for a block that needs reading or writing
-        check_disk_read();
-        if (disk_io_state == DiskIoIdle) {
-            // still idle, check for writes
-            check_disk_write();            
-        }
-        break;
-        
-    case DiskIoDoneRead: {
-        // a read has completed
-        int16_t cache_idx = find_io_idx(GRID_CACHE_DISKWAIT);
-        if (cache_idx != -1) {
-            if (disk_block.block.bitmap != 0) {
-                // when bitmap is zero we read an empty block
-                cache[cache_idx].grid = disk_block.block;
+    for (uint8_t i=0; i<disk_io_count; i++) {
+        auto &io = disk_io[i];
+        switch (io.state) {
+        case DiskIoIdle:
+            // look for a block that needs reading, then for writes
+            if (!check_disk_read(io)) {
+                check_disk_write(io);
+            }
+            break;
+
+        case DiskIoDoneRead: {
+            // a read has completed
+            int16_t cache_idx = find_io_idx(io.disk_block.block, GRID_CACHE_DISKWAIT);
+            if (cache_idx != -1) {
+                if (io.disk_block.block.bitmap != 0) {
+                    // when bitmap is zero we read an empty block
+                    cache[cache_idx].grid = io.disk_block.block;
+                }
+                cache[cache_idx].state = GRID_CACHE_VALID;
+                cache[cache_idx].last_access_ms = AP_HAL::millis();
             }
-            cache[cache_idx].state = GRID_CACHE_VALID;
-            cache[cache_idx].last_access_ms = AP_HAL::millis();
+            stats.io_latency_max_us = MAX(stats.io_latency_max_us, AP_HAL::micros() - io.queued_us);
+            io.state = DiskIoIdle;
+            break;
         }
-        disk_io_state = DiskIoIdle;
-        break;
-    }
 
-    case DiskIoDoneWrite: {
-        // a write has completed
-        int16_t cache_idx = find_io_idx(GRID_CACHE_DIRTY);
-        if (cache_idx != -1) {
-            if (cache[cache_idx].grid.bitmap == disk_block.block.bitmap) {
-                // only mark valid if more grids haven't been added
-                cache[cache_idx].state = GRID_CACHE_VALID;
+        case DiskIoDoneWrite: {
+            // a write has completed
+            int16_t cache_idx = find_io_idx(io.disk_block.block, GRID_CACHE_DIRTY);
+            if (cache_idx != -1) {
+                if (cache[cache_idx].grid.bitmap == io.disk_block.block.bitmap) {
+                    // only mark valid if more grids haven't been added
+                    cache[cache_idx].state = GRID_CACHE_VALID;
+                }
             }
+            io.state = DiskIoIdle;
+            break;
+        }
+
+        case DiskIoWaitWrite:
+        case DiskIoWaitRead:
+            // waiting for io_timer()
+            break;
         }
-        disk_io_state = DiskIoIdle;
-        break;
-    }
-        
-    case DiskIoWaitWrite:
-    case DiskIoWaitRead:
-        // waiting for io_timer()
-        break;
     }
 }
 
@@ -119,12 +145,12 @@ void AP_Terrain::schedule_disk_io(void)
 /********************************************************
 All the functions below this point run in the IO timer context, which
 is a separate thread. The code uses the state machine controlled by
-disk_io_state to manage who has access to the structures and to
-prevent race conditions.
+the state of each disk_io slot to manage who has access to the
+structures and to prevent race conditions.
 
-The IO timer context owns the data when disk_io_state is
-DiskIoWaitWrite or DiskIoWaitRead. The main thread owns the data when
-disk_io_state is DiskIoIdle, DiskIoDoneWrite or DiskIoDoneRead
+The IO timer context owns a slot when its state is DiskIoWaitWrite or
+DiskIoWaitRead. The main thread owns a slot when its state is
+DiskIoIdle, DiskIoDoneWrite or DiskIoDoneRead
 
 All file operations are done by the IO thread.
 *********************************************************/
@@ -133,12 +159,11 @@ All file operations are done by the IO thread.
 /*
   open the current degree file
  */
-void AP_Terrain::open_file(void)
+void AP_Terrain::open_file(const struct grid_block &block)
 {
     if (diskless()) {
         return;
     }
-    struct grid_block &block = disk_block.block;
     if (fd != -1 && 
         block.lat_degrees == file_lat_degrees &&
         block.lon_degrees == file_lon_degrees) {
@@ -220,7 +245,7 @@ void AP_Terrain::open_file(void)
 /*
   work out how many blocks needed in a stride for a given location
  */
-uint32_t AP_Terrain::east_blocks(struct grid_block &block) const
+uint32_t AP_Terrain::east_blocks(const struct grid_block &block) const
 {
     Location loc1, loc2;
     loc1.lat = block.lat_degrees*10*1000*1000L;
@@ -235,14 +260,21 @@ uint32_t AP_Terrain::east_blocks(struct grid_block &block) const
 }
 
 /*
-  seek to the right offset for disk_block
+  get the offset of a block in its degree file
  */
-void AP_Terrain::seek_offset(void)
+uint32_t AP_Terrain::block_file_offset(const struct grid_block &block) const
 {
-    struct grid_block &block = disk_block.block;
     // work out how many longitude blocks there are at this latitude
     uint32_t blocknum = east_blocks(block) * block.grid_idx_x + block.grid_idx_y;
-    uint32_t file_offset = blocknum * sizeof(union grid_io_block);
+    return blocknum * sizeof(union grid_io_block);
+}
+
+/*
+  seek to the right offset for a block
+ */
+void AP_Terrain::seek_offset(const struct grid_block &block)
+{
+    uint32_t file_offset = block_file_offset(block);
     if (AP::FS().lseek(fd, file_offset, SEEK_SET) != (off_t)file_offset) {
 #if TERRAIN_DEBUG
         hal.console->printf("Seek %lu failed - %s\n",
@@ -255,11 +287,16 @@ void AP_Terrain::seek_offset(void)
 }
 
 /*
-  write out disk_block
+  write out the disk_block of an IO slot
  */
-void AP_Terrain::write_block(void)
+void AP_Terrain::write_block(struct disk_io_slot &io)
 {
-    seek_offset();
+#if AP_TERRAIN_MMAP_ENABLED
+    // stop the main thread copying from the mapping mid-write
+    WITH_SEMAPHORE(mmap_sem);
+#endif
+    union grid_io_block &disk_block = io.disk_block;
+    seek_offset(disk_block.block);
     if (io_failure || diskless()) {
         return;
     }
@@ -276,6 +313,9 @@ void AP_Terrain::write_block(void)
         io_failure = true;
     } else {
         AP::FS().fsync(fd);
+#if AP_TERRAIN_MMAP_ENABLED
+        mmap_block_written(disk_block.block);
+#endif
 #if TERRAIN_DEBUG
         printf("wrote block at %ld %ld ret=%d mask=%07llx\n",
                (long)disk_block.block.lat,
@@ -284,15 +324,16 @@ void AP_Terrain::write_block(void)
                (unsigned long long)disk_block.block.bitmap);
 #endif
     }
-    disk_io_state = DiskIoDoneWrite;
+    io.state = DiskIoDoneWrite;
 }
 
 /*
-  read in disk_block
+  read in the disk_block of an IO slot
  */
-void AP_Terrain::read_block(void)
+void AP_Terrain::read_block(struct disk_io_slot &io)
 {
-    seek_offset();
+    union grid_io_block &disk_block = io.disk_block;
+    seek_offset(disk_block.block);
     if (io_failure || diskless()) {
         return;
     }
@@ -334,7 +375,7 @@ void AP_Terrain::read_block(void)
                (unsigned long long)disk_block.block.bitmap);
 #endif
     }
-    disk_io_state = DiskIoDoneRead;
+    io.state = DiskIoDoneRead;
 }
 
 /*
@@ -354,30 +395,42 @@ void AP_Terrain::io_timer(void)
 
     update_reference_offset();
 
-    switch (disk_io_state) {
-    case DiskIoIdle:
-    case DiskIoDoneRead:
-    case DiskIoDoneWrite:
-        // nothing to do
-        break;
-        
-    case DiskIoWaitWrite:
-        // need to write out the block
-        open_file();
-        if (fd == -1) {
-            return;
-        }
-        write_block();
-        break;
+    // service all queued blocks in one pass
+    for (uint8_t i=0; i<disk_io_count; i++) {
+        auto &io = disk_io[i];
+        switch (io.state) {
+        case DiskIoIdle:
+        case DiskIoDoneRead:
+        case DiskIoDoneWrite:
+            // nothing to do
+            break;
+
+        case DiskIoWaitWrite:
+            // need to write out the block
+            open_file(io.disk_block.block);
+            if (fd == -1) {
+                return;
+            }
+            write_block(io);
+            break;
 
-    case DiskIoWaitRead:
-        // need to read in the block
-        open_file();
-        if (fd == -1) {
+        case DiskIoWaitRead:
+            // need to read in the block
+            open_file(io.disk_block.block);
+            if (fd == -1) {
+                return;
+            }
+#if AP_TERRAIN_MMAP_ENABLED
+            // map the file so later misses can be served without
+            // queueing a read
+            mmap_update(io.disk_block.block);
+#endif
+            read_block(io);
+            break;
+        }
+        if (io_failure) {
             return;
         }
-        read_block();
-        break;
     }
 }
 
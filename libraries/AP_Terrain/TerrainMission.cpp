@@ -44,7 +44,6 @@ void AP_Terrain::update_mission_data(void)
         last_mission_spacing != grid_spacing) {
         // the mission has changed - start again
         next_mission_index = 1;
-        next_mission_pos = 0;
         last_mission_change_ms = mission->last_change_time_ms();
         last_mission_spacing = grid_spacing;
     }
@@ -60,55 +59,79 @@ void AP_Terrain::update_mission_data(void)
         return;
     }
 
+    // we fetch 5 points around each waypoint. Four at 10 grid
+    // spacings away at 45, 135, 225 and 315 degrees, and the point
+    // itself. The points of several waypoints are looked up together
+    // so each grid block is only searched for once
+    const uint8_t points_per_wp = 5;
+    const uint8_t wp_per_batch = TERRAIN_BATCH_SIZE / points_per_wp;
+
     // don't do more than 20 waypoints at a time, to prevent too much
     // CPU usage
-    for (uint8_t i=0; i<20; i++) {
-        // get next mission command
-        AP_Mission::Mission_Command cmd;
-        if (!mission->read_cmd_from_storage(next_mission_index, cmd)) {
-            // nothing more to do
-            next_mission_index = 0;
-            return;
-        }
-
-        // we only want nav waypoint commands. That should be enough to
-        // prefill the terrain data and makes many things much simpler
-        while ((cmd.id != MAV_CMD_NAV_WAYPOINT &&
-                cmd.id != MAV_CMD_NAV_SPLINE_WAYPOINT) ||
-               (cmd.content.location.lat == 0 && cmd.content.location.lng == 0)) {
-            next_mission_index++;
-            if (!mission->read_cmd_from_storage(next_mission_index, cmd)) {
+    uint8_t checked = 0;
+    while (checked < 20) {
+        Location locs[wp_per_batch*points_per_wp];
+        float heights[wp_per_batch*points_per_wp];
+        bool available[wp_per_batch*points_per_wp];
+        uint16_t wp_index[wp_per_batch];
+        uint8_t nwp = 0;
+        bool end_of_mission = false;
+
+        uint16_t index = next_mission_index;
+        while (nwp < wp_per_batch) {
+            // get next mission command
+            AP_Mission::Mission_Command cmd;
+            if (!mission->read_cmd_from_storage(index, cmd)) {
                 // nothing more to do
-                next_mission_index = 0;
-                next_mission_pos = 0;
-                return;
+                end_of_mission = true;
+                break;
+            }
+
+            // we only want nav waypoint commands. That should be enough to
+            // prefill the terrain data and makes many things much simpler
+            if ((cmd.id != MAV_CMD_NAV_WAYPOINT &&
+                 cmd.id != MAV_CMD_NAV_SPLINE_WAYPOINT) ||
+                (cmd.content.location.lat == 0 && cmd.content.location.lng == 0)) {
+                index++;
+                continue;
             }
-        }
 
-        // we will fetch 5 points around the waypoint. Four at 10 grid
-        // spacings away at 45, 135, 225 and 315 degrees, and the
-        // point itself
-        if (next_mission_pos != 4) {
-            cmd.content.location.offset_bearing(45+90*next_mission_pos, grid_spacing.get() * 10);
+            wp_index[nwp] = index;
+            for (uint8_t pos=0; pos<points_per_wp; pos++) {
+                Location &loc = locs[nwp*points_per_wp + pos];
+                loc = cmd.content.location;
+                if (pos != 4) {
+                    loc.offset_bearing(45+90*pos, grid_spacing.get() * 10);
+                }
+            }
+            nwp++;
+            index++;
         }
 
-        // we have a mission command to check
-        float height;
-        if (!height_amsl(cmd.content.location, height)) {
-            // if we can't get data for a mission item then return and
-            // check again next time
-            return;
+        if (nwp > 0) {
+            height_amsl(locs, heights, available, nwp*points_per_wp);
         }
 
-        next_mission_pos++;
-        if (next_mission_pos == 5) {
+        // move past the waypoints that have all of their points
+        for (uint8_t w=0; w<nwp; w++) {
+            for (uint8_t pos=0; pos<points_per_wp; pos++) {
+                if (!available[w*points_per_wp + pos]) {
+                    // if we can't get data for a mission item then
+                    // return and check again next time
+                    next_mission_index = wp_index[w];
+                    return;
+                }
+            }
 #if TERRAIN_DEBUG
-            hal.console->printf("checked waypoint %u\n", (unsigned)next_mission_index);
+            hal.console->printf("checked waypoint %u\n", (unsigned)wp_index[w]);
 #endif
+            next_mission_index = wp_index[w] + 1;
+            checked++;
+        }
 
-            // move to next waypoint
-            next_mission_index++;
-            next_mission_pos = 0;
+        if (end_of_mission) {
+            next_mission_index = 0;
+            return;
         }
     }
 #endif  // AP_MISSION_ENABLED
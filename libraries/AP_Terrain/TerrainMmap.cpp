@@ -0,0 +1,211 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  memory mapped access to terrain DAT files
+
+  On boards with a POSIX filesystem the IO thread maps each degree
+  file as it is first read. Cache misses in the main thread are then
+  filled by copying straight from the mapped pages instead of queueing
+  a seek/read in the IO thread. The block CRC is only checked the first
+  time a block is used, and again after it has been written.
+ */
+
+#include "AP_Terrain.h"
+
+#if AP_TERRAIN_MMAP_ENABLED
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern const AP_HAL::HAL& hal;
+
+/*
+  find the mapping of a degree file. Must be called with mmap_sem held
+ */
+AP_Terrain::mmap_file *AP_Terrain::mmap_find(int8_t lat_degrees, int16_t lon_degrees)
+{
+    for (auto &m : mmap_files) {
+        if (m.data != nullptr &&
+            m.lat_degrees == lat_degrees &&
+            m.lon_degrees == lon_degrees) {
+            return &m;
+        }
+    }
+    return nullptr;
+}
+
+/*
+  map the degree file for a block, or extend the mapping if the file
+  has grown past the block. Runs in the IO thread after open_file() has
+  setup file_path for this block
+ */
+void AP_Terrain::mmap_update(const struct grid_block &block)
+{
+    const uint32_t end = block_file_offset(block) + sizeof(union grid_io_block);
+
+    WITH_SEMAPHORE(mmap_sem);
+
+    struct mmap_file *m = mmap_find(block.lat_degrees, block.lon_degrees);
+    if (m != nullptr && end <= m->size) {
+        // already mapped
+        return;
+    }
+
+    int mfd = ::open(file_path, O_RDONLY | O_CLOEXEC);
+    if (mfd == -1) {
+        return;
+    }
+    struct stat st;
+    if (fstat(mfd, &st) != 0 || st.st_size < (off_t)sizeof(union grid_io_block)) {
+        ::close(mfd);
+        return;
+    }
+    // only whole blocks can be read
+    const uint32_t file_size = st.st_size - (st.st_size % sizeof(union grid_io_block));
+
+    if (m != nullptr && file_size <= m->capacity) {
+        // the file has grown into pages we already have mapped
+        m->size = MAX(m->size, file_size);
+        ::close(mfd);
+        return;
+    }
+
+    // map past the end of the file so the mapping only needs
+    // replacing once the file grows by another step
+    const uint32_t step = TERRAIN_MMAP_GROW_BLOCKS * sizeof(union grid_io_block);
+    const uint32_t capacity = (file_size / step + 1) * step;
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    // read the file in now, in the IO thread, so the main thread's
+    // first copy from each block doesn't usually take a page fault.
+    // Pages can still be evicted later, so this makes main thread
+    // faults rarer rather than impossible
+    flags |= MAP_POPULATE;
+#endif
+    void *data = mmap(nullptr, capacity, PROT_READ, flags, mfd, 0);
+    ::close(mfd);
+    if (data == MAP_FAILED) {
+        return;
+    }
+    const uint32_t nblocks = capacity / sizeof(union grid_io_block);
+    auto *block_state = (enum MmapBlockState *)calloc(nblocks, sizeof(enum MmapBlockState));
+    if (block_state == nullptr) {
+        munmap(data, capacity);
+        return;
+    }
+
+    if (m != nullptr) {
+        // same file, so the CRC checks already done still hold
+        memcpy(block_state, m->block_state, (m->capacity / sizeof(union grid_io_block)) * sizeof(block_state[0]));
+    } else {
+        // use the least recently used slot
+        m = &mmap_files[0];
+        for (auto &f : mmap_files) {
+            if (f.data == nullptr) {
+                m = &f;
+                break;
+            }
+            if (f.last_use_ms < m->last_use_ms) {
+                m = &f;
+            }
+        }
+        m->spacing = grid_spacing;
+        m->lat_degrees = block.lat_degrees;
+        m->lon_degrees = block.lon_degrees;
+    }
+    if (m->data != nullptr) {
+        munmap((void *)m->data, m->capacity);
+        free(m->block_state);
+    }
+    m->data = (const uint8_t *)data;
+    m->size = file_size;
+    m->capacity = capacity;
+    m->block_state = block_state;
+    m->last_use_ms = AP_HAL::millis();
+}
+
+/*
+  fill a newly allocated cache block from a mapped file. Returns true
+  if the mapping covers the block, in which case the block is either
+  filled or known to be missing on disk. Runs in the main thread
+ */
+bool AP_Terrain::mmap_read_block(struct grid_block &block)
+{
+    // never wait for the IO thread, fall back to a queued read instead
+    if (!mmap_sem.take_nonblocking()) {
+        return false;
+    }
+
+    struct mmap_file *m = mmap_find(block.lat_degrees, block.lon_degrees);
+    const uint32_t offset = block_file_offset(block);
+    if (m == nullptr || offset + sizeof(union grid_io_block) > m->size) {
+        mmap_sem.give();
+        return false;
+    }
+
+    if (m->spacing != grid_spacing) {
+        // block validity depends on the grid spacing
+        memset(m->block_state, 0, (m->capacity / sizeof(union grid_io_block)) * sizeof(m->block_state[0]));
+        m->spacing = grid_spacing;
+    }
+
+    struct grid_block tmp;
+    memcpy(&tmp, &m->data[offset], sizeof(tmp));
+
+    enum MmapBlockState &state = m->block_state[offset / sizeof(union grid_io_block)];
+    if (state == MmapBlockUnchecked) {
+        if (TERRAIN_LATLON_EQUAL(tmp.lat, block.lat) &&
+            TERRAIN_LATLON_EQUAL(tmp.lon, block.lon) &&
+            tmp.bitmap != 0 &&
+            tmp.spacing == grid_spacing &&
+            tmp.version == TERRAIN_GRID_FORMAT_VERSION &&
+            tmp.crc == get_block_crc(tmp)) {
+            state = MmapBlockValid;
+        } else {
+            state = MmapBlockInvalid;
+        }
+    }
+    if (state == MmapBlockValid) {
+        block = tmp;
+    }
+    m->last_use_ms = AP_HAL::millis();
+
+    mmap_sem.give();
+    return true;
+}
+
+/*
+  note that a block has been written, so its CRC is checked again on
+  next use. A write past the end of the file grows it into the mapped
+  space. Runs in the IO thread with mmap_sem held
+ */
+void AP_Terrain::mmap_block_written(const struct grid_block &block)
+{
+    struct mmap_file *m = mmap_find(block.lat_degrees, block.lon_degrees);
+    const uint32_t offset = block_file_offset(block);
+    const uint32_t end = offset + sizeof(union grid_io_block);
+    if (m == nullptr || end > m->capacity) {
+        return;
+    }
+    m->size = MAX(m->size, end);
+    m->block_state[offset / sizeof(union grid_io_block)] = MmapBlockUnchecked;
+}
+
+#endif // AP_TERRAIN_MMAP_ENABLED
@@ -101,6 +101,22 @@ void AP_Terrain::calculate_grid_info(const Location &loc, struct grid_info &info
 }
 
 
+/*
+  return true if the grid block for a grid_info is in the cache,
+  without claiming a cache block for it
+ */
+bool AP_Terrain::grid_cached(const struct grid_info &info) const
+{
+    for (uint16_t i=0; i<cache_size; i++) {
+        if (TERRAIN_LATLON_EQUAL(cache[i].grid.lat,info.grid_lat) &&
+            TERRAIN_LATLON_EQUAL(cache[i].grid.lon,info.grid_lon) &&
+            cache[i].grid.spacing == grid_spacing) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /*
   find a grid structure given a grid_info
  */
@@ -115,6 +131,9 @@ AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info
             TERRAIN_LATLON_EQUAL(cache[i].grid.lon,info.grid_lon) &&
             cache[i].grid.spacing == grid_spacing) {
             cache[i].last_access_ms = now_ms;
+            if (cache[i].state >= GRID_CACHE_VALID && stats.cache_hits < UINT16_MAX) {
+                stats.cache_hits++;
+            }
             return cache[i];
         }
         if (cache[i].last_access_ms < cache[oldest_i].last_access_ms) {
@@ -124,6 +143,9 @@ AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info
 
     // Not found. Use the oldest grid and make it this grid,
     // initially unpopulated
+    if (stats.cache_misses < UINT16_MAX) {
+        stats.cache_misses++;
+    }
     struct grid_cache &grid = cache[oldest_i];
     memset(&grid, 0, sizeof(grid));
 
@@ -140,26 +162,33 @@ AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info
     // mark as waiting for disk read
     grid.state = GRID_CACHE_DISKWAIT;
 
+#if AP_TERRAIN_MMAP_ENABLED
+    // if the degree file is mapped we can fill the block immediately
+    if (!diskless() && mmap_read_block(grid.grid)) {
+        grid.state = GRID_CACHE_VALID;
+    }
+#endif
+
     return grid;
 }
 
 /*
-  find cache index of disk_block
+  find cache index of a block that has completed disk IO
  */
-int16_t AP_Terrain::find_io_idx(enum GridCacheState state)
+int16_t AP_Terrain::find_io_idx(const struct grid_block &block, enum GridCacheState state)
 {
     // try first with given state
     for (uint16_t i=0; i<cache_size; i++) {
-        if (TERRAIN_LATLON_EQUAL(disk_block.block.lat,cache[i].grid.lat) &&
-            TERRAIN_LATLON_EQUAL(disk_block.block.lon,cache[i].grid.lon) &&
+        if (TERRAIN_LATLON_EQUAL(block.lat,cache[i].grid.lat) &&
+            TERRAIN_LATLON_EQUAL(block.lon,cache[i].grid.lon) &&
             cache[i].state == state) {
             return i;
         }
     }    
     // then any state
     for (uint16_t i=0; i<cache_size; i++) {
-        if (TERRAIN_LATLON_EQUAL(disk_block.block.lat,cache[i].grid.lat) &&
-            TERRAIN_LATLON_EQUAL(disk_block.block.lon,cache[i].grid.lon)) {
+        if (TERRAIN_LATLON_EQUAL(block.lat,cache[i].grid.lat) &&
+            TERRAIN_LATLON_EQUAL(block.lon,cache[i].grid.lon)) {
             return i;
         }
     }    
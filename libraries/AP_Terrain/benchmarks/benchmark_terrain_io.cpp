@@ -0,0 +1,188 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  compare random access latency of the two AP_Terrain block fetch
+  paths: read_block(), which seeks, reads and checks the CRC of every
+  block, and mmap_read_block(), which copies from the mapped file and
+  checks the CRC on first use only. The degree file is written with
+  write_block() into a temporary directory
+ */
+#include <AP_gbenchmark.h>
+
+#include <AP_Terrain/AP_Terrain.h>
+#include <AP_Filesystem/AP_Filesystem.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#if AP_TERRAIN_AVAILABLE
+
+static AP_Terrain terrain;
+
+// blocks written in each direction, 400 blocks covers most of a
+// degree file at the default 100m spacing
+#define BENCH_BLOCKS_X 20
+#define BENCH_BLOCKS_Y 20
+
+class AP_Terrain_Benchmark
+{
+public:
+    static void setup();
+    static void teardown();
+    static void read_block(uint32_t idx);
+#if AP_TERRAIN_MMAP_ENABLED
+    static void mmap_read_block(uint32_t idx);
+#endif
+
+private:
+    static char dir[];
+    static AP_Terrain::grid_block blocks[BENCH_BLOCKS_X*BENCH_BLOCKS_Y];
+    static AP_Terrain::disk_io_slot io;
+};
+
+char AP_Terrain_Benchmark::dir[] = "/tmp/ap_terrain_benchXXXXXX";
+AP_Terrain::grid_block AP_Terrain_Benchmark::blocks[BENCH_BLOCKS_X*BENCH_BLOCKS_Y];
+AP_Terrain::disk_io_slot AP_Terrain_Benchmark::io;
+
+/*
+  write a grid of full blocks, well inside the N40E010 degree file
+ */
+void AP_Terrain_Benchmark::setup()
+{
+    if (mkdtemp(dir) == nullptr ||
+        asprintf(&terrain.file_path, "%s/NxxExxx.DAT", dir) <= 0) {
+        abort();
+    }
+    const float block_m = TERRAIN_GRID_BLOCK_SPACING_X * terrain.grid_spacing;
+    Location base;
+    base.lat = 40.1 * 1e7;
+    base.lng = 10.1 * 1e7;
+    for (uint16_t x=0; x<BENCH_BLOCKS_X; x++) {
+        for (uint16_t y=0; y<BENCH_BLOCKS_Y; y++) {
+            Location loc = base;
+            loc.offset((x + 0.5f) * block_m, (y + 0.5f) * block_m);
+            AP_Terrain::grid_info info;
+            terrain.calculate_grid_info(loc, info);
+
+            AP_Terrain::grid_block &b = blocks[x*BENCH_BLOCKS_Y + y];
+            memset(&b, 0, sizeof(b));
+            b.lat = info.grid_lat;
+            b.lon = info.grid_lon;
+            b.spacing = terrain.grid_spacing;
+            b.grid_idx_x = info.grid_idx_x;
+            b.grid_idx_y = info.grid_idx_y;
+            b.lat_degrees = info.lat_degrees;
+            b.lon_degrees = info.lon_degrees;
+            b.version = TERRAIN_GRID_FORMAT_VERSION;
+            b.bitmap = AP_Terrain::bitmap_mask;
+            for (uint8_t i=0; i<TERRAIN_GRID_BLOCK_SIZE_X; i++) {
+                for (uint8_t j=0; j<TERRAIN_GRID_BLOCK_SIZE_Y; j++) {
+                    b.height[i][j] = 100 + i + j;
+                }
+            }
+
+            io.disk_block.block = b;
+            terrain.open_file(b);
+            terrain.write_block(io);
+            if (terrain.io_failure) {
+                abort();
+            }
+        }
+    }
+#if AP_TERRAIN_MMAP_ENABLED
+    terrain.mmap_update(blocks[0]);
+#endif
+}
+
+void AP_Terrain_Benchmark::teardown()
+{
+    if (terrain.fd != -1) {
+        AP::FS().close(terrain.fd);
+        terrain.fd = -1;
+    }
+    ::unlink(terrain.file_path);
+    ::rmdir(dir);
+}
+
+void AP_Terrain_Benchmark::read_block(uint32_t idx)
+{
+    io.disk_block.block = blocks[idx];
+    terrain.read_block(io);
+    if (io.disk_block.block.bitmap == 0) {
+        abort();
+    }
+    gbenchmark_escape(&io.disk_block);
+}
+
+#if AP_TERRAIN_MMAP_ENABLED
+void AP_Terrain_Benchmark::mmap_read_block(uint32_t idx)
+{
+    AP_Terrain::grid_block b = blocks[idx];
+    b.bitmap = 0;
+    if (!terrain.mmap_read_block(b) || b.bitmap == 0) {
+        abort();
+    }
+    gbenchmark_escape(&b);
+}
+#endif
+
+static uint32_t random_block(uint32_t &seed)
+{
+    seed = seed * 1103515245U + 12345U;
+    return (seed >> 8) % (BENCH_BLOCKS_X*BENCH_BLOCKS_Y);
+}
+
+static void BM_TerrainReadBlock(benchmark::State& state)
+{
+    uint32_t seed = 1;
+    while (state.KeepRunning()) {
+        AP_Terrain_Benchmark::read_block(random_block(seed));
+    }
+}
+
+BENCHMARK(BM_TerrainReadBlock);
+
+#if AP_TERRAIN_MMAP_ENABLED
+static void BM_TerrainMmapReadBlock(benchmark::State& state)
+{
+    uint32_t seed = 1;
+    while (state.KeepRunning()) {
+        AP_Terrain_Benchmark::mmap_read_block(random_block(seed));
+    }
+}
+
+BENCHMARK(BM_TerrainMmapReadBlock);
+#endif
+
+int main(int argc, char **argv)
+{
+    benchmark::Initialize(&argc, argv);
+    AP_Terrain_Benchmark::setup();
+    benchmark::RunSpecifiedBenchmarks();
+    AP_Terrain_Benchmark::teardown();
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    return 0;
+}
+
+#endif // AP_TERRAIN_AVAILABLE
@@ -24,6 +24,7 @@
 #include "GCS.h"
 #include <AP_Logger/AP_Logger.h>
 #include <AP_BoardConfig/AP_BoardConfig.h>
+#include <AP_Scripting/AP_Scripting.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -321,6 +322,15 @@ void GCS_MAVLINK::handle_param_set(const mavlink_message_t &msg)
         AP_Param::invalidate_count();
     }
 
+#if AP_SCRIPTING_ENABLED
+    if (force_save) {
+        AP_Scripting *scripting = AP_Scripting::get_singleton();
+        if (scripting != nullptr) {
+            scripting->wake(AP_Scripting::WakeEvent::PARAM_SET);
+        }
+    }
+#endif
+
 #if HAL_LOGGING_ENABLED
     AP_Logger *logger = AP_Logger::get_singleton();
     if (logger != nullptr) {